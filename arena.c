@@ -0,0 +1,99 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "tools.h"
+
+#define ARENA_ALIGN(n)  (((n) + 15) & ~((size_t) 15))
+
+struct arena * arena_new(struct arena * parent) {
+  struct arena * a = calloc(1, sizeof(* a));
+
+  if (a == NULL)
+     fatal("out of memory\n");
+  if (parent) {
+     a->parent = parent;
+     a->next_sibling = parent->children;
+     if (parent->children)
+        parent->children->prev_sibling = a;
+     parent->children = a;
+     }
+  return a;
+}
+
+void arena_free(struct arena * a) {
+  struct arena_block * b;
+
+  if (a == NULL)
+     return;
+  while(a->children)
+     arena_free(a->children);
+  if (a->parent) {
+     if (a->prev_sibling)
+        a->prev_sibling->next_sibling = a->next_sibling;
+     else
+        a->parent->children = a->next_sibling;
+     if (a->next_sibling)
+        a->next_sibling->prev_sibling = a->prev_sibling;
+     }
+  while((b = a->blocks)) {
+     a->blocks = b->next;
+     free(b);
+     }
+  free(a);
+}
+
+void * arena_alloc(struct arena * a, size_t size) {
+  struct arena_block * b = a->blocks;
+  void * p;
+
+  size = ARENA_ALIGN(size);
+  if ((b == NULL) || (b->size - b->used < size)) {
+     size_t block_size = max(size, (size_t) ARENA_BLOCK_SIZE);
+
+     b = malloc(sizeof(* b) + block_size);
+     if (b == NULL)
+        fatal("out of memory\n");
+     b->size = block_size;
+     b->used = 0;
+     // a large allocation must not waste the rest of the current block.
+     if (a->blocks && (size > ARENA_BLOCK_SIZE)) {
+        b->next = a->blocks->next;
+        a->blocks->next = b;
+        }
+     else {
+        b->next = a->blocks;
+        a->blocks = b;
+        }
+     a->allocated += block_size;
+     }
+  p = b->data + b->used;
+  b->used += size;
+  memset(p, 0, size);
+  return p;
+}
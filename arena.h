@@ -0,0 +1,65 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+/* simple bump allocator. Memory is taken from larger blocks and only released
+/* as a whole by arena_free(), i.e. for data living as long as its transponder.
+/* Arenas may have a parent: freeing the parent frees all its children too, so
+/* one call releases a whole scan (see free_scan_session()).
+ ******************************************************************************/
+
+#define ARENA_BLOCK_SIZE  4096
+
+struct arena_block {
+  struct arena_block * next;
+  size_t size;                        // usable bytes in data[]
+  size_t used;
+  uint8_t data[] __attribute__((aligned(16)));
+};
+
+struct arena {
+  struct arena_block * blocks;        // newest first
+  size_t allocated;                   // sum of all blocks, for statistics
+  struct arena * parent;
+  struct arena * children;            // freed together with this arena
+  struct arena * prev_sibling;
+  struct arena * next_sibling;
+};
+
+/* parent may be NULL. */
+struct arena * arena_new(struct arena * parent);
+
+/* frees a, all its children and all memory allocated from them. NULL is ignored. */
+void arena_free(struct arena * a);
+
+/* zero initialized memory, aligned to 16 bytes. Never returns NULL. */
+void * arena_alloc(struct arena * a, size_t size);
+
+#endif
@@ -37,6 +37,7 @@
 #include <locale.h>
 #include <iconv.h>
 #include <errno.h>
+#include <pthread.h>
 #include "scan.h"
 #include "char-coding.h"
 #include "iconv_codes.h"
@@ -44,44 +45,377 @@
 #define MIN(X,Y) (X < Y ? X : Y)
 #define IsCharacterCodingCode(C) (C < 0x20)
 
-char* reset_to_charset = "ISO6937"; // 20200517: changed from ISO69372 into ISO6937
-char* default_charset = "ISO6937";
+/*
+ * ISO/EN 300 468 v011101p, Annex A.2 Selection of character table: first byte of text field.
+ */
+static const uint16_t annex_a_tables[0x16] = {
+  ICONV_NONE,            // 0x00
+  ICONV_ISO_8859_5,      // 0x01 ISO/IEC 8859-5  Latin/Cyrillic alphabet A.2
+  ICONV_ISO_8859_6,      // 0x02 ISO/IEC 8859-6  Latin/Arabic alphabet A.3
+  ICONV_ISO_8859_7,      // 0x03 ISO/IEC 8859-7  Latin/Greek alphabet A.4
+  ICONV_ISO_8859_8,      // 0x04 ISO/IEC 8859-8  Latin/Hebrew alphabet A.5
+  ICONV_ISO_8859_9,      // 0x05 ISO/IEC 8859-9  Latin alphabet No. 5 A.6
+  ICONV_ISO_8859_10,     // 0x06 ISO/IEC 8859-10 Latin alphabet No. 6 A.7
+  ICONV_ISO_8859_11,     // 0x07 ISO/IEC 8859-11 Latin/Thai (draft only) A.8
+  ICONV_NONE,            // 0x08                 reserved for future use (see note)
+  ICONV_ISO_8859_13,     // 0x09 ISO/IEC 8859-13 Latin alphabet No. 7 A.9
+  ICONV_ISO_8859_14,     // 0x0A ISO/IEC 8859-14 Latin alphabet No. 8 (Celtic) A.10
+  ICONV_ISO_8859_15,     // 0x0B ISO/IEC 8859-15 Latin alphabet No. 9 A.11
+  ICONV_NONE,            // 0x0C                 reserved for future use
+  ICONV_NONE,            // 0x0D                 reserved for future use
+  ICONV_NONE,            // 0x0E                 reserved for future use
+  ICONV_NONE,            // 0x0F                 reserved for future use
+  ICONV_NONE,            // 0x10 ISO/IEC 8859    See table A.4, iso8859_tables[]
+  ICONV_ISO_10646,       // 0x11 ISO/IEC 10646   Basic Multilingual Plane
+  ICONV_ISO_2022_KR,     // 0x12 KSX1001-2004    Korean Character Set
+  ICONV_GB2312,          // 0x13 GB-2312-1980    Simplified Chinese Character
+  ICONV_BIG_5,           // 0x14 Big5 subset of ISO/IEC 10646 Traditional Chinese
+  ICONV_ISO_10646_UTF_8, // 0x15 UTF-8 encoding of ISO/IEC 10646 Basic Multil. Plane
+};
+
+/*
+ * Table A.4: first byte 0x10, second byte 0x00, third byte selects the ISO/IEC 8859 part.
+ */
+static const uint16_t iso8859_tables[0x10] = {
+  ICONV_NONE,            // 0x00 reserved for future use
+  ICONV_ISO_8859_1,      // 0x01 ISO/IEC 8859-1 W European
+  ICONV_ISO_8859_2,      // 0x02 ISO/IEC 8859-2 E European
+  ICONV_ISO_8859_3,      // 0x03 ISO/IEC 8859-3 S European
+  ICONV_ISO_8859_4,      // 0x04 ISO/IEC 8859-4 N/NE European
+  ICONV_ISO_8859_5,      // 0x05 ISO/IEC 8859-5 Lat./Cyrill. A.2
+  ICONV_ISO_8859_6,      // 0x06 ISO/IEC 8859-6 Lat./Arabic A.3
+  ICONV_ISO_8859_7,      // 0x07 ISO/IEC 8859-7 Lat./Greek A.4
+  ICONV_ISO_8859_8,      // 0x08 ISO/IEC 8859-8 Lat./Hebrew A.5
+  ICONV_ISO_8859_9,      // 0x09 ISO/IEC 8859-9 WE & Turk A.6
+  ICONV_ISO_8859_10,     // 0x0A ISO/IEC 8859-10 N European A.7
+  ICONV_ISO_8859_11,     // 0x0B ISO/IEC 8859-11 Thai A.8
+  ICONV_NONE,            // 0x0C Reserved for future use
+  ICONV_ISO_8859_13,     // 0x0D ISO/IEC 8859-13 Baltic A.9
+  ICONV_ISO_8859_14,     // 0x0E ISO/IEC 8859-14 Celtic A.10
+  ICONV_ISO_8859_15,     // 0x0F ISO/IEC 8859-15 W European A.11
+};
+
+// clean_str: enshure upper case and remove all { '-', '_', ' ' }
+static inline void clean_str(const char * in, char * outbuf) {
+  unsigned i, pos = 0;
+
+  for (i = 0; i < strlen(in); i++) {
+      if ((in[i] == '-') ||
+          (in[i] == '_') ||
+          (in[i] == ' '))
+         continue;
+      outbuf[pos++] = toupper(in[i]);
+      }
+  outbuf[pos++] = 0;
+}
+
+/*
+ * iconv descriptors are expensive to open, but only a few combinations of
+ * charsets are used during a scan: keep them open.
+ */
+#define ICONV_CACHE_SIZE 16
+
+struct iconv_cache_entry {
+  unsigned from;
+  unsigned to;
+  iconv_t  cd;                     // (iconv_t) -1, if iconv_open() failed
+};
+
+struct byte_table;
+
+struct char_coding_ctx {
+  unsigned default_charset_id;     // for strings without charset definition, see set_char_coding_default_charset()
+  struct iconv_cache_entry iconv_cache[ICONV_CACHE_SIZE];
+  unsigned iconv_cache_count;
+  unsigned iconv_cache_next;       // next entry to replace if full
+  struct byte_table * byte_tables[ICONV_CACHE_SIZE];
+  unsigned byte_table_count;
+  unsigned utf8_checked;           // last charset checked by is_utf8(), ICONV_NONE = none
+  bool     utf8;
+};
+
+struct char_coding_ctx * char_coding_new(void) {
+  struct char_coding_ctx * cc = calloc(1, sizeof(* cc));
+
+  if (cc == NULL)
+     fatal("could not allocate char coding context.\n");
+  cc->default_charset_id = get_codepage_index("ISO6937"); // 20200517: changed from ISO69372 into ISO6937
+  cc->utf8_checked = ICONV_NONE;
+  return cc;
+}
 
 /*
  * set the default charset that is used if a string does not include a charset definition in the first byte
  */
-void set_char_coding_default_charset(char* new_charset) {
-  default_charset = new_charset;
-  moreverbose("Assuming default charset %s.\n",default_charset);
+void set_char_coding_default_charset(struct char_coding_ctx * cc, const char * charset) {
+  cc->default_charset_id = get_codepage_index(charset);
+  moreverbose("Assuming default charset %s.\n", charset);
+}
+
+static iconv_t get_iconv(struct char_coding_ctx * cc, unsigned from, unsigned to) {
+  struct iconv_cache_entry * e;
+  char usr[64];
+  unsigned i;
+
+  for (i = 0; i < cc->iconv_cache_count; i++) {
+      e = &cc->iconv_cache[i];
+      if ((e->from == from) && (e->to == to)) {
+         if (e->cd != (iconv_t)(-1))
+            iconv(e->cd, NULL, NULL, NULL, NULL); // reset to initial shift state
+         return e->cd;
+         }
+      }
+
+  if (cc->iconv_cache_count < ICONV_CACHE_SIZE)
+     e = &cc->iconv_cache[cc->iconv_cache_count++];
+  else {
+     e = &cc->iconv_cache[cc->iconv_cache_next];
+     cc->iconv_cache_next = (cc->iconv_cache_next + 1) % ICONV_CACHE_SIZE;
+     if (e->cd != (iconv_t)(-1))
+        iconv_close(e->cd);
+     }
+
+  snprintf(usr, sizeof(usr), "%s//IGNORE", iconv_codes[to]);
+  moreverbose("\t\topening conversion from '%s' to '%s'\n", iconv_codes[from], usr);
+  e->from = from;
+  e->to   = to;
+  e->cd   = iconv_open((const char *) usr, iconv_codes[from]);
+
+  if (e->cd == (iconv_t)(-1)) {
+     warning("\t\t%s %d: iconv_open failed.\n", __FUNCTION__, __LINE__);
+     switch(errno) {
+           case EINVAL:
+                info("\t\tThe conversion from '%s' to '%s' is not supported.\n",
+                    iconv_codes[from], iconv_codes[to]);
+                break;
+           default:
+                info("\t\t%s\n", strerror(errno));
+           }
+     }
+  return e->cd;
+}
+
+/*
+ * convert *inbytesleft bytes from charset 'from' to charset 'to'.
+ * returns -1, if there is no conversion between both charsets; otherwise 0, even if some chars
+ * couldn't be converted.
+ */
+static int convert(struct char_coding_ctx * cc, unsigned from, unsigned to, char ** inbuf, size_t * inbytesleft,
+                   char ** outbuf, size_t * outbytesleft) {
+  const char * psrc = *inbuf;
+  char * pdest = *outbuf;
+  size_t nsrc  = *inbytesleft;
+  size_t ndest = *outbytesleft;
+  iconv_t conversion_descriptor = get_iconv(cc, from, to);
+  size_t result;
+
+  if (conversion_descriptor == (iconv_t)(-1))
+     return -1;
+
+  result = iconv(conversion_descriptor, inbuf, inbytesleft, outbuf, outbytesleft);
+  if (result == (size_t)(-1)) {
+     warning("\t\t%s %d: iconv failed.\n", __FUNCTION__, __LINE__);
+     info("\t\t%s\n", strerror(errno));
+     switch (errno) {
+            case EILSEQ:
+            case EINVAL:
+                 hexdump("*inbuf",  (unsigned char *) psrc,  nsrc);
+                 hexdump("*outbuf", (unsigned char *) pdest, ndest);
+                 break;
+            default:;
+            }
+     }
+  return 0;
+}
+
+static bool is_utf8(struct char_coding_ctx * cc, unsigned charset_id) {
+  char buf[64];
+
+  if (charset_id != cc->utf8_checked) {
+     clean_str(iconv_codes[charset_id], buf);
+     cc->utf8 = (strcmp(buf, "UTF8") == 0);
+     cc->utf8_checked = charset_id;
+     }
+  return cc->utf8;
 }
 
 /*
- * reset default charset to the reset_to_charset
+ * single byte charsets (ISO-8859-x, ISO-6937 without its diacritical prefixes) are decoded by a table,
+ * which is filled once from iconv itself. Bytes, which iconv can't convert alone, are marked as
+ * unsupported; strings containing them are passed to iconv as before.
  */
-void reset_char_coding_default_charset() {
-  default_charset = reset_to_charset;
-  moreverbose("Resetting default charset to %s.\n",default_charset);
+#define BYTE_UNSUPPORTED 0xFF
+#define BYTE_PREFIX      0xFE      // ISO-6937 non-spacing diacritical mark 0xC1..0xCF, see pair[]
+
+struct byte_table {
+  unsigned from;
+  unsigned to;
+  uint8_t  len[256];               // length of utf8[i], BYTE_UNSUPPORTED or BYTE_PREFIX
+  char     utf8[256][4];
+  uint8_t  pair_len[16][128];      // diacritical mark 0xCx followed by a char 0x00..0x7F
+  char     pair[16][128][4];
+};
+
+static bool is_single_byte_charset(unsigned charset_id) {
+  char buf[64];
+
+  clean_str(iconv_codes[charset_id], buf);
+  return (strncmp(buf, "ISO8859", 7) == 0) || (strcmp(buf, "ISO6937") == 0);
+}
+
+static struct byte_table * get_byte_table(struct char_coding_ctx * cc, unsigned from, unsigned to) {
+  struct byte_table * tbl;
+  iconv_t cd;
+  unsigned i;
+
+  for (i = 0; i < cc->byte_table_count; i++) {
+      if ((cc->byte_tables[i]->from == from) && (cc->byte_tables[i]->to == to))
+         return cc->byte_tables[i];
+      }
+  if ((cc->byte_table_count >= ICONV_CACHE_SIZE) || ! is_single_byte_charset(from))
+     return NULL;
+  if ((cd = get_iconv(cc, from, to)) == (iconv_t)(-1))
+     return NULL;
+
+  tbl = calloc(1, sizeof(* tbl));
+  tbl->from = from;
+  tbl->to   = to;
+  tbl->len[0] = BYTE_UNSUPPORTED;
+  for (i = 1; i < 256; i++) {
+      char in[2] = { (char) i, 0 };
+      char * pi = in, * po = tbl->utf8[i];
+      size_t ni = 1, no = sizeof(tbl->utf8[i]);
+      unsigned j;
+
+      iconv(cd, NULL, NULL, NULL, NULL);
+      if ((iconv(cd, &pi, &ni, &po, &no) != (size_t)(-1)) && ! ni && (no < sizeof(tbl->utf8[i]))) {
+         tbl->len[i] = sizeof(tbl->utf8[i]) - no;
+         continue;
+         }
+      tbl->len[i] = BYTE_UNSUPPORTED;
+      if ((errno != EINVAL) || ((i & 0xF0) != 0xC0))
+         continue;
+
+      // incomplete: a diacritical mark, which combines with the next char.
+      tbl->len[i] = BYTE_PREFIX;
+      for (j = 0; j < 128; j++) {
+          in[1] = (char) j;
+          pi = in; ni = 2;
+          po = tbl->pair[i & 0xF][j]; no = sizeof(tbl->pair[i & 0xF][j]);
+          iconv(cd, NULL, NULL, NULL, NULL);
+          if ((j < 0x20) || (iconv(cd, &pi, &ni, &po, &no) == (size_t)(-1)) || ni ||
+              (no == sizeof(tbl->pair[i & 0xF][j])))
+             tbl->pair_len[i & 0xF][j] = BYTE_UNSUPPORTED;
+          else
+             tbl->pair_len[i & 0xF][j] = sizeof(tbl->pair[i & 0xF][j]) - no;
+          }
+      }
+  cc->byte_tables[cc->byte_table_count++] = tbl;
+  return tbl;
+}
+
+/* returns false without touching anything, if the string contains bytes not in the table. */
+static bool table_decode(struct byte_table * tbl, bool euro, char ** inbuf, size_t * inbytesleft, char ** outbuf,
+                         size_t * outbytesleft) {
+  static const char euro_utf8[] = "\xE2\x82\xAC";
+  const uint8_t * in = (const uint8_t *) *inbuf;
+  size_t i, n = *inbytesleft, need = 0;
+  bool ascii = true;
+  char * out;
+
+  for (i = 0; i < n; i++) {
+      if (in[i] >= 0x20 && in[i] <= 0x7E && (tbl->len[in[i]] == 1) && (tbl->utf8[in[i]][0] == (char) in[i])) {
+         need++;
+         continue;
+         }
+      ascii = false;
+      if (euro && (in[i] == 0xA4))
+         need += 3;
+      else if (tbl->len[in[i]] == BYTE_PREFIX) {
+         if ((i + 1 == n) || (in[i + 1] > 0x7F) || (tbl->pair_len[in[i] & 0xF][in[i + 1]] == BYTE_UNSUPPORTED))
+            return false;
+         need += tbl->pair_len[in[i] & 0xF][in[i + 1]];
+         i++;
+         }
+      else if (tbl->len[in[i]] == BYTE_UNSUPPORTED)
+         return false;
+      else
+         need += tbl->len[in[i]];
+      }
+  if (need >= *outbytesleft)
+     return false;
+
+  out = *outbuf;
+  if (ascii)
+     memcpy(out, in, n);
+  else {
+     for (i = 0; i < n; i++) {
+         if (euro && (in[i] == 0xA4)) {
+            memcpy(out, euro_utf8, 3);
+            out += 3;
+            }
+         else if (tbl->len[in[i]] == BYTE_PREFIX) {
+            memcpy(out, tbl->pair[in[i] & 0xF][in[i + 1]], tbl->pair_len[in[i] & 0xF][in[i + 1]]);
+            out += tbl->pair_len[in[i] & 0xF][in[i + 1]];
+            i++;
+            }
+         else {
+            memcpy(out, tbl->utf8[in[i]], tbl->len[in[i]]);
+            out += tbl->len[in[i]];
+            }
+         }
+     }
+  *inbuf += n;
+  *inbytesleft = 0;
+  *outbuf += need;
+  *outbytesleft -= need;
+  return true;
 }
 
 /*
- * set the charset to which reset_char_coding_default_charset() should set back the default charset
+ * iconv_codes[] sorted by cleaned name, built on first use.
+ * Entries with equal names keep their table order, so the first match wins as before.
+ */
+#define CODEPAGE_NAME_LEN 32
+
+struct codepage_name {
+  char     name[CODEPAGE_NAME_LEN];
+  unsigned index;
+};
+
+static struct codepage_name * codepage_names = NULL;
+static unsigned codepage_names_count = 0;
+static pthread_once_t codepage_names_once = PTHREAD_ONCE_INIT;
+
+/*
+ * close all cached iconv descriptors and tables.
  */
-void set_reset_to_charset(char* new_charset) {
-  reset_to_charset = new_charset;
-  reset_char_coding_default_charset();
+void char_coding_free(struct char_coding_ctx * cc) {
+  unsigned i;
+
+  if (cc == NULL)
+     return;
+  for (i = 0; i < cc->iconv_cache_count; i++) {
+      if (cc->iconv_cache[i].cd != (iconv_t)(-1))
+         iconv_close(cc->iconv_cache[i].cd);
+      }
+  for (i = 0; i < cc->byte_table_count; i++)
+      free(cc->byte_tables[i]);
+  free(cc);
 }
 
 /*
  * handle character set correctly (via glib iconv),
  * ISO/EN 300 468 annex A 
  */
-void char_coding(char **inbuf, size_t * inbytesleft, char **outbuf, size_t * outbytesleft, unsigned user_charset_id) {
-  unsigned dvb_charset_id = 9999;
+void char_coding(struct char_coding_ctx * cc, char **inbuf, size_t * inbytesleft, char **outbuf, size_t * outbytesleft,
+                 unsigned default_charset_id, unsigned user_charset_id) {
+  unsigned dvb_charset_id = ICONV_NONE;
   const char * psrc = *inbuf;
   char * pdest = *outbuf;
   size_t nsrc  = *inbytesleft;
-  size_t ndest = *outbytesleft;
   int err = 0;
+  bool euro;
 
   uint8_t first_byte_value;
 
@@ -100,21 +434,11 @@ void char_coding(char **inbuf, size_t * inbytesleft, char **outbuf, size_t * out
      // ISO/EN 300 468 v011101p, Annex A.2 Selection of character table
      *inbuf += 1; *inbytesleft -= 1; // skip over coding byte
 
-     #define DVBCHARSET(S) dvb_charset_id = get_codepage_index(S);
-
      switch (first_byte_value) {
-            case 0x1:   DVBCHARSET("ISO88595");      break; // ISO/IEC 8859-5  Latin/Cyrillic alphabet A.2
-            case 0x2:   DVBCHARSET("ISO88596");      break; // ISO/IEC 8859-6  Latin/Arabic alphabet A.3
-            case 0x3:   DVBCHARSET("ISO88597");      break; // ISO/IEC 8859-7  Latin/Greek alphabet A.4
-            case 0x4:   DVBCHARSET("ISO88598");      break; // ISO/IEC 8859-8  Latin/Hebrew alphabet A.5
-            case 0x5:   DVBCHARSET("ISO88599");      break; // ISO/IEC 8859-9  Latin alphabet No. 5 A.6
-            case 0x6:   DVBCHARSET("ISO885910");     break; // ISO/IEC 8859-10 Latin alphabet No. 6 A.7
-            case 0x7:   DVBCHARSET("ISO885911");     break; // ISO/IEC 8859-11 Latin/Thai (draft only) A.8
-            case 0x8:                                break; //                 reserved for future use (see note)
-            case 0x9:   DVBCHARSET("ISO885913");     break; // ISO/IEC 8859-13 Latin alphabet No. 7 A.9
-            case 0xA:   DVBCHARSET("ISO885914");     break; // ISO/IEC 8859-14 Latin alphabet No. 8 (Celtic) A.10
-            case 0xB:   DVBCHARSET("ISO885915");     break; // ISO/IEC 8859-15 Latin alphabet No. 9 A.11
-            case 0xC ... 0xF:                        break; //                 reserved for future use
+            case 0x1 ... 0xF:
+            case 0x11 ... 0x15:
+                        dvb_charset_id = annex_a_tables[first_byte_value];
+                        break;
             case 0x10:  {                                   // ISO/IEC 8859    See table A.4
                         uint8_t second_byte_value;
                         uint8_t third_byte_value;
@@ -122,48 +446,27 @@ void char_coding(char **inbuf, size_t * inbytesleft, char **outbuf, size_t * out
                         // the following two bytes carry a 16-bit value (uimsbf) to
                         // indicate that the remaining data of the text field is coded
                         // using the character code table specified in table A.4.
+                        if (*inbytesleft < 2)
+                           return;
                         second_byte_value = **inbuf; *inbuf += 1; *inbytesleft -= 1;
                         third_byte_value  = **inbuf; *inbuf += 1; *inbytesleft -= 1;
 
-                        switch(second_byte_value) {
-                              case 0x0:
-                                  switch(third_byte_value) {
-                                        case 0x0:                          break; // reserved for future use
-                                        case 0x1: DVBCHARSET("ISO88591");  break; // ISO/IEC 8859-1 W European
-                                        case 0x2: DVBCHARSET("ISO88592");  break; // ISO/IEC 8859-2 E European
-                                        case 0x3: DVBCHARSET("ISO88593");  break; // ISO/IEC 8859-3 S European
-                                        case 0x4: DVBCHARSET("ISO88594");  break; // ISO/IEC 8859-4 N/NE European
-                                        case 0x5: DVBCHARSET("ISO88595");  break; // ISO/IEC 8859-5 Lat./Cyrill. A.2
-                                        case 0x6: DVBCHARSET("ISO88596");  break; // ISO/IEC 8859-6 Lat./Arabic A.3
-                                        case 0x7: DVBCHARSET("ISO88597");  break; // ISO/IEC 8859-7 Lat./Greek A.4
-                                        case 0x8: DVBCHARSET("ISO88598");  break; // ISO/IEC 8859-8 Lat./Hebrew A.5
-                                        case 0x9: DVBCHARSET("ISO88599");  break; // ISO/IEC 8859-9 WE & Turk A.6
-                                        case 0xA: DVBCHARSET("ISO885910"); break; // ISO/IEC 8859-10 N European A.7
-                                        case 0xB: DVBCHARSET("ISO885911"); break; // ISO/IEC 8859-11 Thai A.8
-                                        case 0xC:                          break; // Reserved for future use
-                                        case 0xD: DVBCHARSET("ISO885913"); break; // ISO/IEC 8859-13 Baltic A.9
-                                        case 0xE: DVBCHARSET("ISO885914"); break; // ISO/IEC 8859-14 Celtic A.10
-                                        case 0xF: DVBCHARSET("ISO885915"); break; // ISO/IEC 8859-15 W European A.11
-                                        default:
-                                               warning("%s %d: unknown third byte value 0x%X\n",
-                                                               __FUNCTION__, __LINE__, third_byte_value);
-                                        }
-                                  break;
-                              default:
-                                    warning("%s %d: unknown second byte value 0x%X\n",
-                                                    __FUNCTION__, __LINE__, second_byte_value);
-                              }
+                        if (second_byte_value != 0x0)
+                           warning("%s %d: unknown second byte value 0x%X\n",
+                                           __FUNCTION__, __LINE__, second_byte_value);
+                        else if (third_byte_value > 0xF)
+                           warning("%s %d: unknown third byte value 0x%X\n",
+                                           __FUNCTION__, __LINE__, third_byte_value);
+                        else
+                           dvb_charset_id = iso8859_tables[third_byte_value];
                         break;
                         }                   
-            case 0x11:  DVBCHARSET("ISO-10646");       break; // ISO/IEC 10646   Basic Multilingual Plane
-            case 0x12:  DVBCHARSET("ISO-2022-KR");     break; // KSX1001-2004    Korean Character Set
-            case 0x13:  DVBCHARSET("GB2312");          break; // GB-2312-1980    Simplified Chinese Character
-            case 0x14:  DVBCHARSET("BIG5");            break; // Big5 subset of ISO/IEC 10646 Traditional Chinese
-            case 0x15:  DVBCHARSET("ISO-10646/UTF-8"); break; // UTF-8 encoding of ISO/IEC 10646 Basic Multil. Plane
             case 0x16 ... 0x1E:                        break; // reserved for future use
             case 0x1F:  {                                     // the following byte carries an 8-bit value (uimsbf)
                         uint8_t encoding_dvb_charset_id;      // containing the encoding_dvb_charset_id
 
+                        if (*inbytesleft < 1)
+                           return;
                         encoding_dvb_charset_id = **inbuf; *inbuf += 1; *inbytesleft -= 1;
 
                         switch(encoding_dvb_charset_id) { // TS 101 162 V1.2.1 (2009-07), 5.10 Encoding_dvb_charset_id
@@ -179,99 +482,59 @@ void char_coding(char **inbuf, size_t * inbytesleft, char **outbuf, size_t * out
                                    __FUNCTION__, __LINE__, first_byte_value);
             }
      }
-  if (dvb_charset_id > iconv_codes_count()) {
-     // no special character coding applied: use default charset (standard: iso6937 w. euro add-on)
-     char * pEuro;
-     DVBCHARSET(default_charset);
-
-     if (strcmp(default_charset,"ISO6937")==0) while (**inbuf && (pEuro = strchr(*inbuf, 0xA4))) {
-           // handle the euro add-on
-           char * ebuf = calloc(3,1);
-           char * pi = ebuf;
-           char * po = *outbuf;
-           size_t inbytes = pEuro-*inbuf;
-
-           *(pi++) = 0x0B;
-           *(pi++) = 0xA4;
-
-           verbose("\t\t%s: euro char in iso-6937\n", __FUNCTION__);
-           if (inbytes) {
-              char * ibuf = calloc(inbytes + 1, 1);
-              strncpy(ibuf, *inbuf, inbytes);
-
-              // translate *inbuf up to euro sign
-              pi = ibuf; *inbuf += inbytes; *inbytesleft -= inbytes;
-              char_coding(&pi, &inbytes, &po, outbytesleft, user_charset_id);
-              *outbuf = *outbuf + strlen(*outbuf);
-              free(ibuf);
-              }
-
-           // skip over euro sign in *inbuf
-           *inbuf += 1; *inbytesleft -= 1;
-
-           // translate euro sign to users charset and add it to *outbuf
-           inbytes = 2; pi = ebuf; po = *outbuf;
-           char_coding(&pi, &inbytes, &po, outbytesleft, user_charset_id);
-           *outbuf = *outbuf + strlen(*outbuf);
-           free(ebuf);
-           }
-     }
-
   if (! *inbytesleft || ! **inbuf)
      return;
 
-  if (user_charset_id < iconv_codes_count()) {
-     char * usr = calloc(strlen(iconv_codes[user_charset_id]) +strlen("//IGNORE") + 1, 1);
-     iconv_t conversion_descriptor;
-    
-     strcpy(usr, iconv_codes[user_charset_id]);
-     strcpy(&usr[strlen(iconv_codes[user_charset_id])], "//IGNORE");
-
-     moreverbose("\t\tconverting from '%s' to '%s'\n", iconv_codes[dvb_charset_id], usr);
-     conversion_descriptor = iconv_open((const char *) usr, iconv_codes[dvb_charset_id]);
-     free(usr);
-
-     if (conversion_descriptor == (iconv_t)(-1)) {
-        warning("\t\t%s %d: iconv_open failed.\n", __FUNCTION__, __LINE__);
-        switch(errno) {
-              case EINVAL:
-                   info("\t\tThe conversion from '%s' to '%s' is not supported.\n",
-                       iconv_codes[dvb_charset_id], iconv_codes[user_charset_id]);
-                   break;
-              default:
-                   info("\t\t%s\n", strerror(errno));
-              }
-        err++;
-        }
-     else {
-	size_t result = iconv(conversion_descriptor, inbuf, inbytesleft, outbuf, outbytesleft);
-
-        if (result == (size_t)(-1)) {
-           warning("\t\t%s %d: iconv failed.\n", __FUNCTION__, __LINE__);
-           info("\t\t%s\n", strerror(errno));
-           switch (errno) {
-                  case EILSEQ:
-                  case EINVAL:
-                       hexdump("*inbuf",  (unsigned char *) psrc,  nsrc);
-                       hexdump("*outbuf", (unsigned char *) pdest, ndest);
-                       break;
-                  default:;
-                  }
-           err++;
-           }
+  if (user_charset_id >= iconv_codes_count())
+     return;
 
-        if (iconv_close(conversion_descriptor) == -1) {
-           warning("\t\t%s %d: iconv_close failed.\n", __FUNCTION__, __LINE__);
-           info("\t\t%s\n", strerror(errno));
-           err++;
-           }
+  euro = false;
+  if (dvb_charset_id >= iconv_codes_count()) {
+     // no special character coding applied: use default charset (standard: iso6937 w. euro add-on)
+     dvb_charset_id = (default_charset_id == ICONV_NONE) ? cc->default_charset_id : default_charset_id;
+     euro = (dvb_charset_id == ICONV_ISO6937);
+     }
 
+  // fast path: single byte charsets to UTF-8 by table, without iconv.
+  if (is_utf8(cc, user_charset_id)) {
+     struct byte_table * tbl = get_byte_table(cc, dvb_charset_id, user_charset_id);
+     if (tbl && table_decode(tbl, euro, inbuf, inbytesleft, outbuf, outbytesleft)) {
         **outbuf = 0;
         return;
         }
      }
 
-  if (err) {
+  if (euro) {
+     // handle the euro add-on: 0xA4 is the euro sign, as in ISO-8859-15.
+     char * pEuro;
+     while (*inbytesleft && (pEuro = memchr(*inbuf, 0xA4, *inbytesleft))) {
+        size_t inbytes = pEuro - *inbuf;
+        char euro_sign[] = { (char) 0xA4 };
+        char * pe = euro_sign;
+        size_t ne = 1;
+
+        verbose("\t\t%s: euro char in iso-6937\n", __FUNCTION__);
+        if (inbytes) {
+           // translate *inbuf up to euro sign
+           *inbytesleft -= inbytes;
+           err += convert(cc, dvb_charset_id, user_charset_id, inbuf, &inbytes, outbuf, outbytesleft);
+           *inbytesleft += inbytes;
+           if (err < 0)
+              break;
+           }
+
+        // skip over euro sign in *inbuf and add it in users charset to *outbuf
+        *inbuf += 1; *inbytesleft -= 1;
+        err += convert(cc, ICONV_ISO_8859_15, user_charset_id, &pe, &ne, outbuf, outbytesleft);
+        if (err < 0)
+           break;
+        }
+     }
+
+  if ((err == 0) && *inbytesleft && **inbuf)
+     err += convert(cc, dvb_charset_id, user_charset_id, inbuf, inbytesleft, outbuf, outbytesleft);
+
+  if (err < 0) {
      // Fallback method: copy all printable chars from *inbuf to *outbuf.
      size_t i;
      size_t pos = 0;
@@ -288,50 +551,89 @@ void char_coding(char **inbuf, size_t * inbytesleft, char **outbuf, size_t * out
                }
          }
      *(pdest + pos++) = 0;
+     return;
      }
-
+  **outbuf = 0;
 }
 
-// clean_str: enshure upper case and remove all { '-', '_', ' ' }
-static inline void clean_str(const char * in, char * outbuf) {
-  unsigned i, pos = 0;
+static int cmp_codepage_name(const void * a, const void * b) {
+  const struct codepage_name * ca = a;
+  const struct codepage_name * cb = b;
+  int r = strcmp(ca->name, cb->name);
 
-  for (i = 0; i < strlen(in); i++) {
-      if ((in[i] == '-') ||
-          (in[i] == '_') ||
-          (in[i] == ' '))
-         continue;
-      outbuf[pos++] = toupper(in[i]);
-      }
-  outbuf[pos++] = 0;
+  if (r == 0)
+     r = (ca->index > cb->index) - (ca->index < cb->index);
+  return r;
 }
 
-int get_codepage_index(const char * codepage) {
-  unsigned i;
-  int idx = -1;
-  char * buf = strdup(codepage);
+// the Annex A ids in iconv_codes.h are fixed positions in iconv_codes[].
+static void check_iconv_code_id(unsigned id, const char * expected) {
+  char buf[CODEPAGE_NAME_LEN];
 
-  clean_str(codepage, buf);
-
-  for (i = 0; i < iconv_codes_count(); i++) {
-      char * ibuf = strdup(iconv_codes[i]);
+  clean_str(iconv_codes[id], buf);
+  if (strcmp(buf, expected))
+     fatal("iconv_codes[] out of order: %u is '%s', expected '%s'\n", id, iconv_codes[id], expected);
+}
 
-      clean_str(iconv_codes[i], ibuf);
-      if (strlen(buf) == strlen(ibuf))
-         if (! strncmp(buf, ibuf, strlen(buf))) {
-            idx = i;
-            free(ibuf);
-            break;
-            }
-      free(ibuf);
-      }
+static void build_codepage_names(void) {
+  unsigned i, count = iconv_codes_count();
+
+  check_iconv_code_id(ICONV_UTF_8,          "UTF8");
+  check_iconv_code_id(ICONV_ISO_8859_1,     "ISO88591");
+  check_iconv_code_id(ICONV_ISO_8859_2,     "ISO88592");
+  check_iconv_code_id(ICONV_ISO_8859_3,     "ISO88593");
+  check_iconv_code_id(ICONV_ISO_8859_4,     "ISO88594");
+  check_iconv_code_id(ICONV_ISO_8859_5,     "ISO88595");
+  check_iconv_code_id(ICONV_ISO_8859_6,     "ISO88596");
+  check_iconv_code_id(ICONV_ISO_8859_7,     "ISO88597");
+  check_iconv_code_id(ICONV_ISO_8859_8,     "ISO88598");
+  check_iconv_code_id(ICONV_ISO_8859_9,     "ISO88599");
+  check_iconv_code_id(ICONV_ISO_8859_10,    "ISO885910");
+  check_iconv_code_id(ICONV_ISO_8859_11,    "ISO885911");
+  check_iconv_code_id(ICONV_ISO_8859_13,    "ISO885913");
+  check_iconv_code_id(ICONV_ISO_8859_14,    "ISO885914");
+  check_iconv_code_id(ICONV_ISO_8859_15,    "ISO885915");
+  check_iconv_code_id(ICONV_ISO_10646,      "ISO10646");
+  check_iconv_code_id(ICONV_ISO_2022_KR,    "ISO2022KR");
+  check_iconv_code_id(ICONV_GB2312,         "GB2312");
+  check_iconv_code_id(ICONV_BIG_5,          "BIG5");
+  check_iconv_code_id(ICONV_ISO_10646_UTF_8,"ISO10646/UTF8");
+  check_iconv_code_id(ICONV_ISO6937,        "ISO6937");
+
+  codepage_names = calloc(count, sizeof(* codepage_names));
+  for(i = 0; i < count; i++) {
+     if (strlen(iconv_codes[i]) >= CODEPAGE_NAME_LEN)
+        fatal("iconv code name '%s' too long\n", iconv_codes[i]);
+     clean_str(iconv_codes[i], codepage_names[i].name);
+     codepage_names[i].index = i;
+     }
+  qsort(codepage_names, count, sizeof(* codepage_names), cmp_codepage_name);
+  codepage_names_count = count;
+}
 
-  free(buf);
-  if (idx < 0) {
-     warning("unknown codepage '%s', using default 'UTF-8'\n", codepage);
-     idx = get_codepage_index("UTF-8");
+int get_codepage_index(const char * codepage) {
+  char buf[256];
+  unsigned lo = 0, hi, mid;
+
+  pthread_once(&codepage_names_once, build_codepage_names);
+
+  if (strlen(codepage) < sizeof(buf)) {
+     clean_str(codepage, buf);
+     // lower bound: first entry with this name, i.e. lowest index.
+     hi = codepage_names_count;
+     while(lo < hi) {
+        mid = (lo + hi) / 2;
+        if (strcmp(codepage_names[mid].name, buf) < 0)
+           lo = mid + 1;
+        else
+           hi = mid;
+        }
+     if ((lo < codepage_names_count) && ! strcmp(codepage_names[lo].name, buf))
+        return codepage_names[lo].index;
      }
-  return idx;
+
+  warning("unknown codepage '%s', using default 'UTF-8'\n", codepage);
+  return ICONV_UTF_8;
 }
 
 int get_user_codepage(void) {
@@ -29,27 +29,33 @@ int get_user_codepage(void);
 int get_codepage_index(const char * codepage);
 
 /*
- * set the default charset that is used if a string does not include a charset definition in the first byte
+ * conversion state of one scan: the default charset and the iconv descriptors and tables
+ * cached by char_coding(). iconv descriptors must not be used by two threads at the same
+ * time, therefore each scan_context has its own.
  */
-void set_char_coding_default_charset();
+struct char_coding_ctx;
+
+struct char_coding_ctx * char_coding_new(void);
 
 /*
- * reset default charset to the reset_to_charset
+ * release the iconv descriptors and tables cached by char_coding().
  */
-void reset_char_coding_default_charset();
+void char_coding_free(struct char_coding_ctx * cc);
 
 /*
- * set the charset to which reset_char_coding_default_charset() should set back the default charset
+ * set the default charset that is used if a string does not include a charset definition in the first byte
  */
-void set_reset_to_charset(char* new_charset);
+void set_char_coding_default_charset(struct char_coding_ctx * cc, const char * charset);
 
 /*
  * handle character set correctly (via libiconv),
  * ISO/EN 300 468 annex A 
+ * default_charset_id overrides the default charset for this string, ICONV_NONE: use the one of cc.
  *
  * WARNING: do NOT pass pointers to temporarly allocated memory here, which should be freed afterwards.
  * *inbuf && *outbuf will point to *different* memory afterwards.
  */
-void char_coding(char ** inbuf, size_t * inbytesleft, char ** outbuf, size_t * outbytesleft, unsigned user_charset_id);
+void char_coding(struct char_coding_ctx * cc, char ** inbuf, size_t * inbytesleft, char ** outbuf, size_t * outbytesleft,
+                 unsigned default_charset_id, unsigned user_charset_id);
 
 #endif
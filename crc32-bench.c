@@ -0,0 +1,125 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+/* microbenchmark of the CRC-32/MPEG-2 implementations, build with 'make crc32-bench'.
+ * All implementations are first checked against crc32_mpeg_bytewise().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc32.h"
+
+#define BUF_SIZE  (1 << 20)               // many sections, more than the L2 cache
+#define MIN_BYTES (256 << 20)             // per measurement
+
+typedef uint32_t (*crc_func) (const uint8_t * buf, size_t len);
+
+static const struct {
+  const char * name;
+  crc_func     func;
+} impls[] = {
+  { "bytewise", crc32_mpeg_bytewise },
+  { "slice8",   crc32_mpeg_slice8   },
+  { "clmul",    crc32_mpeg_clmul    },
+};
+#define N_IMPLS (sizeof(impls) / sizeof(impls[0]))
+
+// typical sections: short PAT, PMT, SDT/NIT, max PSI section, max private section.
+static const size_t sizes[] = { 16, 64, 188, 1024, 4096 };
+#define N_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static bool usable(unsigned impl) {
+  return (impls[impl].func != crc32_mpeg_clmul) || crc32_have_clmul();
+}
+
+static bool verify(const uint8_t * buf) {
+  unsigned i;
+  size_t len;
+
+  for(len = 0; len <= 4096; len++) {
+     uint32_t expected = crc32_mpeg_bytewise(buf + len, len);
+     for(i = 1; i < N_IMPLS; i++) {
+        if (usable(i) && (impls[i].func(buf + len, len) != expected)) {
+           error("%s: wrong crc for %zu bytes\n", impls[i].name, len);
+           return false;
+           }
+        }
+     }
+  return crc32_mpeg((const uint8_t *) "123456789", 9) == 0x0376E6E7;
+}
+
+static double measure(crc_func func, const uint8_t * buf, size_t len) {
+  struct timespec start, stop;
+  size_t done = 0, offset = 0;
+  uint32_t sum = 0;
+
+  get_time(&start);
+  while(done < MIN_BYTES) {
+     if (offset + len > BUF_SIZE)
+        offset = 0;
+     sum += func(buf + offset, len);
+     offset += (len + 63) & ~63;
+     done += len;
+     }
+  get_time(&stop);
+  if (sum == 1)                         // keep the calls.
+     info(" ");
+  return elapsed(&start, &stop) * 1e9 / (done / len);
+}
+
+int main(int argc, char ** argv) {
+  uint8_t * buf = malloc(BUF_SIZE);
+  unsigned i, j;
+  double ns;
+
+  srand(1);
+  for(i = 0; i < BUF_SIZE; i++)
+     buf[i] = rand();
+  if (! verify(buf)) {
+     free(buf);
+     fatal("implementations differ.\n");
+     }
+
+  info("%-10s", "bytes");
+  for(j = 0; j < N_SIZES; j++)
+     info("%20zu", sizes[j]);
+  info("\n%-10s", "");
+  for(j = 0; j < N_SIZES; j++)
+     info("%20s", "ns/section  MB/s");
+  info("\n");
+  for(i = 0; i < N_IMPLS; i++) {
+     if (! usable(i))
+        continue;
+     info("%-10s", impls[i].name);
+     for(j = 0; j < N_SIZES; j++) {
+        ns = measure(impls[i].func, buf, sizes[j]);
+        info("%11.1f %7.0f", ns, sizes[j] * 1e3 / ns);
+        }
+     info("\n");
+     }
+  free(buf);
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "crc32.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define HAVE_CLMUL
+#endif
+
+#define CRC32_POLY 0x04C11DB7
+
+/* crc_table[0] is the usual table for one byte. crc_table[k][i] is the crc of byte i
+ * followed by k zero bytes, used by slice-by-8 to process 8 bytes with independent lookups.
+ * Tables, folding constants and the implementation of crc32_mpeg() are set up once by crc_init(),
+ * which may be called from several threads at the same time.
+ */
+static uint32_t crc_table[8][256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void);
+
+static void crc_init_tables(void) {
+  uint32_t accu;
+  int i, j;
+
+  for(i = 0; i < 256; i++) {
+     accu = (uint32_t) i << 24;
+     for(j = 0; j < 8; j++)
+        accu = (accu & 0x80000000) ? (accu << 1) ^ CRC32_POLY : (accu << 1);
+     crc_table[0][i] = accu;
+     }
+  for(i = 0; i < 256; i++)
+     for(j = 1; j < 8; j++)
+        crc_table[j][i] = (crc_table[j - 1][i] << 8) ^ crc_table[0][crc_table[j - 1][i] >> 24];
+}
+
+static inline uint32_t bytewise_update(uint32_t crc, const uint8_t * buf, size_t len) {
+  while(len--)
+     crc = (crc << 8) ^ crc_table[0][((crc >> 24) ^ * buf++) & 0xFF];
+  return crc;
+}
+
+static uint32_t slice8_update(uint32_t crc, const uint8_t * buf, size_t len) {
+  while(len >= 8) {
+     crc ^= (uint32_t) buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+     crc = crc_table[7][crc >> 24]          ^ crc_table[6][(crc >> 16) & 0xFF] ^
+           crc_table[5][(crc >> 8) & 0xFF]  ^ crc_table[4][crc & 0xFF]         ^
+           crc_table[3][buf[4]] ^ crc_table[2][buf[5]] ^ crc_table[1][buf[6]] ^ crc_table[0][buf[7]];
+     buf += 8;
+     len -= 8;
+     }
+  return bytewise_update(crc, buf, len);
+}
+
+uint32_t crc32_mpeg_bytewise(const uint8_t * buf, size_t len) {
+  pthread_once(&crc_once, crc_init);
+  return bytewise_update(0xFFFFFFFF, buf, len);
+}
+
+uint32_t crc32_mpeg_slice8(const uint8_t * buf, size_t len) {
+  pthread_once(&crc_once, crc_init);
+  return slice8_update(0xFFFFFFFF, buf, len);
+}
+
+#ifdef HAVE_CLMUL
+/* x^n mod P, the constants to move a 64 bit half of a block n bits further. */
+static uint64_t xn_mod_p(unsigned n) {
+  uint32_t r = 1;
+
+  while(n--)
+     r = (r & 0x80000000) ? (r << 1) ^ CRC32_POLY : (r << 1);
+  return r;
+}
+
+/* The data is seen as one polynomial, the first bit being the highest power; the initial value
+ * is xored into the first 32 bits. Blocks of 16 bytes are byte swapped, so that bit 127 is their first
+ * bit. A block X followed by n bits is replaced by X_hi * (x^(n+64) mod P) + X_lo * (x^n mod P) at the
+ * same place, which leaves the crc unchanged. Folding four blocks in parallel hides the multiply latency,
+ * the last block and the remaining bytes go through the table.
+ */
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i fold(__m128i x, __m128i k, const uint8_t * next, __m128i swap) {
+  __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+  __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+  return _mm_xor_si128(_mm_xor_si128(hi, lo), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) next), swap));
+}
+
+static uint64_t k128[2], k512[2];
+
+static void crc_init_clmul(void) {
+  k128[0] = xn_mod_p(128);  k128[1] = xn_mod_p(128 + 64);
+  k512[0] = xn_mod_p(512);  k512[1] = xn_mod_p(512 + 64);
+}
+
+__attribute__((target("pclmul,ssse3")))
+uint32_t crc32_mpeg_clmul(const uint8_t * buf, size_t len) {
+  const __m128i swap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  __m128i x0, x1, x2, x3, k;
+  uint8_t last[16];
+
+  pthread_once(&crc_once, crc_init);
+  if (len < 64)
+     return slice8_update(0xFFFFFFFF, buf, len);
+
+  x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (buf +  0)), swap);
+  x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (buf + 16)), swap);
+  x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (buf + 32)), swap);
+  x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (buf + 48)), swap);
+  x0 = _mm_xor_si128(x0, _mm_set_epi32(0xFFFFFFFF, 0, 0, 0));
+  buf += 64;
+  len -= 64;
+
+  k = _mm_set_epi64x(k512[1], k512[0]);
+  while(len >= 64) {
+     x0 = fold(x0, k, buf +  0, swap);
+     x1 = fold(x1, k, buf + 16, swap);
+     x2 = fold(x2, k, buf + 32, swap);
+     x3 = fold(x3, k, buf + 48, swap);
+     buf += 64;
+     len -= 64;
+     }
+
+  k = _mm_set_epi64x(k128[1], k128[0]);
+  x0 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x0, k, 0x11), _mm_clmulepi64_si128(x0, k, 0x00)), x1);
+  x0 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x0, k, 0x11), _mm_clmulepi64_si128(x0, k, 0x00)), x2);
+  x0 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x0, k, 0x11), _mm_clmulepi64_si128(x0, k, 0x00)), x3);
+  while(len >= 16) {
+     x0 = fold(x0, k, buf, swap);
+     buf += 16;
+     len -= 16;
+     }
+
+  _mm_storeu_si128((__m128i *) last, _mm_shuffle_epi8(x0, swap));
+  return slice8_update(slice8_update(0, last, sizeof(last)), buf, len);
+}
+
+bool crc32_have_clmul(void) {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+#else
+static void crc_init_clmul(void) {
+}
+
+uint32_t crc32_mpeg_clmul(const uint8_t * buf, size_t len) {
+  return crc32_mpeg_slice8(buf, len);
+}
+
+bool crc32_have_clmul(void) {
+  return false;
+}
+#endif
+
+static uint32_t (*crc32_impl) (const uint8_t * buf, size_t len);
+
+static void crc_init(void) {
+  crc_init_tables();
+  crc_init_clmul();
+  crc32_impl = crc32_have_clmul() ? crc32_mpeg_clmul : crc32_mpeg_slice8;
+}
+
+uint32_t crc32_mpeg(const uint8_t * buf, size_t len) {
+  pthread_once(&crc_once, crc_init);
+  return crc32_impl(buf, len);
+}
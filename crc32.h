@@ -0,0 +1,49 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#ifndef __CRC32_H__
+#define __CRC32_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tools.h"
+
+/*******************************************************************************
+/* CRC-32/MPEG-2 of PSI/SI sections, ISO/IEC 13818-1 Annex B:
+/* polynomial 0x04C11DB7, initial value 0xFFFFFFFF, not reflected, no final xor.
+ ******************************************************************************/
+
+/* the fastest implementation available on this cpu. */
+uint32_t crc32_mpeg(const uint8_t * buf, size_t len);
+
+/* the implementations; crc32_mpeg_bytewise() is the reference, one table lookup per byte.
+ * crc32_mpeg_clmul() folds 16 bytes at once with carry-less multiplication and may only be
+ * called if crc32_have_clmul() says so.
+ */
+uint32_t crc32_mpeg_bytewise(const uint8_t * buf, size_t len);
+uint32_t crc32_mpeg_slice8(const uint8_t * buf, size_t len);
+uint32_t crc32_mpeg_clmul(const uint8_t * buf, size_t len);
+bool     crc32_have_clmul(void);
+
+#endif
@@ -31,12 +31,14 @@
 #include "scan.h"
 #include "descriptors.h"
 #include "atsc_psip_section.h"
+#include "iconv_codes.h"
 #include "char-coding.h"
+#include "crc32.h"
 
 #define hd(d)  hexdump(__FUNCTION__, d + 2, d[1])
 
 /******************************************************************************
- * returns minimum repetition rates as specified in ETR211 4.4.1 and 4.4.2
+ * returns minimum repetition rates in msec as specified in ETR211 4.4.1 and 4.4.2
  * and 13818-1 C.9 Bandwidth Utilization and Signal Acquisition Time
  *****************************************************************************/
 
@@ -53,25 +55,25 @@ int repetition_rate(scantype_t scan_type, enum table_id table) {
               // see 13818-1 C.9 Bandwidth Utilization and Signal Acquisition Time
               // FIXME: i did not understand fully
               // but i seems to be (1/1 .. [1/25] .. 1/100) sec
-              // no hard spec.. :-(
-              return 1;
+              // no hard spec.. :-(  TR 101 290 1.3/1.5: PAT and PMT at least every 0.5 sec.
+              return 500;
            case TABLE_SDT_ACT:
            case TABLE_EIT_ACT:
            case TABLE_EIT_SCHEDULE_ACT_50 ... TABLE_EIT_SCHEDULE_ACT_5F:
-              return 2;
+              return 2000;
            case TABLE_NIT_ACT:
            case TABLE_NIT_OTH:
            case TABLE_BAT:
            case TABLE_SDT_OTH:
            case TABLE_EIT_OTH:
-              return 10;
+              return 10000;
            case TABLE_EIT_SCHEDULE_OTH_60 ... TABLE_EIT_SCHEDULE_OTH_60:
            case TABLE_TDT:
            case TABLE_TOT:
-              return 30;
+              return 30000;
            default:
               debug("table id 0x%.02X no repetition rate defined.\n", table);
-              return 30;
+              return 30000;
            }
         break;
      case SCAN_TERRESTRIAL:
@@ -85,26 +87,26 @@ int repetition_rate(scantype_t scan_type, enum table_id table) {
               // FIXME: i did not understand fully
               // but i seems to be (1/1 .. [1/25] .. 1/100) sec
               // no hard spec.. :-(
-              return 3; // changed 20190120 since the old value was too slow for the "Connect" channels. This can make the scan slower.
+              return 3000; // changed 20190120 since the old value was too slow for the "Connect" channels. This can make the scan slower.
            case TABLE_NIT_ACT:
            case TABLE_NIT_OTH:
            case TABLE_BAT:
            case TABLE_SDT_OTH:
            case TABLE_EIT_SCHEDULE_ACT_50 ... TABLE_EIT_SCHEDULE_ACT_5F:
-              return 12;
+              return 12000;
            case TABLE_SDT_ACT:
            case TABLE_EIT_ACT:
-              return 2;
+              return 2000;
            case TABLE_EIT_OTH:
-              return 20;
+              return 20000;
            case TABLE_EIT_SCHEDULE_OTH_60 ... TABLE_EIT_SCHEDULE_OTH_60:
-              return 60;
+              return 60000;
            case TABLE_TDT:
            case TABLE_TOT:
-              return 30;
+              return 30000;
            default:
               debug("table id 0x%.02X no repetition rate defined.\n", table);
-              return 30;
+              return 30000;
            }
         break;
      case SCAN_TERRCABLE_ATSC:
@@ -116,8 +118,8 @@ int repetition_rate(scantype_t scan_type, enum table_id table) {
               // see 13818-1 C.9 Bandwidth Utilization and Signal Acquisition Time
               // FIXME: i did not understand fully
               // but i seems to be (1/1 .. [1/25] .. 1/100) sec
-              // no hard spec.. :-(
-              return 1;
+              // no hard spec.. :-(  TR 101 290 1.3/1.5: PAT and PMT at least every 0.5 sec.
+              return 500;
            default:
               /* FIXME: i dont have *any* information about atsc
                * repetition rates. This should not break anything,
@@ -127,9 +129,9 @@ int repetition_rate(scantype_t scan_type, enum table_id table) {
                */
               debug("table id 0x%.02X no repetition rate defined.\n",
                       table);
-              return 5;
+              return 5000;
            }
-        return 5;
+        return 5000;
      default:
         fatal("undefined frontend type.\n");
      }
@@ -139,7 +141,7 @@ int repetition_rate(scantype_t scan_type, enum table_id table) {
  * 300468 v181 6.2.32 Service descriptor
  *****************************************************************************/
 
-void parse_service_descriptor (const unsigned char *buf, struct service *s, unsigned user_charset_id) {
+void parse_service_descriptor (const unsigned char *buf, struct service *s, struct char_coding_ctx * cc, unsigned user_charset_id) {
   unsigned char len;
   uint i, full_len, short_len, isUtf8;
   uint emphasis_on = 0;
@@ -150,7 +152,7 @@ void parse_service_descriptor (const unsigned char *buf, struct service *s, unsi
   size_t inbytesleft, outbytesleft;
   char * inbuf = NULL;
   char * outbuf = NULL;
-  int default_charset_reset = 0;
+  unsigned default_charset_id = ICONV_NONE;      // charset for names without charset definition, ICONV_NONE = default of cc
 
   hd(buf);
   s->type = buf[2];
@@ -159,14 +161,9 @@ void parse_service_descriptor (const unsigned char *buf, struct service *s, unsi
   len = *buf;
   buf++;
 
-  if (s->provider_name) {
-     free (s->provider_name);
-     s->provider_name = 0;
-     }
-  if (s->provider_short_name) {
-     free (s->provider_short_name);
-     s->provider_name = 0;
-     }
+  // names are owned by the transponder's arena, the old ones are released with it.
+  s->provider_name = NULL;
+  s->provider_short_name = NULL;
   full_len = short_len = emphasis_on = 0;
   isUtf8 = (*buf == 0x15); 
   /* count length for short provider name
@@ -258,11 +255,11 @@ void parse_service_descriptor (const unsigned char *buf, struct service *s, unsi
   if (provider_name[0]) {
      inbytesleft = full_len;
      outbytesleft = 4 * full_len + 1;
-     s->provider_name = (char *) calloc(outbytesleft, 1);
+     s->provider_name = (char *) tp_alloc(s->transponder, outbytesleft);
      inbuf = provider_name;
      outbuf = s->provider_name;
-     char_coding(&inbuf, &inbytesleft, &outbuf, &outbytesleft, user_charset_id);
-     if(strcmp(s->provider_name,"ORF")==0) { default_charset_reset++; set_char_coding_default_charset("ISO885915"); } // special handling for ORF 20200517
+     char_coding(cc, &inbuf, &inbytesleft, &outbuf, &outbytesleft, default_charset_id, user_charset_id);
+     if(strcmp(s->provider_name,"ORF")==0) default_charset_id = get_codepage_index("ISO885915"); // special handling for ORF 20200517
      }
 
   free(provider_name);
@@ -270,11 +267,11 @@ void parse_service_descriptor (const unsigned char *buf, struct service *s, unsi
   if (provider_short_name[0]) {
      inbytesleft = short_len;
      outbytesleft = 4 * short_len + 1;
-     s->provider_short_name = (char *) calloc(outbytesleft, 1);
+     s->provider_short_name = (char *) tp_alloc(s->transponder, outbytesleft);
      inbuf = provider_short_name;
      outbuf = s->provider_short_name;
-     char_coding(&inbuf, &inbytesleft, &outbuf, &outbytesleft, user_charset_id);
-     if(strcmp(s->provider_short_name,"ORF")==0) { default_charset_reset++; set_char_coding_default_charset("ISO885915"); } // special handling for ORF 20200517
+     char_coding(cc, &inbuf, &inbytesleft, &outbuf, &outbytesleft, default_charset_id, user_charset_id);
+     if(strcmp(s->provider_short_name,"ORF")==0) default_charset_id = get_codepage_index("ISO885915"); // special handling for ORF 20200517
      }
 
   free(provider_short_name);
@@ -282,10 +279,8 @@ void parse_service_descriptor (const unsigned char *buf, struct service *s, unsi
   buf += len;
   len = *buf;
   buf++;
-  if (s->service_name)
-     free (s->service_name);
-  if (s->service_short_name)
-     free (s->service_short_name);
+  s->service_name = NULL;
+  s->service_short_name = NULL;
   isUtf8 = (*buf == 0x15);
   /* count length for short service name
    * and long service name
@@ -377,10 +372,10 @@ void parse_service_descriptor (const unsigned char *buf, struct service *s, unsi
   if (service_name[0]) {
      inbytesleft = full_len;
      outbytesleft = 4 * full_len + 1;
-     s->service_name = (char *) calloc(outbytesleft, 1);
+     s->service_name = (char *) tp_alloc(s->transponder, outbytesleft);
      inbuf = service_name;
      outbuf = s->service_name;
-     char_coding(&inbuf, &inbytesleft, &outbuf, &outbytesleft, user_charset_id);
+     char_coding(cc, &inbuf, &inbytesleft, &outbuf, &outbytesleft, default_charset_id, user_charset_id);
      }
 
   free(service_name);
@@ -388,16 +383,15 @@ void parse_service_descriptor (const unsigned char *buf, struct service *s, unsi
   if (service_short_name[0]) {
      inbytesleft = short_len;
      outbytesleft = 4 * short_len + 1;
-     s->service_short_name = (char *) calloc(outbytesleft, 1);
+     s->service_short_name = (char *) tp_alloc(s->transponder, outbytesleft);
      inbuf = service_short_name;
      outbuf = s->service_short_name;
-     char_coding(&inbuf, &inbytesleft, &outbuf, &outbytesleft, user_charset_id);
+     char_coding(cc, &inbuf, &inbytesleft, &outbuf, &outbytesleft, default_charset_id, user_charset_id);
      }
 
   free(service_short_name);
 
   info("\tservice = %s (%s)\n", s->service_name, s->provider_name);
-  if (default_charset_reset) reset_char_coding_default_charset();
 }
 
 void parse_ca_identifier_descriptor (const unsigned char *buf, struct service *s) {
@@ -406,25 +400,19 @@ void parse_ca_identifier_descriptor (const unsigned char *buf, struct service *s
 
    buf += 2;
 
-   if (len > sizeof(s->ca_id)) {
-      len = sizeof(s->ca_id);
-      warning("too many CA system ids\n");
-      }
-   memcpy(s->ca_id, buf, len);
-   s->ca_num=0;
-   for(i = 0; i < len / sizeof(s->ca_id[0]); i++) {
-      int id = ((s->ca_id[i] & 0x00FF) << 8) + ((s->ca_id[i] & 0xFF00) >> 8);
-      s->ca_id[i] = id;
-      moreverbose("\tCA ID\t: PID 0x%04x\n", s->ca_id[i]);
-      s->ca_num++;
+   // replaces all CA system ids seen so far.
+   if (s->ca_ids)
+      s->ca_ids->count = 0;
+   for(i = 0; i + 1 < len; i += 2) {
+      int id = (buf[i] << 8) | buf[i + 1];
+      moreverbose("\tCA ID\t: PID 0x%04x\n", id);
+      add_ca_id(s, id);
       }
 }
 
 void parse_ca_descriptor (const unsigned char *buf, struct service *s) {
   unsigned char descriptor_length = buf [1];
   int CA_system_ID;
-  int found=0;
-  int i;
 
   buf += 2;
 
@@ -432,29 +420,19 @@ void parse_ca_descriptor (const unsigned char *buf, struct service *s) {
      return;
   CA_system_ID = (buf[0] << 8) | buf[1];
 
-  for(i=0; i<s->ca_num; i++)
-     if (s->ca_id[i] == CA_system_ID)
-        found++;
-
-  if (!found) {
-     if (s->ca_num + 1 >= CA_SYSTEM_ID_MAX)
-        warning("TOO MANY CA SYSTEM IDs.\n");
-     else {
-        moreverbose("\tCA ID\t: PID 0x%04x\n", CA_system_ID);
-        s->ca_id[s->ca_num]=CA_system_ID;
-        s->ca_num++;
-        }
-     }
+  if (add_ca_id(s, CA_system_ID))
+     moreverbose("\tCA ID\t: PID 0x%04x\n", CA_system_ID);
 } 
 
 void parse_iso639_language_descriptor (const unsigned char *buf, struct service *s) {
   unsigned int lang_count = buf[1] / 4;
   unsigned int i;
+  struct es_component * e = last_component(s);
   buf += 2;
-  if (s->audio_num < 1) return;
+  if ((e == NULL) || (e->kind == ES_SUBTITLE)) return;
   for(i = 0; i < lang_count; i++) {
      // ISO_639_language_code 24 bslbf
-     memcpy(s->audio_lang[s->audio_num-1], buf, 3);                
+     memcpy(e->lang, buf, 3);                
 /*   switch(buf[3]) { // audio_type 8 bslbf, seems to be wrong all over the place
         case 1: // clean effects, program element has no language
                 break;
@@ -471,22 +449,20 @@ void parse_iso639_language_descriptor (const unsigned char *buf, struct service
 
 void parse_subtitling_descriptor (const unsigned char *buf, struct service *s) {
   unsigned int N = buf[1] / 8; // descriptor_length divided by 8_bytes per subtitle
-  unsigned int i;
+  struct es_component * e = last_component(s);
   buf += 2;
 
-  if (N > SUBTITLES_MAX)
-     N = SUBTITLES_MAX;
-
-  for(i = 0; i < N; i++) {
-     memcpy(s->subtitling_lang[i], buf, 3);
-     buf += 3;
-     s->subtitling_type[i]     = buf[0];
-     buf++;
-     s->composition_page_id[i] = buf[0] << 8 | buf[1];
-     buf += 2;
-     s->ancillary_page_id[i]   = buf[0] << 8 | buf[1];
-     buf += 2;
-     }
+  // one PID may carry several languages; the component keeps the first one.
+  if ((e == NULL) || (e->kind != ES_SUBTITLE) || (N < 1))
+     return;
+
+  memcpy(e->lang, buf, 3);
+  buf += 3;
+  e->subtitling_type     = buf[0];
+  buf++;
+  e->composition_page_id = buf[0] << 8 | buf[1];
+  buf += 2;
+  e->ancillary_page_id   = buf[0] << 8 | buf[1];
 }
 
 void parse_network_name_descriptor (const unsigned char *buf, struct transponder *t) {
@@ -496,14 +472,10 @@ void parse_network_name_descriptor (const unsigned char *buf, struct transponder
      info("%s: transponder == NULL\n", __FUNCTION__);
      return;
      }
-  if (t->network_name)
-     free (t->network_name);
-  t->network_name = (char *) malloc(len + 1);
-  memcpy(t->network_name, buf + 2, len);
-  t->network_name[len] = '\0';
-  if (!t->network_name[0]) {
-     free (t->network_name);
-     t->network_name = 0;
+  t->network_name = NULL;
+  if (len && buf[2]) {
+     t->network_name = (char *) tp_alloc(t, len + 1);
+     memcpy(t->network_name, buf + 2, len);
      }
 }
 
@@ -864,7 +836,7 @@ void parse_terrestrial_delivery_system_descriptor(const unsigned char * buf,
               }
            }           
         if (! known) {
-           p = calloc(1, sizeof(*p));
+           p = tp_alloc(t, sizeof(*p));
            p->num_center_frequencies = 1;
            p->center_frequencies[0] = center_frequency;
            AddItem(t->cells, p);
@@ -960,7 +932,7 @@ void parse_frequency_list_descriptor(const unsigned char * buf, struct transpond
            }
         }           
      if (! known) {
-        p = calloc(1, sizeof(*p));
+        p = tp_alloc(t, sizeof(*p));
         p->num_center_frequencies = 1;
         p->center_frequencies[0] = f;
         AddItem(t->cells, p);
@@ -1055,10 +1027,10 @@ void parse_T2_delivery_system_descriptor(const unsigned char * buf,
      descriptor_length -= 6;                                                                         // so far, we read 6 bytes.
      bp = (unsigned char *) &buf[8];
 
-     ClearList(t->cells);
+     EmptyList(t->cells); // cells are owned by the transponder's arena.
 
      while(descriptor_length > 0) {                                                                  // for (i=0;i<N,i++) {
-        struct cell* cell = (struct cell*) calloc(1, sizeof(struct cell));
+        struct cell* cell = (struct cell*) tp_alloc(t, sizeof(struct cell));
         cell->cell_id = get_u16(bp); bp += 2; descriptor_length -= 2;                                //      cell_id 16 uimsbf
         if (t->tfs_flag > 0) {                                                                       //      if (tfs_flag == 1) {
            int frequency_loop_length = *bp++; descriptor_length--;                                   //          frequency_loop_length 8 uimsbf // 2 to 6 center freqs belonging to TFS arrangement
@@ -1203,7 +1175,9 @@ struct tm modified_julian_date_to_utc(__u32 MJD) {
   return utc;
 }
 
-void parse_network_change_notify_descriptor(const unsigned char *buf, network_change_t *nc) {
+void parse_network_change_notify_descriptor(const unsigned char *buf, struct transponder *t) {
+  network_change_t change_notify;   // t is packed, filled here and copied to t->network_change at the end.
+  network_change_t *nc = &change_notify;
   unsigned char * bp;
   int descriptor_length;
   int loop_length;
@@ -1215,10 +1189,7 @@ void parse_network_change_notify_descriptor(const unsigned char *buf, network_ch
   changed_network_t * cn;
   network_change_loop_t * change;
 
-  int v=verbosity; verbosity=5;
   hd(buf);
-  verbosity=v;
-  if (nc == NULL) return;
 
   /* calculate the time offset between local time and utc on this computer:
    * unfortunally there's no direct utc-time struct tm -> time_t conversion,
@@ -1235,7 +1206,7 @@ void parse_network_change_notify_descriptor(const unsigned char *buf, network_ch
 
   nc->num_networks = 0;
   nc->network = (changed_network_t *)
-                calloc(descriptor_length / 15, sizeof(changed_network_t));
+                tp_alloc(t, (descriptor_length / 15) * sizeof(changed_network_t));
 
   while(descriptor_length > 0) {                                            //   for (i=0;i<N;i++) {
      cn = &nc->network[nc->num_networks];                                   //                              // next changed transponder
@@ -1245,7 +1216,7 @@ void parse_network_change_notify_descriptor(const unsigned char *buf, network_ch
      loop_length = *bp;                                                     //       loop_length            8 uimsbf
      bp++; descriptor_length--;
      cn->loop = (network_change_loop_t *)
-                calloc(loop_length / 12, sizeof(network_change_loop_t));
+                tp_alloc(t, (loop_length / 12) * sizeof(network_change_loop_t));
 
      while(loop_length > 0) {                                               //       for (j=0;j<N;j++) {
         change = &cn->loop[cn->num_changes++];                              //           // next change on _this_ network
@@ -1275,12 +1246,14 @@ void parse_network_change_notify_descriptor(const unsigned char *buf, network_ch
            }                                                                //              }
         } // end: while (loop_length > 0) {                                 //           }
      } //end: while (descriptor_length > 0) {                               //   }
+  t->network_change = change_notify;
 }
 
 
 /* ATSC PSIP VCT */
 void parse_atsc_service_location_descriptor(struct service *s,const unsigned char *buf) {
   struct ATSC_service_location_descriptor d = read_ATSC_service_location_descriptor(buf);
+  struct es_component * a;
   int i;
   unsigned char *b = (unsigned char *) buf+5;
 
@@ -1293,14 +1266,11 @@ void parse_atsc_service_location_descriptor(struct service *s,const unsigned cha
            moreverbose("  VIDEO     : PID 0x%04x\n", e.elementary_PID);
            break;
         case atsc_a_52b_ac3:
-           if (s->audio_num < AUDIO_CHAN_MAX) {
-              s->audio_pid[s->audio_num] = e.elementary_PID;
-              s->audio_lang[s->audio_num][0] = (e.ISO_639_language_code >> 16) & 0xff;
-              s->audio_lang[s->audio_num][1] = (e.ISO_639_language_code >> 8)  & 0xff;
-              s->audio_lang[s->audio_num][2] =  e.ISO_639_language_code        & 0xff;
-              s->audio_num++;
-              }
-           moreverbose("\tAUDIO\t: PID 0x%04x lang: %s\n",e.elementary_PID,s->audio_lang[s->audio_num-1]);
+           a = add_component(s, ES_AUDIO, e.elementary_PID, 0);
+           a->lang[0] = (e.ISO_639_language_code >> 16) & 0xff;
+           a->lang[1] = (e.ISO_639_language_code >> 8)  & 0xff;
+           a->lang[2] =  e.ISO_639_language_code        & 0xff;
+           moreverbose("\tAUDIO\t: PID 0x%04x lang: %s\n",e.elementary_PID,a->lang);
 
            break;
         default:
@@ -1327,9 +1297,7 @@ void parse_atsc_extended_channel_name_descriptor(struct service *s, const unsign
 
         switch (compression_type) {
            case uncompressed_string:
-              if (s->service_name)
-                 free(s->service_name);
-              s->service_name = malloc(num_bytes * sizeof(char) + 1);
+              s->service_name = tp_alloc(s->transponder, num_bytes + 1);
               memcpy(s->service_name,&b[3],num_bytes);
               s->service_name[num_bytes] = '\0';
               break;
@@ -1820,31 +1788,13 @@ void parse_SH_delivery_system_descriptor (const unsigned char *buf,
          struct transponder *t, fe_spectral_inversion_t inversion){};
 #endif
 
-static __u32 crc_table[256];
-static __u8  crc_initialized = 0;
-
 int crc_check (const unsigned char * buf, __u16 len) {
-  __u16 i, j;
-  __u32 crc = 0xffffffff;
-  __u32 transmitted_crc = buf[len-4] << 24 | buf[len-3] << 16 | buf[len-2] << 8 | buf[len-1];
-
-  if (! crc_initialized) { // initialize crc lookup table before first use.
-     __u32 accu;
-     for(i = 0; i < 256; i++) {
-        accu = ((__u32) i << 24);
-        for(j = 0; j < 8; j++) {
-           if (accu & 0x80000000L)
-              accu = (accu << 1) ^ 0x04C11DB7L; // CRC32 Polynom
-           else
-              accu = (accu << 1);
-           }
-        crc_table[i] = accu;
-        }
-     crc_initialized = 1;
-     }
+  __u32 crc, transmitted_crc;
 
-  for(i = 0; i < len-4; i++)
-     crc = (crc << 8) ^ crc_table[((crc >> 24) ^ *buf++) & 0xFF];
+  if (len < 4)
+     return 0; // no room for CRC_32.
+  crc = crc32_mpeg(buf, len - 4);
+  transmitted_crc = buf[len-4] << 24 | buf[len-3] << 16 | buf[len-2] << 8 | buf[len-1];
 
   if (crc == transmitted_crc)
      return 1;
@@ -323,7 +323,9 @@ typedef struct {
 } network_change_t;
 
 int repetition_rate(scantype_t scan_type, enum table_id table);
-void parse_service_descriptor (const unsigned char *buf, struct service *s, unsigned user_charset_id);
+
+struct char_coding_ctx;
+void parse_service_descriptor (const unsigned char *buf, struct service *s, struct char_coding_ctx * cc, unsigned user_charset_id);
 void parse_ca_identifier_descriptor (const unsigned char *buf, struct service *s);
 void parse_ca_descriptor (const unsigned char *buf, struct service *s);
 void parse_iso639_language_descriptor (const unsigned char *buf, struct service *s);
@@ -343,7 +345,7 @@ void parse_T2_delivery_system_descriptor (const unsigned char *buf,
                         struct transponder *t, fe_spectral_inversion_t inversion);
 void parse_SH_delivery_system_descriptor (const unsigned char *buf,                
                         struct transponder *t, fe_spectral_inversion_t inversion);
-void parse_network_change_notify_descriptor(const unsigned char *buf, network_change_t *nc);
+void parse_network_change_notify_descriptor(const unsigned char *buf, struct transponder *t);
 void parse_logical_channel_descriptor(const unsigned char * buf, struct transponder * t);
 void parse_atsc_service_location_descriptor(struct service *s, const unsigned char *buf);
 void parse_atsc_extended_channel_name_descriptor(struct service *s, const unsigned char *buf);
@@ -30,6 +30,7 @@
 #include "scan.h"
 #include "dump-mplayer.h"
 #include "dump-xine.h"
+#include "fmt-buf.h"
 
 
 void mplayer_dump_service_parameter_set (FILE * f, 
@@ -37,37 +38,42 @@ void mplayer_dump_service_parameter_set (FILE * f,
                                 struct transponder * t,
                                 struct t2scan_flags * flags)
 {
-        int i;
+        struct es_component * e;
+        struct fmt_buf line, * b = &line;
+        int n;
 
-        fprintf (f, "%s:", s->service_name);
-        xine_dump_dvb_parameters (f, t, flags);
-        fprintf (f, ":%i:", s->video_pid);
+        fmt_init(b);
+        fmt_str (b, s->service_name);
+        fmt_char(b, ':');
+        xine_dump_dvb_parameters (b, t, flags);
+        fmt_char(b, ':');
+        fmt_int (b, s->video_pid);
+        fmt_char(b, ':');
 
         // build '+' separated list of mpeg audio and ac3 audio pids
-        if (s->audio_pid[0] || s->ac3_pid[0]) {
-
-           // prefer ac3 audio.
-           if (s->ac3_pid[0]) {
-              fprintf(f, "%i", s->ac3_pid[0]);
-              for (i = 1; i < s->ac3_num; i++) {
-                  fprintf (f, "+%i", s->ac3_pid[i]);
-                  }
-              if (s->audio_pid[0])
-                  fprintf (f, "%s", "+");
-              }
-           // standard audio pids follow.
-           if (s->audio_pid[0]) {
-              fprintf(f, "%i", s->audio_pid[0]);
-              for (i = 1; i < s->audio_num; i++) {
-                  fprintf (f, "+%i", s->audio_pid[i]);
-                  }
-              }
-           }
-
-        else
+        // prefer ac3 audio, standard audio pids follow.
+        n = 0;
+        for_each_component(s, e) {
+                if (e->kind == ES_AC3) {
+                        if (n++)
+                                fmt_char(b, '+');
+                        fmt_int (b, e->pid);
+                        }
+                }
+        for_each_component(s, e) {
+                if (e->kind == ES_AUDIO) {
+                        if (n++)
+                                fmt_char(b, '+');
+                        fmt_int (b, e->pid);
+                        }
+                }
+        if (n == 0)
            // no audio or ac3 audio pids found.
-           fprintf(f, "%i", 0);
+           fmt_char(b, '0');
 
-        fprintf (f, ":%i\n", s->service_id);
+        fmt_char(b, ':');
+        fmt_int (b, s->service_id);
+        fmt_char(b, '\n');
+        fmt_write(b, f);
+        fmt_free(b);
 }
-
@@ -30,6 +30,7 @@
 #include "scan.h"
 #include "extended_frontend.h"
 #include "dump-vdr.h"
+#include "fmt-buf.h"
 
 struct cTr {
         const char * sat_name;
@@ -201,37 +202,49 @@ const char * vdr_delsys_name(int delsys) {
  * print "frequency:<params>:symbolrate:" to 'f' in vdr >= 1.7.4 format 
  * NOTE: 1.7.0 .. 1.7.3 not supported here.
  *****************************************************************************/
-#define vdrprint(fd, Param, Default, ID, Value) if (Param != Default) fprintf(fd,"%s%s", ID, Value)
+#define vdrprint(b, Param, Default, ID, Value) if (Param != Default) { fmt_str(b, ID); fmt_str(b, Value); }
 
-void dump_param_vdr(FILE * f, struct transponder * t, struct t2scan_flags * flags) {
+static void dump_param_vdr(struct fmt_buf * b, struct transponder * t, struct t2scan_flags * flags) {
 
   switch (flags->scantype) {
         case SCAN_TERRCABLE_ATSC:
-                fprintf (f, ":%i:",   t->frequency / 1000);                
-                fprintf (f, "M%s:A:", vdr_modulation_name(t->modulation));
-                fprintf (f, "%i:",    t->symbolrate / 1000);
+                fmt_char(b, ':');
+                fmt_int (b, t->frequency / 1000);
+                fmt_str (b, ":M");
+                fmt_str (b, vdr_modulation_name(t->modulation));
+                fmt_str (b, ":A:");
+                fmt_int (b, t->symbolrate / 1000);
+                fmt_char(b, ':');
                 break;
 
         case SCAN_CABLE:
-                fprintf (f, ":%i:",   t->frequency / 1000);
-                fprintf (f, "M%s:C:", vdr_modulation_name(t->modulation));
-                fprintf (f, "%i:",    t->symbolrate / 1000);
+                fmt_char(b, ':');
+                fmt_int (b, t->frequency / 1000);
+                fmt_str (b, ":M");
+                fmt_str (b, vdr_modulation_name(t->modulation));
+                fmt_str (b, ":C:");
+                fmt_int (b, t->symbolrate / 1000);
+                fmt_char(b, ':');
                 break;
 
         case SCAN_TERRESTRIAL:
-                fprintf (f, ":%i:", t->frequency / 1000);
-                vdrprint(f, t->bandwidth                 , 0                      , "B", vdr_bandwidth_name(t->bandwidth));
-                vdrprint(f, t->coderate                  , FEC_AUTO               , "C", vdr_fec_name(t->coderate));
-                vdrprint(f, t->coderate_LP               , FEC_AUTO               , "D", vdr_fec_name(t->coderate_LP));
-                vdrprint(f, t->guard                     , GUARD_INTERVAL_AUTO    , "G", vdr_guard_name(t->guard));
-                vdrprint(f, t->inversion                 , INVERSION_AUTO         , "I", vdr_inversion_name(t->inversion));
-                vdrprint(f, t->modulation                , QAM_AUTO               , "M", vdr_modulation_name(t->modulation));
-                vdrprint(f, t->delsys                    , SYS_DVBT               , "S", vdr_delsys_name(t->delsys));
-                vdrprint(f, t->transmission              , TRANSMISSION_MODE_AUTO , "T", vdr_transmission_mode_name(t->transmission));
-                vdrprint(f, t->hierarchy                 , HIERARCHY_AUTO         , "Y", vdr_hierarchy_name(t->hierarchy));
-                if (t->delsys == SYS_DVBT2)
-                   fprintf (f, "P%d", t->plp_id);
-                fprintf (f, ":T:27500:");
+                fmt_char(b, ':');
+                fmt_int (b, t->frequency / 1000);
+                fmt_char(b, ':');
+                vdrprint(b, t->bandwidth                 , 0                      , "B", vdr_bandwidth_name(t->bandwidth));
+                vdrprint(b, t->coderate                  , FEC_AUTO               , "C", vdr_fec_name(t->coderate));
+                vdrprint(b, t->coderate_LP               , FEC_AUTO               , "D", vdr_fec_name(t->coderate_LP));
+                vdrprint(b, t->guard                     , GUARD_INTERVAL_AUTO    , "G", vdr_guard_name(t->guard));
+                vdrprint(b, t->inversion                 , INVERSION_AUTO         , "I", vdr_inversion_name(t->inversion));
+                vdrprint(b, t->modulation                , QAM_AUTO               , "M", vdr_modulation_name(t->modulation));
+                vdrprint(b, t->delsys                    , SYS_DVBT               , "S", vdr_delsys_name(t->delsys));
+                vdrprint(b, t->transmission              , TRANSMISSION_MODE_AUTO , "T", vdr_transmission_mode_name(t->transmission));
+                vdrprint(b, t->hierarchy                 , HIERARCHY_AUTO         , "Y", vdr_hierarchy_name(t->hierarchy));
+                if (t->delsys == SYS_DVBT2) {
+                   fmt_char(b, 'P');
+                   fmt_int (b, t->plp_id);
+                   }
+                fmt_str (b, ":T:27500:");
                 break;
 
         default:;
@@ -240,88 +253,117 @@ void dump_param_vdr(FILE * f, struct transponder * t, struct t2scan_flags * flag
 
 /******************************************************************************
  * print complete vdr channels.conf line from service params. 
- *
+ * The line is formatted into a buffer and written at once.
  *****************************************************************************/
 
 void vdr_dump_service_parameter_set (FILE * f,
                                 struct service * s,
                                 struct transponder * t,
                                 struct t2scan_flags * flags) {
-        int i;
+        struct es_component * e;
+        struct fmt_buf line, * b = &line;
+        int i, n;
 
         if (! flags->ca_select && s->scrambled)
                 return;
-        fprintf (f, "%s", s->service_name);
+        fmt_init(b);
+        fmt_str (b, s->service_name);
 
-        if (flags->dump_provider)
-                fprintf (f, ";%s", s->provider_name);
+        if (flags->dump_provider) {
+                fmt_char(b, ';');
+                fmt_str (b, s->provider_name ? s->provider_name : "(null)");
+                }
         
-        dump_param_vdr(f, t, flags);
+        dump_param_vdr(b, t, flags);
                 
-        fprintf (f, "%i", s->video_pid);
-
-        if (s->video_pid && (s->pcr_pid != s->video_pid))
-                fprintf (f, "+%i", s->pcr_pid);
-        if (s->video_stream_type)
-                fprintf (f, "=%u", s->video_stream_type);
-
-        fprintf (f, ":");
-
-        fprintf (f, "%i", s->audio_pid[0]);
-        if (s->audio_lang && s->audio_lang[0][0])
-                fprintf (f, "=%.4s", s->audio_lang[0]);
-        if (s->audio_stream_type[0])
-                fprintf (f, "@%u", s->audio_stream_type[0]);
-        for (i = 1; i < s->audio_num; i++) {                        
-                fprintf (f, ",%i", s->audio_pid[i]);
-                if (s->audio_lang && s->audio_lang[i][0])
-                        fprintf (f, "=%.4s", s->audio_lang[i]);
-                if (flags->vdr_version > 7)
-                        if (s->audio_stream_type[i])
-                               fprintf (f, "@%u", s->audio_stream_type[i]);
-                }
+        fmt_int (b, s->video_pid);
 
-        if (s->ac3_num) {
-                fprintf (f, "%s", ";");
-                for (i = 0; i < s->ac3_num; i++) {
-                        if (i > 0)
-                                fprintf (f, "%s", ",");
-                        fprintf (f, "%i", s->ac3_pid[i]);
-                        if (flags->vdr_version > 7)
-                                if (s->ac3_lang && s->ac3_lang[i][0])
-                                        fprintf (f, "=%.4s", s->ac3_lang[i]);
+        if (s->video_pid && (s->pcr_pid != s->video_pid)) {
+                fmt_char(b, '+');
+                fmt_int (b, s->pcr_pid);
+                }
+        if (s->video_stream_type) {
+                fmt_char(b, '=');
+                fmt_uint(b, s->video_stream_type);
+                }
 
+        fmt_char(b, ':');
+
+        // audio pids; vdr expects at least one, even if it's zero.
+        n = 0;
+        for_each_component(s, e) {
+                if (e->kind != ES_AUDIO)
+                        continue;
+                if (n)
+                        fmt_char(b, ',');
+                fmt_int (b, e->pid);
+                if (e->lang[0]) {
+                        fmt_char(b, '=');
+                        fmt_strn(b, e->lang, 4);
                         }
+                if ((n == 0) || (flags->vdr_version > 7))
+                        if (e->stream_type) {
+                               fmt_char(b, '@');
+                               fmt_uint(b, e->stream_type);
+                               }
+                n++;
+                }
+        if (n == 0)
+                fmt_char(b, '0');
+
+        n = 0;
+        for_each_component(s, e) {
+                if (e->kind != ES_AC3)
+                        continue;
+                fmt_char(b, n ? ',' : ';');
+                fmt_int (b, e->pid);
+                if (flags->vdr_version > 7)
+                        if (e->lang[0]) {
+                                fmt_char(b, '=');
+                                fmt_strn(b, e->lang, 4);
+                                }
+                n++;
                 }
 
-        fprintf (f, ":%d", s->teletext_pid);
+        fmt_char(b, ':');
+        fmt_int (b, s->teletext_pid);
 
         // add subtitling here
-        if (s->subtitling_num) {
-           fprintf (f, "%s", ";");
-           for (i = 0; i < s->subtitling_num; i++) {
-                if (i > 0)
-                        fprintf (f, "%s", ",");
-                fprintf (f, "%i", s->subtitling_pid[i]);
-                if (s->subtitling_lang && s->subtitling_lang[i][0])
-                                fprintf (f, "=%.4s", s->subtitling_lang[i]);
+        n = 0;
+        for_each_component(s, e) {
+                if (e->kind != ES_SUBTITLE)
+                        continue;
+                fmt_char(b, n ? ',' : ';');
+                fmt_int (b, e->pid);
+                if (e->lang[0]) {
+                        fmt_char(b, '=');
+                        fmt_strn(b, e->lang, 4);
+                        }
+                n++;
                 }
-           }                   
 
-        fprintf (f, ":%X", s->ca_id[0]);
-        for (i = 1; i < s->ca_num; i++) {
-                if (s->ca_id[i] == 0) continue;
-                fprintf (f, ",%X", s->ca_id[i]);
+        fmt_char(b, ':');
+        fmt_hex (b, s->ca_ids ? s->ca_ids->id[0] : 0);
+        for (i = 1; s->ca_ids && (i < s->ca_ids->count); i++) {
+                if (s->ca_ids->id[i] == 0) continue;
+                fmt_char(b, ',');
+                fmt_hex (b, s->ca_ids->id[i]);
                 }
 
-        fprintf (f, ":%d:%d:%d:0",
-                s->service_id,
-                (t->transport_stream_id > 0)?t->original_network_id:0,
-                t->transport_stream_id);
+        fmt_char(b, ':');
+        fmt_int (b, s->service_id);
+        fmt_char(b, ':');
+        fmt_int (b, (t->transport_stream_id > 0)?t->original_network_id:0);
+        fmt_char(b, ':');
+        fmt_int (b, t->transport_stream_id);
+        fmt_str (b, ":0");
 
         if (flags->print_pmt) {
-                fprintf (f, ":%d", s->pmt_pid);
+                fmt_char(b, ':');
+                fmt_int (b, s->pmt_pid);
                 }
 
-        fprintf (f, "%s", "\n");
+        fmt_char(b, '\n');
+        fmt_write(b, f);
+        fmt_free(b);
 }
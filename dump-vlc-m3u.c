@@ -30,6 +30,7 @@
 #include "extended_frontend.h"
 #include "scan.h"
 #include "dump-vlc-m3u.h"
+#include "fmt-buf.h"
 #include <iconv.h>
 #include "iconv_codes.h"
 
@@ -57,6 +58,9 @@ static int idx = 1;
 #define fprintf_tab5(v) fprintf(f, "%s%s", T5, v)
 #define fprintf_pair(p,v) fprintf(f, "%s=%c%s%c", p,34,v,34)
 
+static iconv_t latin1_cd = (iconv_t) -1;        // user charset -> ISO-8859-1, for service names
+static int latin1_from = -1;
+
 int vlc_inversion(int inversion) {
   switch(inversion) {
      case INVERSION_OFF:             return 0;
@@ -175,6 +179,10 @@ void vlc_xspf_prolog(FILE * f, uint16_t adapter, uint16_t frontend, struct t2sca
 void vlc_xspf_epilog(FILE *f) {
   fprintf_tab1("</trackList>\n");
   fprintf_tab0("</playlist>\n");
+  if (latin1_cd != (iconv_t) -1)
+     iconv_close(latin1_cd);
+  latin1_cd = (iconv_t) -1;
+  latin1_from = -1;
 }
 
 
@@ -184,67 +192,69 @@ void vlc_xspf_epilog(FILE *f) {
  * So, i try to save data in a VALID xspf syntax, but still READABLE BY VLC.
  */
 
-void vlc_dump_dvb_parameters_as_xspf (FILE * f, struct transponder * t, struct t2scan_flags * flags) {
-  fprintf (f, "%s%s",             T3, "<location>");
+static void xspf_option_int(struct fmt_buf * b, const char * name, int value) {
+  fmt_str (b, T4 "<vlc:option>");
+  fmt_str (b, name);
+  fmt_char(b, '=');
+  fmt_int (b, value);
+  fmt_str (b, "</vlc:option>\n");
+}
+
+static void xspf_option_str(struct fmt_buf * b, const char * name, const char * value) {
+  fmt_str (b, T4 "<vlc:option>");
+  fmt_str (b, name);
+  fmt_char(b, '=');
+  fmt_str (b, value);
+  fmt_str (b, "</vlc:option>\n");
+}
+
+static void xspf_location(struct fmt_buf * b, const char * delsys, int frequency) {
+  fmt_str (b, T3 "<location>");
+  fmt_str (b, delsys);
+  fmt_str (b, "://frequency=");
+  fmt_int (b, frequency);
+  fmt_str (b, "</location>\n");
+  fmt_str (b, T3 "<extension application=\"http://www.videolan.org/vlc/playlist/0\">\n");
+}
+
+static void vlc_dump_dvb_parameters_as_xspf (struct fmt_buf * b, struct transponder * t, struct t2scan_flags * flags) {
   switch (flags->scantype) {
      case SCAN_TERRCABLE_ATSC:
-        fprintf (f, "%s", "atsc://");
-        fprintf (f, "frequency=%i",             t->frequency);
-        fprintf (f, "%s\n", "</location>");
-
-        fprintf_tab3("<extension ");
-        fprintf_pair("application", "http://www.videolan.org/vlc/playlist/0");
-        fprintf_tab0(">\n");
+        xspf_location(b, "atsc", t->frequency);
         if (t->modulation != QAM_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-modulation=%s</vlc:option>\n",       T4, vlc_modulation(t->modulation));
+           xspf_option_str(b, "dvb-modulation", vlc_modulation(t->modulation));
         break;
 
      case SCAN_CABLE://<location>dvb-c:frequency=522000000:modulation=64QAM:srate=6900000</location>
-        fprintf (f, "%s://",                    vlc_delsys(t->delsys));
-        fprintf (f, "frequency=%i",             t->frequency);
-        fprintf (f, "%s\n", "</location>");
-
-        fprintf_tab3("<extension ");
-        fprintf_pair("application", "http://www.videolan.org/vlc/playlist/0");
-        fprintf_tab0(">\n");
-
-        fprintf(f, "%s<vlc:option>dvb-srate=%i</vlc:option>\n",              T4, t->symbolrate);
-        fprintf(f,"%s<vlc:option>dvb-ts-id=%i</vlc:option>\n",               T4, t->transport_stream_id);
-
+        xspf_location(b, vlc_delsys(t->delsys), t->frequency);
+        xspf_option_int(b, "dvb-srate", t->symbolrate);
+        xspf_option_int(b, "dvb-ts-id", t->transport_stream_id);
         if (t->modulation != QAM_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-modulation=%s</vlc:option>\n",       T4, vlc_modulation(t->modulation));
+           xspf_option_str(b, "dvb-modulation", vlc_modulation(t->modulation));
         if (t->inversion != INVERSION_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-inversion=%i</vlc:option>\n",        T4, vlc_inversion(t->inversion));
+           xspf_option_int(b, "dvb-inversion", vlc_inversion(t->inversion));
         break;
 
      case SCAN_TERRESTRIAL:
-        fprintf (f, "%s://",                    vlc_delsys(t->delsys));
-        fprintf (f, "frequency=%i",             t->frequency);
-        fprintf (f, "%s\n", "</location>");
-
-        fprintf_tab3("<extension ");
-        fprintf_pair("application", "http://www.videolan.org/vlc/playlist/0");
-        fprintf_tab0(">\n");
-
-        fprintf(f,"%s<vlc:option>dvb-bandwidth=%i</vlc:option>\n", T4, vlc_bandwidth(t->bandwidth));
-        fprintf(f,"%s<vlc:option>dvb-ts-id=%i</vlc:option>\n",     T4, t->transport_stream_id);
-
+        xspf_location(b, vlc_delsys(t->delsys), t->frequency);
+        xspf_option_int(b, "dvb-bandwidth", vlc_bandwidth(t->bandwidth));
+        xspf_option_int(b, "dvb-ts-id", t->transport_stream_id);
         if (t->plp_id != 0)
-           fprintf(f,"%s<vlc:option>dvb-plp-id=%i</vlc:option>\n",           T4, t->plp_id);
+           xspf_option_int(b, "dvb-plp-id", t->plp_id);
         if (t->inversion != INVERSION_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-inversion=%i</vlc:option>\n",        T4, vlc_inversion(t->inversion));
+           xspf_option_int(b, "dvb-inversion", vlc_inversion(t->inversion));
         if (t->coderate != FEC_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-code-rate-hp=%s</vlc:option>\n",     T4, vlc_fec(t->coderate));
+           xspf_option_str(b, "dvb-code-rate-hp", vlc_fec(t->coderate));
         if ((t->coderate_LP != FEC_AUTO) && (t->coderate_LP != FEC_NONE))
-           fprintf(f,"%s<vlc:option>dvb-code-rate-lp=%s</vlc:option>\n",     T4, vlc_fec(t->coderate_LP));
+           xspf_option_str(b, "dvb-code-rate-lp", vlc_fec(t->coderate_LP));
         if (t->modulation != QAM_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-modulation=%s</vlc:option>\n",       T4, vlc_modulation(t->modulation));
+           xspf_option_str(b, "dvb-modulation", vlc_modulation(t->modulation));
         if (t->transmission != TRANSMISSION_MODE_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-transmission=%i</vlc:option>\n",     T4, vlc_transmission(t->transmission));
+           xspf_option_int(b, "dvb-transmission", vlc_transmission(t->transmission));
         if (t->guard != GUARD_INTERVAL_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-guard=%s</vlc:option>\n",            T4, vlc_guard(t->guard));
+           xspf_option_str(b, "dvb-guard", vlc_guard(t->guard));
         if ((t->hierarchy != HIERARCHY_AUTO) && (t->hierarchy != HIERARCHY_NONE))
-           fprintf(f,"%s<vlc:option>dvb-hierarchy=%i</vlc:option>\n",        T4, vlc_hierarchy(t->hierarchy));
+           xspf_option_int(b, "dvb-hierarchy", vlc_hierarchy(t->hierarchy));
         break;
 
      case SCAN_SATELLITE:
@@ -256,37 +266,30 @@ void vlc_dump_dvb_parameters_as_xspf (FILE * f, struct transponder * t, struct t
          *       - obsoleting options
          *       - still NO FILE DOCUMENTATION for this dvb xspf format. :-(
          */
-        fprintf (f, "%s://",                    vlc_delsys(t->delsys));
-        fprintf (f, "frequency=%i",             t->frequency);
-        fprintf (f, "%s\n", "</location>");
-
-        fprintf_tab3("<extension ");
-        fprintf_pair("application", "http://www.videolan.org/vlc/playlist/0");
-        fprintf_tab0(">\n");
-
+        xspf_location(b, vlc_delsys(t->delsys), t->frequency);
         switch (t->polarization) {
            case POLARIZATION_HORIZONTAL:
            case POLARIZATION_CIRCULAR_LEFT:
-              fprintf(f,"%s<vlc:option>dvb-polarization=H</vlc:option>\n", T4);
+              xspf_option_str(b, "dvb-polarization", "H");
               break;
            default:
-              fprintf(f,"%s<vlc:option>dvb-polarization=V</vlc:option>\n", T4);
+              xspf_option_str(b, "dvb-polarization", "V");
               break;                                
            }
 
-        fprintf(f, "%s<vlc:option>dvb-srate=%i</vlc:option>\n",           T4, t->symbolrate);
-        fprintf(f,"%s<vlc:option>dvb-ts-id=%i</vlc:option>\n",            T4, t->transport_stream_id);
+        xspf_option_int(b, "dvb-srate", t->symbolrate);
+        xspf_option_int(b, "dvb-ts-id", t->transport_stream_id);
 
         if (t->delsys != SYS_DVBS) {
-           fprintf(f,"%s<vlc:option>dvb-modulation=%s</vlc:option>\n",    T4, vlc_modulation(t->modulation));
+           xspf_option_str(b, "dvb-modulation", vlc_modulation(t->modulation));
            if (t->rolloff != ROLLOFF_AUTO)
-              fprintf(f,"%s<vlc:option>dvb-rolloff=%i</vlc:option>\n",    T4, vlc_rolloff(t->rolloff));
+              xspf_option_int(b, "dvb-rolloff", vlc_rolloff(t->rolloff));
            }
         
         if (t->inversion != INVERSION_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-inversion=%i</vlc:option>\n",     T4, vlc_inversion(t->inversion));
+           xspf_option_int(b, "dvb-inversion", vlc_inversion(t->inversion));
         if (t->coderate != FEC_AUTO)
-           fprintf(f,"%s<vlc:option>dvb-fec=%s</vlc:option>\n",           T4, vlc_fec(t->coderate));
+           xspf_option_str(b, "dvb-fec", vlc_fec(t->coderate));
 
         break;
 
@@ -297,6 +300,64 @@ void vlc_dump_dvb_parameters_as_xspf (FILE * f, struct transponder * t, struct t
 
 
 
+/* service name, converted to ISO-8859-1 and escaped for XML. */
+static void xspf_service_name(struct fmt_buf * b, const char * name, struct t2scan_flags * flags) {
+  size_t len = strlen(name), outlen = len;
+  char latin1[len + 1];
+  char * in = (char *) name, * out = latin1;
+  const char * p1 = name;
+  size_t i;
+
+  if (latin1_from != flags->codepage) {
+     if (latin1_cd != (iconv_t) -1)
+        iconv_close(latin1_cd);
+     latin1_cd = iconv_open("ISO-8859-1", iconv_codes[flags->codepage]);
+     latin1_from = flags->codepage;
+     }
+  if (latin1_cd != (iconv_t) -1) {
+     iconv(latin1_cd, NULL, NULL, NULL, NULL);
+     if (iconv(latin1_cd, &in, &len, &out, &outlen) == (size_t) -1)
+        warning("iconv to ISO-8859-1 failed.");
+     else {
+        *out = 0;
+        p1 = latin1;
+        }
+     }
+
+  for(i = 0; p1[i]; i++) {
+     uint8_t u = (unsigned) p1[i];
+     if (u < 0x7F) {
+        if (range(u,0x09,0x09))
+           fmt_char(b, ' ');
+        else if (range(u,0x20,0x21) ||
+                 range(u,0x23,0x25) ||
+                 range(u,0x28,0x3B) ||
+                 range(u,0x3D,0x3D) ||
+                 range(u,0x3F,0x7E))
+           fmt_char(b, (char) u);
+        else if (range(u,0x22,0x22)) // double quotation mark
+           fmt_str(b, "&quot;");
+        else if (range(u,0x26,0x26)) // ampersand
+           fmt_str(b, "&amp;");
+        else if (range(u,0x27,0x27)) // apostrophe
+           fmt_str(b, "&apos;");
+        else if (range(u,0x3C,0x3C)) // less-than sign 
+           fmt_str(b, "&lt;");
+        else if (range(u,0x3E,0x3E)) // greater-than sign
+           fmt_str(b, "&gt;");
+        }
+     else {
+        // threat them as ISO8859-1: SOME HACK ANYWAY AS INPUT CHAR SET MAY BE WRONG.
+        if (u >= 0xA1) { // skip unused and NBSP: 0x7F .. 0xA0
+           // numeric character reference "&#xhhhh;"
+           fmt_str (b, "&#x00");
+           fmt_hex (b, u);
+           fmt_char(b, ';');
+           }              
+        }
+     }
+}
+
 /* TODO: THIS IS TEMPORAL && UGLY SOLUTION ONLY.
  *
  *       - REWORK LOGIC BEHIND SERVICE NAME;
@@ -308,99 +369,27 @@ void vlc_dump_dvb_parameters_as_xspf (FILE * f, struct transponder * t, struct t
  */
 void vlc_dump_service_parameter_set_as_xspf (FILE * f, struct service * s,
                                 struct transponder * t, struct t2scan_flags * flags) {
-  char buf[256];
-  int i,j,len = s->service_name? strlen(s->service_name):0;
-  if (len>0) {
-    char* service_name_codepage = strdup(s->service_name);
-    size_t service_name_outbuf_len = 3*len;
-    char* service_name_outbuf = malloc(service_name_outbuf_len*sizeof(char));
-    char* p1 = service_name_outbuf;
-    char * usr = calloc(strlen(iconv_codes[flags->codepage])+ 1, 1);
-    strcpy(usr, iconv_codes[flags->codepage]);
-    iconv_t conversion_descriptor = iconv_open("ISO-8859-1", usr);
-    free(usr);
-    if (!iconv(conversion_descriptor, &service_name_codepage, (size_t*)&len, &service_name_outbuf, &service_name_outbuf_len)) {
-      warning("iconv to ISO-8859-1 failed.");
-      p1 = s->service_name;
-    }
-    len=strlen(p1);
- 
-    for(i=0,j=0; i<len; i++) {
-       uint8_t u = (unsigned) p1[i];
-       if (u < 0x7F) {
-          if (range(u,0x09,0x09)) {
-             buf[j++]=' ';
-             }
-          else if (range(u,0x20,0x21) ||
-                   range(u,0x23,0x25) ||
-                   range(u,0x28,0x3B) ||
-                   range(u,0x3D,0x3D) ||
-                   range(u,0x3F,0x7E)) {
-             buf[j++] = (char) u;
-             }
-          else if (range(u,0x22,0x22)) { // double quotation mark
-             buf[j++]='&';
-             buf[j++]='q';
-             buf[j++]='u';
-             buf[j++]='o';
-             buf[j++]='t';
-             buf[j++]=';';
-             }
-          else if (range(u,0x26,0x26)) { // double quotation mark
-             buf[j++]='&';
-             buf[j++]='a';
-             buf[j++]='m';
-             buf[j++]='p';
-             buf[j++]=';';
-             }
-          else if (range(u,0x27,0x27)) { // apostrophe
-             buf[j++]='&';
-             buf[j++]='a';
-             buf[j++]='p';
-             buf[j++]='o';
-             buf[j++]='s';
-             buf[j++]=';';
-             }
-          else if (range(u,0x3C,0x3C)) { // less-than sign 
-             buf[j++]='&';
-             buf[j++]='l';
-             buf[j++]='t';
-             buf[j++]=';';
-             }
-          else if (range(u,0x3E,0x3E)) { // greater-than sign
-             buf[j++]='&';
-             buf[j++]='g';
-             buf[j++]='t';
-             buf[j++]=';';
-             }
-          }
-       else {
-          // threat them as ISO8859-1: SOME HACK ANYWAY AS INPUT CHAR SET MAY BE WRONG.
-          if (u >= 0xA1) { // skip unused and NBSP: 0x7F .. 0xA0
-             // numeric character reference "&#xhhhh;"
-             uint8_t ca = u >> 4;  // A .. F
-             uint8_t cb = u & 0xF; // 1 .. F
-             buf[j++]='&';
-             buf[j++]='#';
-             buf[j++]='x';
-             buf[j++]='0';
-             buf[j++]='0';
-             buf[j++]= ca < 10 ? '0' + ca : 'A' + (ca - 10);
-             buf[j++]= cb < 10 ? '0' + cb : 'A' + (cb - 10);
-             buf[j++]=';';
-             }              
-          }
-       }
-    buf[j++]=0;
-    }
-
-  fprintf_tab2("<track>\n");
-  fprintf (f, "%s%s%.4d. %s%s\n", T3, "<title>", idx++, buf, "</title>");
-
-  vlc_dump_dvb_parameters_as_xspf(f, t, flags);
-
-  fprintf (f, "%s%s%d%s\n", T4, "<vlc:id>", idx, "</vlc:id>");
-  fprintf (f, "%s%s%d%s\n", T4, "<vlc:option>program=", s->service_id, "</vlc:option>");
-  fprintf_tab3("</extension>\n");
-  fprintf_tab2("</track>\n");
+  struct fmt_buf track, * b = &track;
+
+  fmt_init(b);
+  fmt_str (b, T2 "<track>\n");
+  fmt_str (b, T3 "<title>");
+  fmt_uint_digits(b, idx++, 4);
+  fmt_str (b, ". ");
+  if (s->service_name)
+     xspf_service_name(b, s->service_name, flags);
+  fmt_str (b, "</title>\n");
+
+  vlc_dump_dvb_parameters_as_xspf(b, t, flags);
+
+  fmt_str (b, T4 "<vlc:id>");
+  fmt_int (b, idx);
+  fmt_str (b, "</vlc:id>\n");
+  fmt_str (b, T4 "<vlc:option>program=");
+  fmt_int (b, s->service_id);
+  fmt_str (b, "</vlc:option>\n");
+  fmt_str (b, T3 "</extension>\n");
+  fmt_str (b, T2 "</track>\n");
+  fmt_write(b, f);
+  fmt_free(b);
 }
@@ -29,6 +29,7 @@
 #include "extended_frontend.h"
 #include "scan.h"
 #include "dump-xine.h"
+#include "fmt-buf.h"
 #include "tools.h"
 
 
@@ -44,54 +45,68 @@ const char * xine_bandwidth_name (int bandwidth) {
      }                         
 }
 
-void xine_dump_dvb_parameters (FILE * f, struct transponder * t, struct t2scan_flags * flags)
+void xine_dump_dvb_parameters (struct fmt_buf * b, struct transponder * t, struct t2scan_flags * flags)
 {
 
         switch (flags->scantype) {
         case SCAN_TERRCABLE_ATSC:
-                fprintf (f, "%i:", t->frequency);
-                fprintf (f, "%s",  modulation_name(t->modulation));
+                fmt_int (b, t->frequency);
+                fmt_char(b, ':');
+                fmt_str (b, modulation_name(t->modulation));
                 break;
         case SCAN_CABLE:
-                fprintf (f, "%i:", t->frequency);
-                fprintf (f, "%s:", inversion_name(t->inversion));
-                fprintf (f, "%i:", t->symbolrate);
-                fprintf (f, "%s:", coderate_name(t->coderate));
-                fprintf (f, "%s",  modulation_name(t->modulation));
+                fmt_int (b, t->frequency);
+                fmt_char(b, ':');
+                fmt_str (b, inversion_name(t->inversion));
+                fmt_char(b, ':');
+                fmt_int (b, t->symbolrate);
+                fmt_char(b, ':');
+                fmt_str (b, coderate_name(t->coderate));
+                fmt_char(b, ':');
+                fmt_str (b, modulation_name(t->modulation));
                 break;
         case SCAN_TERRESTRIAL:
-                fprintf (f, "%i:", t->frequency);
-                fprintf (f, "%s:", inversion_name(t->inversion));
-                fprintf (f, "%s:", xine_bandwidth_name(t->bandwidth));
-                fprintf (f, "%s:", coderate_name(t->coderate));
-                fprintf (f, "%s:", coderate_name(t->coderate_LP));
-                fprintf (f, "%s:", modulation_name(t->modulation));
-                fprintf (f, "%s:", transmission_mode_name(t->transmission));
-                fprintf (f, "%s:", guard_interval_name(t->guard));
-                fprintf (f, "%s",  hierarchy_name(t->hierarchy));
+                fmt_int (b, t->frequency);
+                fmt_char(b, ':');
+                fmt_str (b, inversion_name(t->inversion));
+                fmt_char(b, ':');
+                fmt_str (b, xine_bandwidth_name(t->bandwidth));
+                fmt_char(b, ':');
+                fmt_str (b, coderate_name(t->coderate));
+                fmt_char(b, ':');
+                fmt_str (b, coderate_name(t->coderate_LP));
+                fmt_char(b, ':');
+                fmt_str (b, modulation_name(t->modulation));
+                fmt_char(b, ':');
+                fmt_str (b, transmission_mode_name(t->transmission));
+                fmt_char(b, ':');
+                fmt_str (b, guard_interval_name(t->guard));
+                fmt_char(b, ':');
+                fmt_str (b, hierarchy_name(t->hierarchy));
                 break;
         case SCAN_SATELLITE:
-                fprintf (f, "%i:", t->frequency / 1000);
+                fmt_int (b, t->frequency / 1000);
+                fmt_char(b, ':');
                 switch (t->polarization) {
                         case POLARIZATION_HORIZONTAL:
-                                fprintf (f, "h:");
+                                fmt_str(b, "h:");
                                 break;
                         case POLARIZATION_VERTICAL:
-                                fprintf (f, "v:");
+                                fmt_str(b, "v:");
                                 break;
                         case POLARIZATION_CIRCULAR_LEFT:
-                                fprintf (f, "l:");
+                                fmt_str(b, "l:");
                                 break;
                         case POLARIZATION_CIRCULAR_RIGHT:
-                                fprintf (f, "r:");
+                                fmt_str(b, "r:");
                                 break;
                         default:
                                 fatal("Unknown Polarization %d\n", t->polarization);
                         }
 
-                fprintf (f, "0:");
+                fmt_str (b, "0:");
 
-                fprintf (f, "%i", t->symbolrate / 1000);
+                fmt_int (b, t->symbolrate / 1000);
                 break;
         default:
                 fatal("Unknown scantype %d\n", flags->scantype);
@@ -103,14 +118,31 @@ void xine_dump_service_parameter_set (FILE * f,
                                 struct transponder * t,
                                 struct t2scan_flags * flags)
 {
-        if (s->video_pid || s->audio_pid[0] || s->ac3_pid[0]) {
-                if (s->provider_name)
-                        fprintf (f, "%s(%s):", s->service_name, s->provider_name);
-                else
-                        fprintf (f, "%s:", s->service_name);
-                xine_dump_dvb_parameters (f, t, flags);
-                fprintf (f, ":%i:%i:%i", s->video_pid, s->ac3_pid[0]?s->ac3_pid[0]:s->audio_pid[0], s->service_id);
+        struct es_component * audio = first_component(s, ES_AC3);
+        struct fmt_buf line, * b = &line;
+
+        // prefer ac3 audio.
+        if (audio == NULL)
+                audio = first_component(s, ES_AUDIO);
+        if (s->video_pid || audio) {
+                fmt_init(b);
+                fmt_str (b, s->service_name);
+                if (s->provider_name) {
+                        fmt_char(b, '(');
+                        fmt_str (b, s->provider_name);
+                        fmt_char(b, ')');
+                        }
+                fmt_char(b, ':');
+                xine_dump_dvb_parameters (b, t, flags);
+                fmt_char(b, ':');
+                fmt_int (b, s->video_pid);
+                fmt_char(b, ':');
+                fmt_int (b, audio ? audio->pid : 0);
+                fmt_char(b, ':');
+                fmt_int (b, s->service_id);
                 /* what about AC3 audio here && multiple audio pids? see also: dump_mplayer.c/h */
-                fprintf (f, "\n");
+                fmt_char(b, '\n');
+                fmt_write(b, f);
+                fmt_free(b);
                 }
 }
@@ -31,8 +31,9 @@
 #include "extended_frontend.h"
 #include "si_types.h"
 #include "scan.h"
+#include "fmt-buf.h"
 
-void xine_dump_dvb_parameters (FILE * f, struct transponder * t, struct t2scan_flags * flags);
+void xine_dump_dvb_parameters (struct fmt_buf * b, struct transponder * t, struct t2scan_flags * flags);
 
 void xine_dump_service_parameter_set (FILE * f,
                                 struct service * s,
@@ -28,6 +28,7 @@
 
 #include "si_types.h"
 #include "dump-xml.h"
+#include "fmt-buf.h"
 
 typedef struct {
   char    name[32];
@@ -162,16 +163,41 @@ static bool want_to_print(const char * param, uint8_t delsys, uint16_t value) {
 
 #define needs_param(p) (want_to_print(#p, t->delsys, t->p))
 
+#define MAX_INDENT 16
+
+// three spaces per level.
 static const char * get_indent(int indent) {
-  static char buf[256];
-  memset(&buf[0], ' ', 255);
-  buf[255] = 0;
-  buf[3*indent] = 0;
-  return &buf[0];
+  static const char spaces[3 * MAX_INDENT + 1] =
+     "                                                ";
+  if (indent > MAX_INDENT)
+     indent = MAX_INDENT;
+  return spaces + 3 * (MAX_INDENT - indent);
 }
 
-void xml_dump(FILE * dest, pList transponders) {
-  struct transponder * t;
+static void xml_line(struct fmt_buf * b, int indent, const char * s) {
+  fmt_repeat(b, ' ', 3 * indent);
+  fmt_str(b, s);
+}
+
+static void xml_param_str(struct fmt_buf * b, int indent, const char * name, const char * value) {
+  fmt_repeat(b, ' ', 3 * indent);
+  fmt_str (b, "<param ");
+  fmt_str (b, name);
+  fmt_str (b, "=\"");
+  fmt_str (b, value);
+  fmt_str (b, "\"/>\n");
+}
+
+static void xml_param_int(struct fmt_buf * b, int indent, const char * name, int value) {
+  fmt_repeat(b, ' ', 3 * indent);
+  fmt_str (b, "<param ");
+  fmt_str (b, name);
+  fmt_str (b, "=\"");
+  fmt_int (b, value);
+  fmt_str (b, "\"/>\n");
+}
+
+void xml_prolog(FILE * dest) {
   int indent = 0;
 
   fprintf(dest, "<?xml version=\"1.0\" ?>\n");
@@ -188,91 +214,106 @@ void xml_dump(FILE * dest, pList transponders) {
 
   indent++;
   fprintf(dest, "%s<transponders>\n", get_indent(indent));  
-  for(t = transponders->first; t; t = t->next) {
-     indent++;
-     fprintf(dest, "%s<transponder ONID=\"%d\" NID=\"%d\" TSID=\"%d\">\n",
-            get_indent(indent),
-            t->original_network_id,
-            t->network_id,
-            t->transport_stream_id
-            );
-     indent++;
-     fprintf(dest, "%s<params delsys=\"%s\" center_frequency=\"%.3f\">\n",
-            get_indent(indent), delivery_system_name(t->delsys), (double) t->frequency/1e6);
-     indent++;
-
-     switch(t->delsys) {
-        case SYS_DVBT:
-        case SYS_DVBT2:
-           {
-           if needs_param(modulation)
-              fprintf(dest, "%s<param modulation=\"%s\"/>\n", get_indent(indent), modulation_name(t->modulation));            
-           if needs_param(bandwidth)
-              fprintf(dest, "%s<param bandwidth=\"%.3f\"/>\n", get_indent(indent), (double) t->bandwidth/1e6);  
-           if needs_param(coderate)
-              fprintf(dest, "%s<param coderate=\"%s\"/>\n", get_indent(indent), coderate_name(t->coderate)); 
-           if needs_param(transmission)
-              fprintf(dest, "%s<param transmission=\"%s\"/>\n", get_indent(indent), transmission_mode_name(t->transmission)); 
-           if needs_param(guard)
-              fprintf(dest, "%s<param guard=\"%s\"/>\n", get_indent(indent), guard_interval_name(t->guard)); 
-           if (t->hierarchy != HIERARCHY_NONE) {
-              // print those only if hierarchy is used.
-              if needs_param(hierarchy)
-                 fprintf(dest, "%s<param hierarchy=\"%s\"/>\n", get_indent(indent), hierarchy_name(t->hierarchy));
-              if needs_param(alpha)
-                 fprintf(dest, "%s<param alpha=\"%s\"/>\n", get_indent(indent), alpha_name(t->alpha));
-              if needs_param(terr_interleaver)
-                 fprintf(dest, "%s<param terr_interleaver=\"%s\"/>\n", get_indent(indent), interleaver_name(t->terr_interleaver));
-              if needs_param(coderate_LP)
-                 fprintf(dest, "%s<param coderate_LP=\"%s\"/>\n", get_indent(indent), coderate_name(t->coderate_LP));
-              if needs_param(priority)
-                 fprintf(dest, "%s<param priority=\"%s\"/>\n", get_indent(indent), bool_name(t->priority));
-              }
-           if needs_param(mpe_fec)
-              fprintf(dest, "%s<param mpe_fec=\"%s\"/>\n", get_indent(indent), bool_name(t->mpe_fec));
-           if needs_param(time_slicing)
-              fprintf(dest, "%s<param time_slicing=\"%s\"/>\n", get_indent(indent), bool_name(t->time_slicing)); 
-           if needs_param(system_id)
-              fprintf(dest, "%s<param system_id=\"%d\"/>\n", get_indent(indent), t->system_id);
-           if needs_param(plp_id)
-              fprintf(dest, "%s<param plp_id=\"%d\"/>\n", get_indent(indent), t->plp_id); 
-           if ((t->other_frequency_flag != false) && ((t->cells)->count > 0)) {
-              struct cell* f;
-              if needs_param(other_frequency_flag) {
-                 fprintf(dest, "%s<param other_frequency_flag=\"%s\"/>\n", get_indent(indent), bool_name(true));
-                 fprintf(dest, "%s<frequency_list>\n", get_indent(indent));
-                 indent++;
-                 for(f = t->cells->first; f; f = f->next) {
-                    if (t->tfs_flag) {
-                       fprintf(dest, "%s<tfs_center>\n", get_indent(indent));
-                       
-                       }
-                    else {
-                       //for(g = f->transposers->first; g; g = g->next) {
-                       //   }
-                       }
-                    }
+}
+
+void xml_dump_transponder(FILE * dest, struct transponder * t) {
+  struct fmt_buf rec, * b = &rec;
+  int indent = 2;
 
-                 indent--;
-                 fprintf(dest, "%s</frequency_list>\n", get_indent(indent));
+  fmt_init(b);
+  fmt_repeat(b, ' ', 3 * indent);
+  fmt_str (b, "<transponder ONID=\"");
+  fmt_int (b, t->original_network_id);
+  fmt_str (b, "\" NID=\"");
+  fmt_int (b, t->network_id);
+  fmt_str (b, "\" TSID=\"");
+  fmt_int (b, t->transport_stream_id);
+  fmt_str (b, "\">\n");
+  indent++;
+  fmt_repeat(b, ' ', 3 * indent);
+  fmt_printf(b, "<params delsys=\"%s\" center_frequency=\"%.3f\">\n",
+         delivery_system_name(t->delsys), (double) t->frequency/1e6);
+  indent++;
+
+  switch(t->delsys) {
+     case SYS_DVBT:
+     case SYS_DVBT2:
+        {
+        if needs_param(modulation)
+           xml_param_str(b, indent, "modulation", modulation_name(t->modulation));            
+        if needs_param(bandwidth) {
+           fmt_repeat(b, ' ', 3 * indent);
+           fmt_printf(b, "<param bandwidth=\"%.3f\"/>\n", (double) t->bandwidth/1e6);  
+           }
+        if needs_param(coderate)
+           xml_param_str(b, indent, "coderate", coderate_name(t->coderate)); 
+        if needs_param(transmission)
+           xml_param_str(b, indent, "transmission", transmission_mode_name(t->transmission)); 
+        if needs_param(guard)
+           xml_param_str(b, indent, "guard", guard_interval_name(t->guard)); 
+        if (t->hierarchy != HIERARCHY_NONE) {
+           // print those only if hierarchy is used.
+           if needs_param(hierarchy)
+              xml_param_str(b, indent, "hierarchy", hierarchy_name(t->hierarchy));
+           if needs_param(alpha)
+              xml_param_str(b, indent, "alpha", alpha_name(t->alpha));
+           if needs_param(terr_interleaver)
+              xml_param_str(b, indent, "terr_interleaver", interleaver_name(t->terr_interleaver));
+           if needs_param(coderate_LP)
+              xml_param_str(b, indent, "coderate_LP", coderate_name(t->coderate_LP));
+           if needs_param(priority)
+              xml_param_str(b, indent, "priority", bool_name(t->priority));
+           }
+        if needs_param(mpe_fec)
+           xml_param_str(b, indent, "mpe_fec", bool_name(t->mpe_fec));
+        if needs_param(time_slicing)
+           xml_param_str(b, indent, "time_slicing", bool_name(t->time_slicing)); 
+        if needs_param(system_id)
+           xml_param_int(b, indent, "system_id", t->system_id);
+        if needs_param(plp_id)
+           xml_param_int(b, indent, "plp_id", t->plp_id); 
+        if ((t->other_frequency_flag != false) && ((t->cells)->count > 0)) {
+           struct cell* f;
+           if needs_param(other_frequency_flag) {
+              xml_param_str(b, indent, "other_frequency_flag", bool_name(true));
+              xml_line(b, indent, "<frequency_list>\n");
+              indent++;
+              for(f = t->cells->first; f; f = f->next) {
+                 if (t->tfs_flag) {
+                    xml_line(b, indent, "<tfs_center>\n");
+                    
+                    }
+                 else {
+                    //for(g = f->transposers->first; g; g = g->next) {
+                    //   }
+                    }
                  }
+
+              indent--;
+              xml_line(b, indent, "</frequency_list>\n");
               }
-           break;
            }
-        default:
-           fatal("unimplemented delivery system \"%s\"for w_scan XML output\n",
-                 delivery_system_name(t->delsys));
+        break;
+        }
+     default:
+        fatal("unimplemented delivery system \"%s\"for w_scan XML output\n",
+              delivery_system_name(t->delsys));
 
-        } 
+     } 
 
 
 
-     indent--;     
-     fprintf(dest, "%s</params>\n", get_indent(indent));
-     indent--;
-     fprintf(dest, "%s</transponder>\n", get_indent(indent));
-     indent--;
-     }
+  indent--;     
+  xml_line(b, indent, "</params>\n");
+  indent--;
+  xml_line(b, indent, "</transponder>\n");
+  fmt_write(b, dest);
+  fmt_free(b);
+}
+
+void xml_epilog(FILE * dest) {
+  int indent = 1;
+
   fprintf(dest, "%s</transponders>\n", get_indent(indent));
   indent--;
 
@@ -315,3 +356,12 @@ void xml_dump(FILE * dest, pList transponders) {
 */
 
 }
+
+void xml_dump(FILE * dest, pList transponders) {
+  struct transponder * t;
+
+  xml_prolog(dest);
+  for(t = transponders->first; t; t = t->next)
+     xml_dump_transponder(dest, t);
+  xml_epilog(dest);
+}
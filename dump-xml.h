@@ -28,6 +28,13 @@
 #include <stdio.h>
 #include "tools.h"
 
+#include "si_types.h"
+
 void xml_dump(FILE * dest, pList transponders);
 
+/* xml_dump() in parts, for writing transponders as soon as they are scanned. */
+void xml_prolog(FILE * dest);
+void xml_dump_transponder(FILE * dest, struct transponder * t);
+void xml_epilog(FILE * dest);
+
 #endif
@@ -100,11 +100,11 @@ static struct {
 static int parse_logfile(const char * log);
 
 // Declare parse_xyz in scan.h? Hmm..
-extern void parse_pat     (const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id, uint32_t flags);
-extern void parse_pmt     (const unsigned char * buf, uint16_t section_length, uint16_t service_id);
-extern void parse_nit     (const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t network_id, uint32_t section_flags);
-extern void parse_sdt     (const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id);
-extern void parse_psip_vct(const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t transport_stream_id); 
+extern void parse_pat     (struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id, uint32_t section_flags);
+extern void parse_pmt     (struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint16_t service_id);
+extern void parse_nit     (struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t network_id, uint32_t section_flags);
+extern void parse_sdt     (struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id);
+extern void parse_psip_vct(struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t transport_stream_id); 
 
 
  /*
@@ -358,7 +358,7 @@ void em_addfilter(struct section_buf * s) {
   AddItem(em_runningfilters, s);
 }
 
-void em_readfilters(int * result) {
+void em_readfilters(struct scan_context * ctx, int * result) {
   sidata_t * sidata;
   struct section_buf * filter;
   int maxiter = 10000;
@@ -391,25 +391,25 @@ void em_readfilters(int * result) {
         data_found = true;
 
         switch(filter->table_id) {
-           case TABLE_PAT:       parse_pat(sidata->buf, sidata->len, sidata->transport_stream_id, filter->flags);
+           case TABLE_PAT:       parse_pat(ctx, sidata->buf, sidata->len, sidata->transport_stream_id, filter->flags);
                                  break;
            case TABLE_NIT_ACT:
-           case TABLE_NIT_OTH:   parse_nit(sidata->buf, sidata->len, filter->table_id, sidata->network_id, filter->flags);
+           case TABLE_NIT_OTH:   parse_nit(ctx, sidata->buf, sidata->len, filter->table_id, sidata->network_id, filter->flags);
                                  break;
            case TABLE_PMT:       verbose("PMT %d (0x%04x) for service %d (0x%04x)\n",
                                          sidata->pid, sidata->pid, sidata->service_id, sidata->service_id);
-                                 parse_pmt(sidata->buf, sidata->len, sidata->service_id);
+                                 parse_pmt(ctx, sidata->buf, sidata->len, sidata->service_id);
                                  break;
            case TABLE_SDT_ACT:   
            case TABLE_SDT_OTH:   verbose("SDT(%s TS, transport_stream_id %d (0x%04x) )\n",
                                          filter->table_id == 0x42 ? "actual":"other",
                                          sidata->transport_stream_id, sidata->transport_stream_id);
-                                 parse_sdt(sidata->buf, sidata->len, sidata->transport_stream_id);
+                                 parse_sdt(ctx, sidata->buf, sidata->len, sidata->transport_stream_id);
                                  break;
            case TABLE_VCT_TERR:  
            case TABLE_VCT_CABLE: verbose("ATSC VCT, table_id %d, table_id_ext %d\n",
                                          sidata->table_id, sidata->table_id_ext);
-                                 parse_psip_vct(sidata->buf, sidata->len, filter->table_id, sidata->table_id_ext);
+                                 parse_psip_vct(ctx, sidata->buf, sidata->len, filter->table_id, sidata->table_id_ext);
                                  break;           
            default:              fatal("%s %d: unhandled table_id %d\n", __FUNCTION__, __LINE__, filter->table_id);
            }
@@ -428,13 +428,15 @@ void em_readfilters(int * result) {
            case TABLE_SDT_ACT:
            case TABLE_SDT_OTH:
            case TABLE_VCT_TERR:
-           case TABLE_VCT_CABLE: info("%s%s after %lld seconds\n", intro, table_name(filter->table_id), (long long) filter->timeout);
+           case TABLE_VCT_CABLE: info("%s%s after %.1f seconds\n", intro, table_name(filter->table_id), filter->timeout / 1000.0);
                                  break;
-           default:              info("%spid %u after %lld seconds\n", intro, filter->pid, (long long) filter->timeout);
+           default:              info("%spid %u after %.1f seconds\n", intro, filter->pid, filter->timeout / 1000.0);
            }
         *result = 0;
         }
-     UnlinkItem(em_runningfilters, filter, filter->flags & SECTION_FLAG_FREE ? true:false);    
+     UnlinkItem(em_runningfilters, filter, false);
+     if (filter->flags & SECTION_FLAG_FREE)
+        free_section_buf(ctx, filter);
      }
   *result = 1;
   return;
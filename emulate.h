@@ -9,6 +9,8 @@
 #include <linux/dvb/frontend.h>
 #include "si_types.h"
 
+struct scan_context;
+
 
 void em_init(const char * log); 
 void em_open(int * frontend_fd);
@@ -22,6 +24,6 @@ void em_polarization(uint8_t p);
 
 //--------------------------------------------------
 void em_addfilter(struct section_buf * s);
-void em_readfilters(int * result);
+void em_readfilters(struct scan_context * ctx, int * result);
 
 #endif
@@ -0,0 +1,165 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "fmt-buf.h"
+#include "tools.h"
+
+void fmt_init(struct fmt_buf * b) {
+  b->data = b->space;
+  b->len = 0;
+  b->size = sizeof(b->space);
+}
+
+void fmt_free(struct fmt_buf * b) {
+  if (b->data != b->space)
+     free(b->data);
+  fmt_init(b);
+}
+
+// room for at least n more bytes.
+static void reserve(struct fmt_buf * b, size_t n) {
+  size_t size = b->size;
+  char * p;
+
+  if (b->len + n <= b->size)
+     return;
+  while(size < b->len + n)
+     size *= 2;
+  if (b->data == b->space) {
+     if ((p = malloc(size)) != NULL)
+        memcpy(p, b->data, b->len);
+     }
+  else
+     p = realloc(b->data, size);
+  if (p == NULL)
+     fatal("out of memory\n");
+  b->data = p;
+  b->size = size;
+}
+
+int fmt_write(struct fmt_buf * b, FILE * f) {
+  size_t len = b->len;
+
+  b->len = 0;
+  if (len == 0)
+     return 0;
+  return fwrite(b->data, 1, len, f) == len ? 0 : -1;
+}
+
+void fmt_char(struct fmt_buf * b, char c) {
+  reserve(b, 1);
+  b->data[b->len++] = c;
+}
+
+void fmt_str(struct fmt_buf * b, const char * s) {
+  size_t n = strlen(s);
+
+  reserve(b, n);
+  memcpy(b->data + b->len, s, n);
+  b->len += n;
+}
+
+void fmt_strn(struct fmt_buf * b, const char * s, size_t max) {
+  size_t n = strnlen(s, max);
+
+  reserve(b, n);
+  memcpy(b->data + b->len, s, n);
+  b->len += n;
+}
+
+void fmt_uint_digits(struct fmt_buf * b, unsigned long v, int digits) {
+  char tmp[24];
+  int n = 0;
+
+  do {
+     tmp[sizeof(tmp) - ++n] = '0' + (v % 10);
+     v /= 10;
+     } while(v);
+  while((n < digits) && (n < (int) sizeof(tmp)))
+     tmp[sizeof(tmp) - ++n] = '0';
+  reserve(b, n);
+  memcpy(b->data + b->len, tmp + sizeof(tmp) - n, n);
+  b->len += n;
+}
+
+void fmt_uint(struct fmt_buf * b, unsigned long v) {
+  if (v < 10) {
+     fmt_char(b, '0' + v);
+     return;
+     }
+  fmt_uint_digits(b, v, 1);
+}
+
+void fmt_int(struct fmt_buf * b, long v) {
+  if (v < 0) {
+     fmt_char(b, '-');
+     fmt_uint(b, - (unsigned long) v);
+     return;
+     }
+  fmt_uint(b, v);
+}
+
+void fmt_hex(struct fmt_buf * b, unsigned long v) {
+  static const char hex[] = "0123456789ABCDEF";
+  char tmp[16];
+  int n = 0;
+
+  do {
+     tmp[sizeof(tmp) - ++n] = hex[v & 0xF];
+     v >>= 4;
+     } while(v);
+  reserve(b, n);
+  memcpy(b->data + b->len, tmp + sizeof(tmp) - n, n);
+  b->len += n;
+}
+
+void fmt_repeat(struct fmt_buf * b, char c, int count) {
+  if (count <= 0)
+     return;
+  reserve(b, count);
+  memset(b->data + b->len, c, count);
+  b->len += count;
+}
+
+void fmt_printf(struct fmt_buf * b, const char * fmt, ...) {
+  va_list args;
+  int n;
+
+  va_start(args, fmt);
+  n = vsnprintf(b->data + b->len, b->size - b->len, fmt, args);
+  va_end(args);
+  if (n < 0)
+     return;
+  if ((size_t) n >= b->size - b->len) {
+     reserve(b, n + 1);
+     va_start(args, fmt);
+     vsnprintf(b->data + b->len, b->size - b->len, fmt, args);
+     va_end(args);
+     }
+  b->len += n;
+}
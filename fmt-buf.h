@@ -0,0 +1,60 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#ifndef __FMT_BUF_H__
+#define __FMT_BUF_H__
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*******************************************************************************
+/* output records for the dump writers: each record (i.e. one channels.conf line)
+ * is formatted into a buffer and written with one fwrite().
+ * The buffer starts in 'space' and moves to the heap only for very long records.
+ ******************************************************************************/
+
+struct fmt_buf {
+  char * data;
+  size_t len;
+  size_t size;
+  char   space[512];
+};
+
+void fmt_init(struct fmt_buf * b);
+void fmt_free(struct fmt_buf * b);
+
+/* writes the record to f and empties the buffer for the next one. returns 0 on success. */
+int  fmt_write(struct fmt_buf * b, FILE * f);
+
+void fmt_char(struct fmt_buf * b, char c);
+void fmt_str(struct fmt_buf * b, const char * s);
+void fmt_strn(struct fmt_buf * b, const char * s, size_t max);       // like "%.*s"
+void fmt_uint(struct fmt_buf * b, unsigned long v);                  // like "%lu"
+void fmt_int(struct fmt_buf * b, long v);                            // like "%ld"
+void fmt_uint_digits(struct fmt_buf * b, unsigned long v, int digits); // like "%.*lu", zero padded
+void fmt_hex(struct fmt_buf * b, unsigned long v);                   // like "%lX"
+void fmt_repeat(struct fmt_buf * b, char c, int count);              // i.e. indentation
+void fmt_printf(struct fmt_buf * b, const char * fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif
@@ -26,6 +26,7 @@
 
 /* generated by 'iconv --list > iconv_codes.h'
  * and partially sorted by expected probability
+ * NOTE: the positions of the first entries are used in iconv_codes.h, enum iconv_code_id.
  */
 const char * iconv_codes[] = {
    "UTF-8",  // do not delete/rename "UTF-8"
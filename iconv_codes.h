@@ -28,4 +28,32 @@
 extern const char * iconv_codes[];
 unsigned iconv_codes_count(void);
 
+/* fixed positions at the start of iconv_codes[], i.e. the character tables of
+ * EN 300 468 Annex A. Keep in sync with iconv_codes.c, checked by get_codepage_index().
+ */
+enum iconv_code_id {
+  ICONV_UTF_8           = 0,
+  ICONV_ISO_8859_1      = 16,
+  ICONV_ISO_8859_2      = 17,
+  ICONV_ISO_8859_3      = 18,
+  ICONV_ISO_8859_4      = 19,
+  ICONV_ISO_8859_5      = 20,
+  ICONV_ISO_8859_6      = 21,
+  ICONV_ISO_8859_7      = 22,
+  ICONV_ISO_8859_8      = 23,
+  ICONV_ISO_8859_9      = 24,
+  ICONV_ISO_8859_10     = 26,
+  ICONV_ISO_8859_11     = 27,
+  ICONV_ISO_8859_13     = 28,
+  ICONV_ISO_8859_14     = 29,
+  ICONV_ISO_8859_15     = 30,
+  ICONV_ISO_10646       = 32,
+  ICONV_ISO_2022_KR     = 38,
+  ICONV_GB2312          = 39,
+  ICONV_BIG_5           = 40,
+  ICONV_ISO_10646_UTF_8 = 48,
+  ICONV_ISO6937         = 50,
+  ICONV_NONE            = 0xFFFF, // no or unknown character table
+};
+
 #endif
@@ -0,0 +1,170 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "scan.h"
+#include "countries.h"
+#include "char-coding.h"
+#include "ts-file.h"
+#include "libt2scan.h"
+
+struct t2scan_session {
+  struct scan_context * ctx;
+  int adapter;
+  int frontend;
+  cList files;                        // recorded TS files, scanned instead of a frontend if any
+  bool country_set;
+};
+
+static struct t2scan_session * session_new(void) {
+  struct t2scan_session * s = calloc(1, sizeof(* s));
+
+  if (s == NULL)
+     return NULL;
+  s->ctx = scan_context_new();
+  s->adapter = s->frontend = -1;
+  NewList(&s->files, "ts_files");
+  // callbacks get UTF-8, independent of the locale.
+  s->ctx->flags.codepage = get_codepage_index("UTF-8");
+  return s;
+}
+
+struct t2scan_session * t2scan_session_new(int adapter, int frontend) {
+  struct t2scan_session * s;
+
+  if ((adapter < 0) || (frontend < 0))
+     return NULL;
+  if ((s = session_new()) == NULL)
+     return NULL;
+  s->adapter = adapter;
+  s->frontend = frontend;
+  return s;
+}
+
+struct t2scan_session * t2scan_session_new_file(const char * file) {
+  struct t2scan_session * s = session_new();
+
+  if ((s != NULL) && (t2scan_add_file(s, file) < 0)) {
+     t2scan_session_free(s);
+     return NULL;
+     }
+  return s;
+}
+
+int t2scan_add_file(struct t2scan_session * s, const char * file) {
+  struct ts_file * f = ts_file_open(file);
+
+  if (f == NULL)
+     return -1;
+  AddItem(&s->files, f);
+  return 0;
+}
+
+void t2scan_session_free(struct t2scan_session * s) {
+  if (s == NULL)
+     return;
+  scan_context_free(s->ctx);
+  while(s->files.first != NULL) {
+     struct ts_file * f = s->files.first;
+     UnlinkItem(&s->files, f, false);
+     ts_file_close(f);
+     }
+  free(s);
+}
+
+int t2scan_set_country(struct t2scan_session * s, const char * country) {
+  uint16_t scantype = s->ctx->flags.scantype;
+
+  // choose_country() falls back to DE on unknown countries.
+  if ((country == NULL) || strcasecmp(country_to_short_name(txt_to_country(country)), country))
+     return -1;
+  set_country(s->ctx, country, &scantype, MOD_USE_STANDARD);
+  s->ctx->flags.scantype = scantype;
+  s->country_set = true;
+  return 0;
+}
+
+int t2scan_set_channels(struct t2scan_session * s, const int * channels, int count) {
+  struct scan_context * ctx = s->ctx;
+
+  if ((count < 0) || (count > (int) (sizeof(ctx->user_channellist) / sizeof(ctx->user_channellist[0]))))
+     return -1;
+  memcpy(ctx->user_channellist, channels, count * sizeof(* channels));
+  ctx->use_user_channellist = count > 0;
+  return 0;
+}
+
+int t2scan_set_plps(struct t2scan_session * s, const int * plp_ids, int count) {
+  struct scan_context * ctx = s->ctx;
+  int i;
+
+  if ((count < 0) || (count > (int) (sizeof(ctx->user_plplist) / sizeof(ctx->user_plplist[0]))))
+     return -1;
+  for(i = 0; i < count; i++)
+     ctx->user_plplist[i] = (plp_ids[i] < -1) ? -1 : plp_ids[i];
+  ctx->user_plplist_length = count;
+  ctx->use_user_plplist = count > 0;
+  return 0;
+}
+
+int t2scan_set_delsys(struct t2scan_session * s, enum t2scan_delsys delsys) {
+  if ((delsys < T2SCAN_DELSYS_ALL) || (delsys > T2SCAN_DELSYS_DVBT2))
+     return -1;
+  s->ctx->flags.dvbt_type = delsys;
+  return 0;
+}
+
+void t2scan_set_callbacks(struct t2scan_session * s, const struct t2scan_callbacks * callbacks, void * priv) {
+  if (callbacks != NULL)
+     s->ctx->callbacks = * callbacks;
+  else
+     memset(&s->ctx->callbacks, 0, sizeof(s->ctx->callbacks));
+  s->ctx->callback_priv = priv;
+}
+
+void t2scan_set_verbosity(int level) {
+  verbosity = level;
+}
+
+int t2scan_run(struct t2scan_session * s) {
+  struct scan_context * ctx = s->ctx;
+
+  free_scan_session(ctx);
+  ctx->interrupted = 0;
+  if (! s->country_set)
+     t2scan_set_country(s, country_to_short_name(get_user_country()));
+
+  if (s->files.count > 0)
+     file_scan(ctx, &s->files);
+  else if (device_scan(ctx, s->adapter, s->frontend) < 0)
+     return -1;
+  return ctx->interrupted ? 2 : 0;
+}
+
+void t2scan_interrupt(struct t2scan_session * s) {
+  s->ctx->interrupted = 1;
+}
@@ -0,0 +1,136 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+#ifndef __LIBT2SCAN_H__
+#define __LIBT2SCAN_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * libt2scan: the t2scan engine inside other programs, link with -lt2scan -lrt -lpthread.
+ *
+ * A session scans one DVB frontend or a set of recorded transport streams and
+ * passes its results to callbacks while scanning. Sessions don't share scan state,
+ * so several sessions may run at the same time, each one in its own thread. Only
+ * the verbosity and the start of the message time stamps are the same for all.
+ * As in the t2scan program, progress messages go to stderr (see
+ * t2scan_set_verbosity()) and fatal errors, i.e. out of memory, end the process.
+ * Only the t2scan_* functions are exported by libt2scan.a.
+ */
+
+struct t2scan_session;
+
+enum t2scan_tune_result {
+  T2SCAN_TUNE_FAILED,                 // frontend didn't accept the tuning parameters
+  T2SCAN_NO_SIGNAL,
+  T2SCAN_NO_LOCK,
+  T2SCAN_WRONG_DELSYS,                // locked, but to the other one of DVB-T and DVB-T2
+  T2SCAN_LOCKED,                      // reading the tables of this transponder next
+};
+
+enum t2scan_delsys {                  // same as option -t
+  T2SCAN_DELSYS_ALL   = 0,
+  T2SCAN_DELSYS_DVBT  = 1,
+  T2SCAN_DELSYS_DVBT2 = 2,
+};
+
+struct t2scan_transponder {
+  uint32_t frequency;                 // Hz
+  uint32_t bandwidth;                 // Hz
+  int      delsys;                    // fe_delivery_system_t, see <linux/dvb/frontend.h>
+  int      modulation;                // fe_modulation_t
+  int      plp_id;                    // DVB-T2 only, -1 = none
+  uint16_t network_id;
+  uint16_t original_network_id;
+  uint16_t transport_stream_id;
+  const char * network_name;          // NULL = unknown
+  unsigned services;                  // number of on_service() calls following on_transponder()
+};
+
+struct t2scan_service {
+  uint16_t service_id;
+  uint16_t pmt_pid;
+  uint16_t pcr_pid;
+  uint16_t video_pid;                 // 0 = none
+  uint16_t teletext_pid;              // 0 = none
+  uint8_t  type;                      // service_type, EN 300 468 6.2.33
+  int      scrambled;                 // not 0: CA system in use
+  uint32_t logical_channel_number;    // 0 = none
+  const char * name;                  // UTF-8, NULL = unknown
+  const char * provider_name;         // UTF-8, NULL = unknown
+};
+
+/* called from t2scan_run(), all callbacks are optional. Pointers passed to a callback
+ * are valid during the call only.
+ */
+struct t2scan_callbacks {
+  // every tuning attempt.
+  void (*on_tune_result)(void * priv, uint32_t frequency, int delsys, int plp_id, enum t2scan_tune_result result);
+  // every new transponder, followed by on_service() for each of its services.
+  void (*on_transponder)(void * priv, const struct t2scan_transponder * t);
+  void (*on_service)    (void * priv, const struct t2scan_transponder * t, const struct t2scan_service * s);
+  // done of total channels (or files) are finished.
+  void (*on_progress)   (void * priv, unsigned done, unsigned total);
+};
+
+/* a session for /dev/dvb/adapterN/frontendM, or for the recorded TS file given as with
+ * option -f, i.e. "mux.ts,frequency=506,delsys=T2,plp=0". t2scan_add_file() adds further
+ * files, each one is scanned as one transponder.
+ * returns NULL (t2scan_add_file(): -1) if the file can't be used.
+ */
+struct t2scan_session * t2scan_session_new(int adapter, int frontend);
+struct t2scan_session * t2scan_session_new_file(const char * file);
+int                     t2scan_add_file(struct t2scan_session * s, const char * file);
+void                    t2scan_session_free(struct t2scan_session * s);
+
+/* what to scan. Without t2scan_set_country() the country is guessed from the locale, as
+ * in the t2scan program. channels (-l) are channel numbers of the country's channel list,
+ * plp_ids (-p) are tried on each DVB-T2 frequency. Returns -1 on invalid arguments.
+ */
+int  t2scan_set_country (struct t2scan_session * s, const char * country);
+int  t2scan_set_channels(struct t2scan_session * s, const int * channels, int count);
+int  t2scan_set_plps    (struct t2scan_session * s, const int * plp_ids, int count);
+int  t2scan_set_delsys  (struct t2scan_session * s, enum t2scan_delsys delsys);
+
+void t2scan_set_callbacks(struct t2scan_session * s, const struct t2scan_callbacks * callbacks, void * priv);
+
+/* messages to stderr, 0 = errors only .. 5 = debug. Applies to all sessions. */
+void t2scan_set_verbosity(int level);
+
+/* scans and returns when done: 0 = finished, 2 = stopped by t2scan_interrupt(), -1 = frontend
+ * not usable. Each call starts a new scan, results of previous calls are released.
+ */
+int  t2scan_run(struct t2scan_session * s);
+
+/* stop t2scan_run() as soon as possible, i.e. from a callback or a signal handler. */
+void t2scan_interrupt(struct t2scan_session * s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
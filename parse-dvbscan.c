@@ -126,7 +126,8 @@ void parse_t2scan_flags(const char * input_buffer, struct t2scan_flags * flags)
         free(copy);
 }
 
-int dvbscan_parse_tuningdata(const char * tuningdata, struct t2scan_flags * flags) {
+int dvbscan_parse_tuningdata(struct scan_context * ctx, const char * tuningdata) {
+        struct t2scan_flags * flags = &ctx->flags;
         FILE * initdata = NULL;
         char * buf = (char *) calloc(sizeof(char), MAX_LINE_LENGTH);
         enum __dvbscan_args arg;
@@ -165,15 +166,15 @@ int dvbscan_parse_tuningdata(const char * tuningdata, struct t2scan_flags * flag
                         continue;
                 switch (toupper(token[0])) {
                         case 'A':
-                                tn = alloc_transponder(0, SYS_ATSC, 0);
+                                tn = alloc_transponder(ctx, 0, SYS_ATSC, 0);
                                 tn->type = SCAN_TERRCABLE_ATSC;
                                 break;
                         case 'C':
-                                tn = alloc_transponder(0, SYS_DVBC_ANNEX_AC, 0);
+                                tn = alloc_transponder(ctx, 0, SYS_DVBC_ANNEX_AC, 0);
                                 tn->type = SCAN_CABLE;
                                 break;
                         case 'T':
-                                tn = alloc_transponder(0, SYS_DVBT, 0);
+                                tn = alloc_transponder(ctx, 0, SYS_DVBT, 0);
                                 tn->type = SCAN_TERRESTRIAL;
                                 break;
                         case '#':
@@ -27,8 +27,9 @@
 
 #include <stdint.h>
 
-int dvbscan_parse_tuningdata(const char * tuningdata,
-                                struct t2scan_flags * flags);
+struct scan_context;
+
+int dvbscan_parse_tuningdata(struct scan_context * ctx, const char * tuningdata);
 
 int dvbscan_parse_rotor_positions(const char * positiondata);
 
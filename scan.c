@@ -53,6 +53,7 @@
 #include <signal.h>
 #include <assert.h>
 #include <getopt.h>
+#include <sys/wait.h>
 #include <linux/dvb/dmx.h>
 #include <linux/dvb/version.h>
 
@@ -72,20 +73,22 @@
 #include "iconv_codes.h"
 #include "char-coding.h"
 #include "si_types.h"
+#include "serialize.h"
+#include "ts-demux.h"
+#include "ts-file.h"
+#include "arena.h"
 #include "tools.h"
 
 #define USE_EMUL
 #ifdef USE_EMUL
-#define EMUL(fname, fargs...) if (flags.emulate) fname(fargs); else
+#define EMUL(fname, fargs...) if (ctx->flags.emulate) fname(fargs); else
 #define em_static
 #else
 #define EMUL(fname, fargs...)
 #define em_static static
 #endif
 
-static char demux_devname[80];
-
-struct t2scan_flags flags = {
+static const struct t2scan_flags default_flags = {
   0,                // readback value t2scan version {YYYYMMDD}
   SCAN_TERRESTRIAL, // scan type
   0,                // scan DVB-T and DVB-T2 if type is t
@@ -108,37 +111,14 @@ struct t2scan_flags flags = {
   0,                // emulate
 };
  
-static unsigned int delsys_min = 0;             // initialization of delsys loop. 0 = delsys legacy.
-static unsigned int delsys_max = 0;             // initialization of delsys loop. 0 = delsys legacy.
-static unsigned int modulation_min = 0;         // initialization of modulation loop. QAM64  if FE_QAM
-static unsigned int modulation_max = 1;         // initialization of modulation loop. QAM256 if FE_QAM
-static unsigned int freq_offset_min = 0;        // initialization of freq offset loop. 0 == offset (0), 1 == offset(+), 2 == offset(-), 3 == offset1(+), 4 == offset2(+)
-static unsigned int freq_offset_max = 4;        // initialization of freq offset loop.
-static int this_channellist = DVBT_EU_VHFUHF;   // t2scan uses by default DVB-T with all VHF and UHF channels
-static unsigned int ATSC_type = ATSC_VSB;       // 20090227: flag type vars shouldnt be signed. 
-static unsigned int no_ATSC_PSIP = 0;           // 20090227: initialization was missing, signed -> unsigned                
 static unsigned int serv_select = 3;            // 20080106: radio and tv as default (no service/other). 20090227: flag type vars shouldnt be signed. 
-static int user_channellist[200];               // for user channel list given by parameter -l
-static bool use_user_channellist = false;       // for user channel list given by parameter -l
-static int plplist[256];                        // list of plp IDs to scan
-static int plplist_length = 0;                  // length of list of plp IDs to scan
-static int user_plplist[256];                   // for user list of plp IDs to scan (-p)
-static int user_plplist_length = 0;             // length of user list of plp IDs to scan (-p)
-static bool use_user_plplist = false;           // for user list of plp IDs to scan (-p)
+static bool cache_full_scan = false;            // with cache, scan all channels for new transponders (-K)
+static bool stream_output = false;              // output each transponder as soon as it is scanned (-u)
+static int streamed_services = 0;               // number of services written so far (-u)
 
 
 struct timespec start_time = { 0, 0 };
 
-static bool bandwidth_auto                              = true;
-static bool multistream                                 = true;
-static enum fe_spectral_inversion caps_inversion        = INVERSION_AUTO;
-static enum fe_code_rate caps_fec                       = FEC_AUTO;
-static enum fe_modulation caps_qam                      = QAM_AUTO;
-static enum fe_modulation this_atsc                     = VSB_8;
-static enum fe_transmit_mode caps_transmission_mode     = TRANSMISSION_MODE_AUTO;
-static enum fe_guard_interval caps_guard_interval       = GUARD_INTERVAL_AUTO;
-static enum fe_hierarchy caps_hierarchy                 = HIERARCHY_AUTO;
-static struct dvb_frontend_info fe_info;
 
 enum __output_format {
   OUTPUT_VDR,
@@ -150,27 +130,104 @@ enum __output_format {
   OUTPUT_VLC_M3U,
   OUTPUT_XML,
 };
-static enum __output_format output_format = OUTPUT_VDR;
 
-cList _scanned_transponders, * scanned_transponders = &_scanned_transponders;
-static struct transponder * current_tp;
+/* outputs selected by -o; all of them are written from the same scan. */
+#define MAX_OUTPUTS 8
+struct output {
+  enum __output_format format;
+  uint8_t vdr_version;
+  uint8_t print_pmt;
+  const char * path;                            // NULL: stdout
+  FILE * dest;
+  struct t2scan_flags flags;                    // copy of flags, with vdr_version and print_pmt of this output
+  int index;                                    // next dvbscan tuning data entry
+  int mux_duplicate;                            // VDR: current mux was marked as duplicate
+};
+static struct output outputs[MAX_OUTPUTS];
+static int output_count = 0;
+
+cList _ts_files, * ts_files = &_ts_files;       // recorded TS files to scan instead of a device (-f)
 
-static void setup_filter(struct section_buf * s, const char * dmx_devname, int pid, int table_id, int table_id_ext,
+static void setup_filter(struct scan_context * ctx, struct section_buf * s, const char * dmx_devname, int pid, int table_id, int table_id_ext,
                          int run_once, int segmented, uint32_t filter_flags);
-static void add_filter(struct section_buf * s);
+static void add_filter(struct scan_context * ctx, struct section_buf * s);
 static void copy_fe_params(struct transponder * dest, struct transponder * source);
+static void stream_transponder(struct scan_context * ctx, struct transponder * t);
+
+
+/* scan time allocations: transponders, filters and timings come from scan_arena, everything belonging to
+ * one transponder (cells, services, names, components) from its own arena, which is a child of scan_arena.
+ * Nothing of it is freed individually; free_scan_session() releases all at once.
+ */
+void * session_alloc(struct scan_context * ctx, size_t size) {
+  if (ctx->scan_arena == NULL)
+     ctx->scan_arena = arena_new(NULL);
+  return arena_alloc(ctx->scan_arena, size);
+}
+
+// t->arena was created by alloc_transponder() or read_transponder().
+void * tp_alloc(struct transponder * t, size_t size) {
+  return arena_alloc(t->arena, size);
+}
+
+char * tp_strdup(struct transponder * t, const char * str) {
+  char * p;
+
+  if (str == NULL)
+     return NULL;
+  p = tp_alloc(t, strlen(str) + 1);
+  strcpy(p, str);
+  return p;
+}
+
+/* drops everything a temporary transponder owns, including its arena: nothing may be added to it afterwards. */
+void discard_transponder(struct transponder * t) {
+  arena_free(t->arena);
+  t->arena = NULL;
+  EmptyList(t->cells);
+  EmptyList(t->services);
+  t->service_index = NULL;
+  t->service_index_size = 0;
+  t->network_name = NULL;
+  t->network_change.num_networks = 0;
+  t->network_change.network = NULL;
+}
+
+/* drops everything a transponder owns, for transponders which are used again. The transponder stays valid but empty. */
+void release_transponder(struct transponder * t) {
+  struct arena * parent = t->arena->parent;
+
+  discard_transponder(t);
+  t->arena = arena_new(parent);
+}
+
+static struct section_buf * alloc_section_buf(struct scan_context * ctx) {
+  struct section_buf * s = ctx->free_section_bufs;
+
+  if (s == NULL)
+     return session_alloc(ctx, sizeof(* s));
+  ctx->free_section_bufs = s->next_seg;
+  memset(s, 0, sizeof(* s));
+  return s;
+}
 
+void free_section_buf(struct scan_context * ctx, struct section_buf * s) {
+  s->next_seg = ctx->free_section_bufs;
+  ctx->free_section_bufs = s;
+}
 
 // According to the DVB standards, the combination of network_id and  transport_stream_id should be unique,
 // but in real life the satellite operators and broadcasters don't care enough to coordinate the numbering.
 // Thus we identify TPs by frequency (scan handles only one satellite at a time).
 // Further complication: Different NITs on one satellite sometimes list the same TP with slightly different
 // frequencies, so we have to search within some bandwidth.
-struct transponder * alloc_transponder(uint32_t frequency, unsigned delsys, uint8_t polarization) {
-  struct transponder * t = calloc(1, sizeof(* t));
+struct transponder * alloc_transponder(struct scan_context * ctx, uint32_t frequency, unsigned delsys, uint8_t polarization) {
+  struct transponder * t = session_alloc(ctx, sizeof(* t));
   char   name[20];
   struct cell* cell;
 
+  t->arena = arena_new(ctx->scan_arena);
+
   t->source = 0;
   t->frequency = frequency;
   t->locks_with_params = false;
@@ -197,7 +254,7 @@ struct transponder * alloc_transponder(uint32_t frequency, unsigned delsys, uint
   sprintf(name, "cells_%u", frequency);
   t->cells = &(t->_cells);
   NewList(t->cells, name);
-  cell = calloc(1, sizeof(struct cell));
+  cell = tp_alloc(t, sizeof(struct cell));
   cell->center_frequencies[cell->num_center_frequencies++] = frequency;
   AddItem(t->cells, cell);
 
@@ -206,6 +263,10 @@ struct transponder * alloc_transponder(uint32_t frequency, unsigned delsys, uint
   NewList(t->services, name);
 
   t->network_name = NULL;  
+  t->service_index = NULL;
+  t->service_index_size = 0;
+  t->pat_version = -1;
+  t->sdt_version = -1;
 
   return t;
 
@@ -257,12 +318,12 @@ void print_transponder(char * dest, struct transponder * t) {
      }
 }
 
-bool fe_supports_scan(int fd, scantype_t type, struct dvb_frontend_info info) {
+bool fe_supports_scan(struct scan_context * ctx, int fd, scantype_t type, struct dvb_frontend_info info) {
   struct dtv_property p[] = {{.cmd = DTV_ENUM_DELSYS }};
   struct dtv_properties cmdseq = {.num = 1, .props = p};
   bool result = false;
 
-  if (flags.api_version >= 0x0505) {
+  if (ctx->flags.api_version >= 0x0505) {
      EMUL(em_getproperty, &cmdseq)
      if (ioctl(fd, FE_GET_PROPERTY, &cmdseq) < 0)
         return 0;
@@ -311,27 +372,6 @@ int cmp_freq_pol(void * a, void * b) {
   return 0;
 }
 
-void bubbleSort(pList list, cmp_func compare) {
-  if (compare == NULL) {
-     warning("sort function not assigned.\n");
-     return;
-     }
-
-  unsigned i,j;
-  for(i=0; i<list->count; i++) {
-     bool swapped = false;
-     for(j=0; j<list->count-i-1; j++) {
-        void * a = GetItem(list, j), * b = GetItem(list, j + 1);
-        if (compare(a,b) > 0) {
-           UnlinkItem(list, b, 0);
-           InsertItem(list, b, ((pItem) a)->index);
-           swapped = true;          
-           }
-        }
-     if (! swapped) return;
-   }
-}
-
 int get_api_version(int frontend_fd, struct t2scan_flags * flags) {
   struct dtv_property p[] = {{.cmd = DTV_API_VERSION }};
   struct dtv_properties cmdseq = {.num = 1, .props = p};
@@ -348,16 +388,136 @@ int get_api_version(int frontend_fd, struct t2scan_flags * flags) {
 
 
 
+/* each transponder keeps an index of its services, an open addressing hash table
+ * with linear probing, which is never more than half full.
+ */
+#define SERVICE_INDEX_MIN 64
+
+static uint32_t service_slot(uint16_t service_id, uint32_t size) {
+  return ((service_id * 2654435761U) >> 16) & (size - 1);
+}
+
+static void insert_service(struct transponder * t, struct service * s) {
+  struct service ** index = t->service_index;
+  uint32_t i = service_slot(s->service_id, t->service_index_size);
+
+  while(index[i])
+     i = (i + 1) & (t->service_index_size - 1);
+  index[i] = s;
+}
+
+// add s, which is already in t->services, to the index.
+void index_service(struct transponder * t, struct service * s) {
+  struct service * p;
+
+  if (2 * t->services->count <= t->service_index_size) {
+     insert_service(t, s);
+     return;
+     }
+  // grow and rebuild from the list of services, which includes s. The old index stays in the arena.
+  t->service_index_size = t->service_index_size ? 2 * t->service_index_size : SERVICE_INDEX_MIN;
+  t->service_index = tp_alloc(t, t->service_index_size * sizeof(struct service *));
+  for(p = t->services->first; p; p = p->next)
+     insert_service(t, p);
+}
+
 struct service * find_service(struct transponder * t, uint16_t service_id) {
   struct service * s;
+  uint32_t i;
 
-  for(s = (t->services)->first; s; s = s->next) {
+  if (t->service_index == NULL) {
+     // i.e. temporary transponders, which are never indexed.
+     for(s = (t->services)->first; s; s = s->next) {
+        if (s->service_id == service_id)
+           return s;
+        }
+     return NULL;
+     }
+  i = service_slot(service_id, t->service_index_size);
+  while((s = t->service_index[i])) {
      if (s->service_id == service_id)
         return s;
+     i = (i + 1) & (t->service_index_size - 1);
+     }
+  return NULL;
+}
+
+#define COMPONENTS_MIN  4
+
+/* appends a new zeroed component to s->components. The array grows inside the transponder's arena,
+ * old arrays are released with the arena; so don't keep pointers to components while adding others.
+ */
+struct es_component * add_component(struct service * s, enum es_kind kind, uint16_t pid, uint8_t stream_type) {
+  struct es_components * c = s->components;
+  struct es_component * e;
+
+  if ((c == NULL) || (c->count == c->size)) {
+     uint16_t size = c ? 2 * c->size : COMPONENTS_MIN;
+     struct es_components * n = tp_alloc(s->transponder, sizeof(* n) + size * sizeof(n->item[0]));
+     if (c)
+        memcpy(n->item, c->item, c->count * sizeof(c->item[0]));
+     n->count = c ? c->count : 0;
+     n->size = size;
+     s->components = c = n;
+     }
+  e = &c->item[c->count++];
+  e->kind = kind;
+  e->pid = pid;
+  e->stream_type = stream_type;
+  return e;
+}
+
+/* the component added last, i.e. the ES whose descriptors are parsed now. */
+struct es_component * last_component(struct service * s) {
+  if ((s->components == NULL) || (s->components->count == 0))
+     return NULL;
+  return &s->components->item[s->components->count - 1];
+}
+
+struct es_component * first_component(struct service * s, enum es_kind kind) {
+  struct es_component * e;
+
+  for_each_component(s, e) {
+     if (e->kind == kind)
+        return e;
      }
   return NULL;
 }
 
+int count_components(struct service * s, enum es_kind kind) {
+  struct es_component * e;
+  int n = 0;
+
+  for_each_component(s, e) {
+     if (e->kind == kind)
+        n++;
+     }
+  return n;
+}
+
+/* adds a CA_system_id, if not already known. returns true if it was new. */
+bool add_ca_id(struct service * s, uint16_t id) {
+  struct ca_ids * c = s->ca_ids;
+  int i;
+
+  if (c) {
+     for(i = 0; i < c->count; i++)
+        if (c->id[i] == id)
+           return false;
+     }
+  if ((c == NULL) || (c->count == c->size)) {
+     uint16_t size = c ? 2 * c->size : COMPONENTS_MIN;
+     struct ca_ids * n = tp_alloc(s->transponder, sizeof(* n) + size * sizeof(n->id[0]));
+     if (c)
+        memcpy(n->id, c->id, c->count * sizeof(c->id[0]));
+     n->count = c ? c->count : 0;
+     n->size = size;
+     s->ca_ids = c = n;
+     }
+  c->id[c->count++] = id;
+  return true;
+}
+
 
 static const char * usage = "\n"
   "usage: %s [options...] \n"
@@ -374,8 +534,10 @@ static const char * usage = "\n"
   "                 1 = DVB-T only\n"
   "                 2 = DVB-T2 only\n"
   "       ---output options---\n"
-  "       -o <format>, --output-format <format>\n"
-  "               determine output format\n"
+  "       -o <format>[=<file>], --output-format <format>[=<file>]\n"
+  "               determine output format, optionally written to <file>.\n"
+  "               repeat with different files for several outputs from\n"
+  "               one scan, i.e. -o vdr=channels.conf -o xml=scan.xml\n"
   "                 gstreamer = channels.conf for dvbsrc plugin\n"
   "                 mplayer   = mplayer output\n"
   "                 vdr       = channels.conf for vdr >=2.1 [default]\n"
@@ -446,6 +608,38 @@ static const char * ext_opts = "%s expert help\n"
   "       -a <N>, --adapter <N>\n"
   "               use device /dev/dvb/adapterN/ [default: auto detect]\n"
   "               (also allowed: -a /dev/dvb/adapterN/frontendM)\n"
+  "       -f <file>[,<key>=<value>..], --ts-file <file>[,<key>=<value>..]\n"
+  "               scan a recorded transport stream instead of a device,\n"
+  "               repeat for several transponders. Tuning data of the\n"
+  "               recording, given here or in <file>.meta:\n"
+  "                 frequency=<Hz|kHz|MHz> (required)\n"
+  "                 delsys=T|T2|ATSC|QAM, plp=<N>, bandwidth=<MHz>\n"
+  "               i.e. -f mux.ts,frequency=506,delsys=T2,plp=0\n"
+  "       -w, --pre-sweep\n"
+  "               check all channels for signal first, then scan only the\n"
+  "               channels with signal, strongest first (DVB-T/T2 only).\n"
+  "               Faster, but may miss very weak channels.\n"
+  "       -k <file>, --cache <file>\n"
+  "               incremental rescan: check only the transponders of the\n"
+  "               last scan stored in <file>. Unchanged transponders (same\n"
+  "               PAT and SDT version) are taken from <file> without reading\n"
+  "               their PMTs. The result is stored in <file> again, together\n"
+  "               with the time each table needed, used as filter timeouts.\n"
+  "       -K, --cache-full-scan\n"
+  "               with -k, scan all channels for new transponders afterwards.\n"
+  "       -T, --ts-demux\n"
+  "               read all tables through one TS filter of the demux and\n"
+  "               assemble the sections in t2scan, instead of one section\n"
+  "               filter per table. All PMTs are read at the same time.\n"
+  "       -u, --stream\n"
+  "               write the services of each transponder as soon as it is\n"
+  "               scanned, instead of all at the end of the scan. The output\n"
+  "               is in order of scanning; with -D the instance found first\n"
+  "               is kept.\n"
+  "       -j, --parallel\n"
+  "               scan with all usable adapters in parallel, each adapter\n"
+  "               gets the next channel when done with the previous one.\n"
+  "               Needs adapter auto detection.\n"
   "       -S <N>, --multiply-timeouts <N>\n"
   "               tuning/filter speed (multiply tuning and filter timeouts)\n"
   "                 1 = default (2 sec for carrier, 4 sec for lock [T2: 6 sec])\n"
@@ -495,6 +689,13 @@ static struct option long_options[] = {
     {"debug"             , no_argument      , NULL, '!'},
     {"quiet"             , no_argument      , NULL, 'q'},
     {"adapter"           , required_argument, NULL, 'a'},
+    {"ts-file"           , required_argument, NULL, 'f'},
+    {"parallel"          , no_argument      , NULL, 'j'},
+    {"pre-sweep"         , no_argument      , NULL, 'w'},
+    {"cache"             , required_argument, NULL, 'k'},
+    {"cache-full-scan"   , no_argument      , NULL, 'K'},
+    {"ts-demux"          , no_argument      , NULL, 'T'},
+    {"stream"            , no_argument      , NULL, 'u'},
     {"long-demux-timeout", no_argument,       NULL, 'F'},
     {"output-services"   , required_argument, NULL, 's'},
     {"multiply-timeouts" , required_argument, NULL, 'S'},
@@ -503,12 +704,48 @@ static struct option long_options[] = {
     {NULL                , 0                , NULL,  0 },
 };
 
-cList _running_filters, * running_filters = &_running_filters;
-cList _waiting_filters, * waiting_filters = &_waiting_filters;
-static int n_running;
-#define MAX_RUNNING 27
-static struct pollfd poll_fds[MAX_RUNNING];
-static struct section_buf * poll_section_bufs[MAX_RUNNING];
+/* with -T, all running filters share one demux fd which outputs TS packets
+ * of all their pids. The sections are assembled in userspace.
+ */
+#define TS_BUFFER_SIZE (TS_PACKET_SIZE * 2048)
+
+/* -o <format>[=<file>]: several outputs can be given, each one to its own file.
+ * Without a file name the output goes to stdout; then the last -o wins, as before.
+ */
+static void add_output(const char * arg) {
+  struct output * o;
+  char * name = strdup(arg);
+  char * path = strchr(name, '=');
+  int i;
+
+  if (path != NULL)
+     *path++ = 0;
+  for(i = 0; i < output_count; i++) {
+     if ((path == NULL) && (outputs[i].path == NULL))
+        break;
+     }
+  if (i == output_count) {
+     if (output_count == MAX_OUTPUTS)
+        fatal("too many outputs, max. %d\n", MAX_OUTPUTS);
+     output_count++;
+     }
+  o = &outputs[i];
+  memset(o, 0, sizeof(* o));
+  o->path = path;
+  o->vdr_version = 21;
+  if (strcmp(name, "xine") == 0) o->format = OUTPUT_XINE;
+  else if (strcmp(name, "xml") == 0) o->format = OUTPUT_XML;
+  else if (strcmp(name, "mplayer") == 0) o->format = OUTPUT_MPLAYER;
+  else if (strcmp(name, "vlc") == 0) o->format = OUTPUT_VLC_M3U;
+  else if (strcmp(name, "gstreamer") == 0) o->format = OUTPUT_GSTREAMER;
+  else if (strcmp(name, "vdr20") == 0) {
+     o->format = OUTPUT_VDR;
+     o->vdr_version = 2;
+  } else {
+     o->format = OUTPUT_VDR;
+     o->vdr_version = 21;
+  }
+}
 
 void bad_usage(char * pname) {
   fprintf(stderr, usage, pname);
@@ -552,6 +789,9 @@ uint16_t carrier_timeout(uint8_t delsys) {
      }
 }
 
+// time to wait for signal during pre-sweep (-w).
+#define SWEEP_TIMEOUT 300
+
 uint16_t lock_timeout(uint8_t delsys) {
   switch(delsys) {
      case SYS_DVBT:
@@ -573,10 +813,11 @@ uint16_t lock_timeout(uint8_t delsys) {
  * (acc. DVB standards unique within one network, but in real life...)
  */
 struct service * alloc_service(struct transponder * t, uint16_t service_id) {
-  struct service * s = calloc(1, sizeof(* s));
+  struct service * s = tp_alloc(t, sizeof(* s));
   s->service_id = service_id;
   s->transponder = t;
   AddItem(t->services, s);
+  index_service(t, s);
   return s;
 }
 
@@ -605,7 +846,7 @@ static int find_descriptor(uint8_t tag, const unsigned char * buf, int descripto
   return 0;
 }
 
-static void parse_descriptors(enum table_id t, const unsigned char * buf, int descriptors_loop_len, void *data,
+static void parse_descriptors(struct scan_context * ctx, enum table_id t, const unsigned char * buf, int descriptors_loop_len, void *data,
                               scantype_t scantype) {
   while(descriptors_loop_len > 0) {
      unsigned char descriptor_tag = buf[0];
@@ -643,11 +884,11 @@ static void parse_descriptors(enum table_id t, const unsigned char * buf, int de
                 break;
         case satellite_delivery_system_descriptor:
                 if ((scantype == SCAN_SATELLITE) && ((t == TABLE_NIT_ACT) || (t == TABLE_NIT_OTH)))
-                   parse_satellite_delivery_system_descriptor(buf, data, caps_inversion);
+                   parse_satellite_delivery_system_descriptor(buf, data, ctx->caps_inversion);
                 break;
         case cable_delivery_system_descriptor:
                 if ((scantype == SCAN_CABLE) && ((t == TABLE_NIT_ACT) || (t == TABLE_NIT_OTH)))
-                   parse_cable_delivery_system_descriptor(buf, data, caps_inversion);
+                   parse_cable_delivery_system_descriptor(buf, data, ctx->caps_inversion);
                 break;
         case vbi_data_descriptor:
         case vbi_teletext_descriptor:
@@ -655,7 +896,7 @@ static void parse_descriptors(enum table_id t, const unsigned char * buf, int de
                 break;
         case service_descriptor:
                 if ((t == TABLE_SDT_ACT) || (t == TABLE_SDT_OTH))
-                   parse_service_descriptor(buf, data, flags.codepage);
+                   parse_service_descriptor(buf, data, ctx->char_coding, ctx->flags.codepage);
                 break;
         case country_availability_descriptor:
         case linkage_descriptor:
@@ -682,29 +923,29 @@ static void parse_descriptors(enum table_id t, const unsigned char * buf, int de
                 break;
         case terrestrial_delivery_system_descriptor:
                 if ((scantype == SCAN_TERRESTRIAL) && ((t == TABLE_NIT_ACT) || (t == TABLE_NIT_OTH)))
-                   parse_terrestrial_delivery_system_descriptor(buf, data, caps_inversion);
+                   parse_terrestrial_delivery_system_descriptor(buf, data, ctx->caps_inversion);
                 break;
         case extension_descriptor: // 6.2.16 Extension descriptor
                 switch (buf[2]) { // descriptor_tag_extension;
                    // see descriptors.h: _extended_descriptors && 300468v011101p 6.4
                    case C2_delivery_system_descriptor:
                         if ((scantype == SCAN_CABLE) && ((t == TABLE_NIT_ACT) || (t == TABLE_NIT_OTH))) {
-                           parse_C2_delivery_system_descriptor(buf, data, caps_inversion);
+                           parse_C2_delivery_system_descriptor(buf, data, ctx->caps_inversion);
                            }
                         break;
                    case T2_delivery_system_descriptor:
                         if ((scantype == SCAN_TERRESTRIAL) && ((t == TABLE_NIT_ACT) || (t == TABLE_NIT_OTH))) {
-                           parse_T2_delivery_system_descriptor(buf, data, caps_inversion);
+                           parse_T2_delivery_system_descriptor(buf, data, ctx->caps_inversion);
                            }
                         break;
                    case SH_delivery_system_descriptor:
                         if (((scantype == SCAN_SATELLITE) || (scantype == SCAN_TERRESTRIAL)) &&
                             ((t == TABLE_NIT_ACT) || (t == TABLE_NIT_OTH))) {
-                           parse_SH_delivery_system_descriptor(buf, data, caps_inversion);
+                           parse_SH_delivery_system_descriptor(buf, data, ctx->caps_inversion);
                            }
                         break;
                    case network_change_notify_descriptor:
-                        parse_network_change_notify_descriptor(buf, &((struct transponder *) data)->network_change);
+                        parse_network_change_notify_descriptor(buf, data);
                         break;
                    // all other extended descriptors here: do nothing so far.
                    case image_icon_descriptor:
@@ -758,7 +999,7 @@ static void parse_descriptors(enum table_id t, const unsigned char * buf, int de
                 break;
         case s2_satellite_delivery_system_descriptor:
                 if ((scantype == SCAN_SATELLITE) && ((t == TABLE_NIT_ACT) || (t == TABLE_NIT_OTH)) &&
-                   (fe_info.caps & FE_CAN_2G_MODULATION))
+                   (ctx->fe_info.caps & FE_CAN_2G_MODULATION))
                    parse_S2_satellite_delivery_system_descriptor(buf, data);
                 break;
         case enhanced_ac3_descriptor:
@@ -780,15 +1021,15 @@ static void parse_descriptors(enum table_id t, const unsigned char * buf, int de
      }
 }
 
-em_static void parse_pmt(const unsigned char * buf, uint16_t section_length, uint16_t service_id) {
+em_static void parse_pmt(struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint16_t service_id) {
   int program_info_len;
   struct service * s;
-  char msg_buf[14 * AUDIO_CHAN_MAX + 1];
-  char * tmp;
-  int i;
+  struct es_component * e;
+  char msg_buf[256];
+  int len;
 
   hexdump(__FUNCTION__, buf, section_length);
-  s = find_service(current_tp, service_id);
+  s = find_service(ctx->current_tp, service_id);
   if (s == NULL) {
      error("PMT for service_id 0x%04x was not in PAT\n", service_id);
      return;
@@ -803,7 +1044,7 @@ em_static void parse_pmt(const unsigned char * buf, uint16_t section_length, uin
 
   while(program_info_len > 0) {
      int descriptor_length = ((int)buf[1]) + 2;
-     parse_descriptors(TABLE_PMT, buf, section_length, s, flags.scantype);
+     parse_descriptors(ctx, TABLE_PMT, buf, section_length, s, ctx->flags.scantype);
      buf += descriptor_length;
      section_length   -= descriptor_length;
      program_info_len -= descriptor_length;
@@ -825,14 +1066,8 @@ em_static void parse_pmt(const unsigned char * buf, uint16_t section_length, uin
         case iso_iec_11172_audio_stream:
         case iso_iec_13818_3_audio_stream:
            moreverbose("  AUDIO     : PID %d (stream type 0x%x)\n", elementary_pid, buf[0]);
-           if (s->audio_num < AUDIO_CHAN_MAX) {
-              s->audio_pid[s->audio_num] = elementary_pid;
-              s->audio_stream_type[s->audio_num] = buf[0];
-              s->audio_num++;
-              parse_descriptors(TABLE_PMT, buf + 5, ES_info_len, s, flags.scantype);
-              }
-           else
-              warning("more than %i audio channels, truncating\n", AUDIO_CHAN_MAX);
+           add_component(s, ES_AUDIO, elementary_pid, buf[0]);
+           parse_descriptors(ctx, TABLE_PMT, buf + 5, ES_info_len, s, ctx->flags.scantype);
            break;
         case iso_iec_13818_1_private_sections:
         case iso_iec_13818_1_private_data:
@@ -849,31 +1084,20 @@ em_static void parse_pmt(const unsigned char * buf, uint16_t section_length, uin
               // that we catch DVB subtitling streams only here, w/o
               // parsing the descriptor.
               moreverbose("  SUBTITLING: PID %d\n", elementary_pid);
-              s->subtitling_pid[s->subtitling_num++] = elementary_pid;
+              add_component(s, ES_SUBTITLE, elementary_pid, buf[0]);
+              parse_descriptors(ctx, TABLE_PMT, buf + 5, ES_info_len, s, ctx->flags.scantype);
               break;
               }
            else if (find_descriptor(ac3_descriptor, buf + 5, ES_info_len, NULL, NULL)) {
               moreverbose("  AC3       : PID %d (stream type 0x%x)\n", elementary_pid, buf[0]);
-              if (s->ac3_num < AC3_CHAN_MAX) {
-                 s->ac3_pid[s->ac3_num] = elementary_pid;
-                 s->ac3_stream_type[s->ac3_num] = buf[0];
-                 s->ac3_num++;
-                 parse_descriptors(TABLE_PMT, buf + 5, ES_info_len, s, flags.scantype);
-                 }
-              else
-                 warning("more than %i ac3 audio channels, truncating\n", AC3_CHAN_MAX);
+              add_component(s, ES_AC3, elementary_pid, buf[0]);
+              parse_descriptors(ctx, TABLE_PMT, buf + 5, ES_info_len, s, ctx->flags.scantype);
               break;
               }
            else if (find_descriptor(enhanced_ac3_descriptor, buf + 5, ES_info_len, NULL, NULL)) {
               moreverbose("  EAC3      : PID %d (stream type 0x%x)\n", elementary_pid, buf[0]);
-              if (s->ac3_num < AC3_CHAN_MAX) {
-                 s->ac3_pid[s->ac3_num] = elementary_pid;
-                 s->ac3_stream_type[s->ac3_num] = buf[0];
-                 s->ac3_num++;
-                 parse_descriptors(TABLE_PMT, buf + 5, ES_info_len, s, flags.scantype);
-                 }
-              else
-                 warning("more than %i eac3 audio channels, truncating\n", AC3_CHAN_MAX);
+              add_component(s, ES_AC3, elementary_pid, buf[0]);
+              parse_descriptors(ctx, TABLE_PMT, buf + 5, ES_info_len, s, ctx->flags.scantype);
               break;
               }
            // we shouldn't reach this one, usually it should be Teletext, Subtitling or AC3 .. 
@@ -925,28 +1149,16 @@ em_static void parse_pmt(const unsigned char * buf, uint16_t section_length, uin
            break;
         case iso_iec_13818_7_audio_w_ADTS_transp:
            moreverbose("  ADTS Audio Stream (usually AAC) : PID %d (stream type 0x%x)\n", elementary_pid, buf[0]);
-           if (s->audio_num < AUDIO_CHAN_MAX) {
-              s->audio_pid[s->audio_num] = elementary_pid;
-              s->audio_stream_type[s->audio_num] = buf[0];
-              s->audio_num++;
-              parse_descriptors(TABLE_PMT, buf + 5, ES_info_len, s, flags.scantype);
-              }
-           else
-              warning("more than %i audio channels, truncating\n", AUDIO_CHAN_MAX);
+           add_component(s, ES_AUDIO, elementary_pid, buf[0]);
+           parse_descriptors(ctx, TABLE_PMT, buf + 5, ES_info_len, s, ctx->flags.scantype);
            break;
         case iso_iec_14496_2_visual:
            moreverbose("  ISO/IEC 14496-2 Visual : PID %d\n", elementary_pid);
            break;
         case iso_iec_14496_3_audio_w_LATM_transp:
            moreverbose("  ISO/IEC 14496-3 Audio with LATM transport syntax as def. in ISO/IEC 14496-3/AMD1 : PID %d (stream type 0x%x)\n", elementary_pid, buf[0]);
-           if (s->audio_num < AUDIO_CHAN_MAX) {
-              s->audio_pid[s->audio_num] = elementary_pid;
-              s->audio_stream_type[s->audio_num] = buf[0];
-              s->audio_num++;
-              parse_descriptors(TABLE_PMT, buf + 5, ES_info_len, s, flags.scantype);
-              }
-           else
-              warning("more than %i audio channels, truncating\n", AUDIO_CHAN_MAX);
+           add_component(s, ES_AUDIO, elementary_pid, buf[0]);
+           parse_descriptors(ctx, TABLE_PMT, buf + 5, ES_info_len, s, ctx->flags.scantype);
            break;
         case iso_iec_14496_1_packet_stream_in_PES:
            moreverbose("  ISO/IEC 14496-1 SL-packetized stream or FlexMux stream carried in PES packets : PID 0x%04x\n", elementary_pid);
@@ -991,14 +1203,8 @@ em_static void parse_pmt(const unsigned char * buf, uint16_t section_length, uin
            break;
         case atsc_a_52b_ac3:
            moreverbose("  AC-3 Audio per ATSC A/52B : PID %d (stream type 0x%x)\n", elementary_pid, buf[0]);
-           if (s->ac3_num < AC3_CHAN_MAX) {
-              s->ac3_pid[s->ac3_num] = elementary_pid;
-              s->ac3_stream_type[s->ac3_num] = buf[0];
-              s->ac3_num++;
-              parse_descriptors(TABLE_PMT, buf + 5, ES_info_len, s, flags.scantype);
-              }
-           else
-              warning("more than %i ac3 audio channels, truncating\n", AC3_CHAN_MAX);
+           add_component(s, ES_AC3, elementary_pid, buf[0]);
+           parse_descriptors(ctx, TABLE_PMT, buf + 5, ES_info_len, s, ctx->flags.scantype);
            break;
         default:
            moreverbose("  OTHER     : PID %d TYPE 0x%02x\n", elementary_pid, buf[0]);
@@ -1008,17 +1214,14 @@ em_static void parse_pmt(const unsigned char * buf, uint16_t section_length, uin
      }
 
 
-  tmp = msg_buf;
-  tmp += sprintf(tmp, "%d (%.4s)", s->audio_pid[0], s->audio_lang[0]);
-
-  if (s->audio_num >= AUDIO_CHAN_MAX) {
-     warning("more than %i audio channels: %i, truncating to %i\n", AUDIO_CHAN_MAX-1, s->audio_num, AUDIO_CHAN_MAX);
-     s->audio_num = AUDIO_CHAN_MAX;
+  msg_buf[0] = 0;
+  len = 0;
+  for_each_component(s, e) {
+     if ((e->kind != ES_AUDIO) || (len >= (int) sizeof(msg_buf)))
+        continue;
+     len += snprintf(msg_buf + len, sizeof(msg_buf) - len, "%s%d (%.4s)", len ? ", " : "", e->pid, e->lang);
      }
-  
-  for(i=1; i<s->audio_num; i++)
-     tmp += sprintf(tmp, ", %d (%.4s)", s->audio_pid[i], s->audio_lang[i]);
-  
+
   debug("tsid=%d sid=%d: %s -- %s, pmt_pid 0x%04x, vpid 0x%04x, apid %s\n",
         s->transport_stream_id,
         s->service_id,
@@ -1050,7 +1253,7 @@ em_static void parse_psip_descriptors(struct service * s, const unsigned char *
      }
 }
 
-em_static void parse_psip_vct(const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t transport_stream_id) {
+em_static void parse_psip_vct(struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t transport_stream_id) {
   (void)section_length;
   (void)table_id;
   (void)transport_stream_id;
@@ -1087,20 +1290,18 @@ em_static void parse_psip_vct(const unsigned char * buf, uint16_t section_length
       * May be finding transponder by transport_stream_id from PAT. However, setting
       * t->transport_stream_id from data in PAT may collide with the current DVB scan algorithm.
       */
-     current_tp->source = 0x40 << 8 | table_id; 
-     s = find_service(current_tp, ch.program_number);
+     ctx->current_tp->source = 0x40 << 8 | table_id; 
+     s = find_service(ctx->current_tp, ch.program_number);
      if (!s)
-        s = alloc_service(current_tp, ch.program_number);
+        s = alloc_service(ctx->current_tp, ch.program_number);
 
-     if (s->service_name)
-             free(s->service_name);
      /* TODO: according to a_65-2009.pdf TABLE 6.4 short_name is 7*16 uimsbf, to be interpreted as UTF16;
       *       the patch by mk that added atsc needs to be reviewed and compared to atsc specs a63, a65b, a69.
       *       And as i'm using iconv() anyway, UTF16->users_charset conversation can be added - but carefully,
       *       mistakes may easily break atsc scan at all.
       *         --wirbel 20120414
       */
-     s->service_name = calloc(8,sizeof(unsigned char));
+     s->service_name = tp_alloc(ctx->current_tp, 8);
      /* TODO find a better solution to convert UTF-16 */
      s->service_name[0] = ch.short_name0;
      s->service_name[1] = ch.short_name1;
@@ -1131,18 +1332,18 @@ em_static void parse_psip_vct(const unsigned char * buf, uint16_t section_length
      }
 }
 
-em_static void parse_nit(const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t network_id, uint32_t section_flags) {
+em_static void parse_nit(struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint8_t table_id, uint16_t network_id, uint32_t section_flags) {
   char buffer[128];
   int descriptors_loop_len = ((buf[0] & 0x0f) << 8) | buf[1];
   
   moreverbose("%s: (xxxx:%u:xxxx)\n", table_id == 0x40?"NIT(act)":"NIT(oth)", network_id);
   hexdump(__FUNCTION__, buf, section_length);
 
-  if ((table_id == TABLE_NIT_ACT) && (current_tp->network_id != network_id)) {
-     print_transponder(buffer, current_tp);
+  if ((table_id == TABLE_NIT_ACT) && (ctx->current_tp->network_id != network_id)) {
+     print_transponder(buffer, ctx->current_tp);
      verbose("        %s : updating network_id -> (%u:%u:%u)\n",
-          buffer, current_tp->original_network_id, network_id, current_tp->transport_stream_id);
-     current_tp->network_id = network_id;
+          buffer, ctx->current_tp->original_network_id, network_id, ctx->current_tp->transport_stream_id);
+     ctx->current_tp->network_id = network_id;
   }
 
   if (section_length < descriptors_loop_len + 4) {
@@ -1151,7 +1352,7 @@ em_static void parse_nit(const unsigned char * buf, uint16_t section_length, uin
      return;
   }
   // update network_name
-  parse_descriptors(table_id, buf + 2, descriptors_loop_len, current_tp, flags.scantype);
+  parse_descriptors(ctx, table_id, buf + 2, descriptors_loop_len, ctx->current_tp, ctx->flags.scantype);
   section_length -= descriptors_loop_len + 4;
   buf            += descriptors_loop_len + 4;
 
@@ -1172,11 +1373,11 @@ em_static void parse_nit(const unsigned char * buf, uint16_t section_length, uin
         }
 
      // only use the NIT entry for current TSID, NID to get ONID and exact tuning data
-     if ((current_tp->type != SCAN_TERRESTRIAL) || ((transport_stream_id == current_tp->transport_stream_id) && (network_id == current_tp->network_id))) {
+     if ((ctx->current_tp->type != SCAN_TERRESTRIAL) || ((transport_stream_id == ctx->current_tp->transport_stream_id) && (network_id == ctx->current_tp->network_id))) {
         moreverbose("        section is for currently received network.\n");
         memset(&tn, 0, sizeof(tn));
-        tn.type                = current_tp->type;
-        tn.network_PID         = current_tp->network_PID;
+        tn.type                = ctx->current_tp->type;
+        tn.network_PID         = ctx->current_tp->network_PID;
         tn.network_id          = network_id;
         tn.original_network_id = original_network_id;
         tn.transport_stream_id = transport_stream_id;
@@ -1186,35 +1387,37 @@ em_static void parse_nit(const unsigned char * buf, uint16_t section_length, uin
         NewList(tn.services, "tn_services");
         tn.cells = &tn._cells;
         NewList(tn.cells, "tn_cells");
+        tn.arena = arena_new(ctx->scan_arena);
 
 
-        if ((current_tp->original_network_id == original_network_id) &&
-         (current_tp->transport_stream_id == transport_stream_id) &&
+        if ((ctx->current_tp->original_network_id == original_network_id) &&
+         (ctx->current_tp->transport_stream_id == transport_stream_id) &&
          (table_id == TABLE_NIT_ACT)) {
             // if we've found the current tp by onid && ts_id and update it from nit(act), use actual settings as default.      
-            copy_fe_params(&tn, current_tp);   //  tn.param = current_tp->param;
+            copy_fe_params(&tn, ctx->current_tp);   //  tn.param = current_tp->param;
         }
 
 
-        parse_descriptors(table_id, buf + 6, descriptors_loop_len, &tn, flags.scantype);
+        parse_descriptors(ctx, table_id, buf + 6, descriptors_loop_len, &tn, ctx->flags.scantype);
         tn.source |= table_id << 8;
 
-        current_tp->original_network_id = original_network_id;
+        ctx->current_tp->original_network_id = original_network_id;
 
         // we ignore the frequency, but set all other things
         //current_tp->bandwidth = tn.bandwidth;
 
-        if (flags.update_transponder_params && tn.delsys == current_tp->delsys) {        
-           current_tp->coderate = tn.coderate;
-           current_tp->coderate_LP = tn.coderate_LP;
-           current_tp->guard = tn.guard;
-           current_tp->transmission = tn.transmission;
-           current_tp->hierarchy = tn.hierarchy;
-           current_tp->modulation = tn.modulation;
-           if (current_tp->plp_id==NO_STREAM_ID_FILTER) current_tp->plp_id = tn.plp_id;
+        if (ctx->flags.update_transponder_params && tn.delsys == ctx->current_tp->delsys) {        
+           ctx->current_tp->coderate = tn.coderate;
+           ctx->current_tp->coderate_LP = tn.coderate_LP;
+           ctx->current_tp->guard = tn.guard;
+           ctx->current_tp->transmission = tn.transmission;
+           ctx->current_tp->hierarchy = tn.hierarchy;
+           ctx->current_tp->modulation = tn.modulation;
+           if (ctx->current_tp->plp_id==NO_STREAM_ID_FILTER) ctx->current_tp->plp_id = tn.plp_id;
         } else {
-           if (current_tp->plp_id==NO_STREAM_ID_FILTER) current_tp->plp_id = -1;
+           if (ctx->current_tp->plp_id==NO_STREAM_ID_FILTER) ctx->current_tp->plp_id = -1;
         }
+        discard_transponder(&tn);
 
      } else {
        moreverbose("        section is for a network on different transponder.\n");
@@ -1239,7 +1442,7 @@ em_static void parse_nit(const unsigned char * buf, uint16_t section_length, uin
 
 }
 
-em_static void parse_sdt(const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id) {
+em_static void parse_sdt(struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id) {
   hexdump(__FUNCTION__, buf, section_length);
   
   buf += 3;              /*  skip original network id + reserved field */
@@ -1255,41 +1458,41 @@ em_static void parse_sdt(const unsigned char * buf, uint16_t section_length, uin
          break;
          }
   
-      s = find_service(current_tp, service_id);
+      s = find_service(ctx->current_tp, service_id);
       if (!s)
          /* maybe PAT has not yet been parsed... */
-         s = alloc_service(current_tp, service_id);
+         s = alloc_service(ctx->current_tp, service_id);
   
       s->running   = (buf[3] >> 5) & 0x7;
       s->scrambled = (buf[3] >> 4) & 1;
   
-      parse_descriptors(TABLE_SDT_ACT, buf + 5, descriptors_loop_len, s, flags.scantype);
+      parse_descriptors(ctx, TABLE_SDT_ACT, buf + 5, descriptors_loop_len, s, ctx->flags.scantype);
   
       section_length -= descriptors_loop_len + 5;
       buf            += descriptors_loop_len + 5;
       }
 }
 
-em_static void parse_pat(const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id, uint32_t flags) {
+em_static void parse_pat(struct scan_context * ctx, const unsigned char * buf, uint16_t section_length, uint16_t transport_stream_id, uint32_t section_flags) {
    debug("PAT (xxxx:xxxx:%u)\n", transport_stream_id);  
   hexdump(__FUNCTION__, buf, section_length);
 
-  if (current_tp->transport_stream_id != transport_stream_id) {
-     if (current_tp->type == SCAN_TERRESTRIAL) {
+  if (ctx->current_tp->transport_stream_id != transport_stream_id) {
+     if (ctx->current_tp->type == SCAN_TERRESTRIAL) {
         char buffer[128];
-        print_transponder(buffer, current_tp);
+        print_transponder(buffer, ctx->current_tp);
         verbose("        %s : updating transport_stream_id: -> (%u:%u:%u)\n",
             buffer,
-            current_tp->original_network_id,
-            current_tp->network_id,
+            ctx->current_tp->original_network_id,
+            ctx->current_tp->network_id,
             transport_stream_id);
-        current_tp->transport_stream_id = transport_stream_id;
+        ctx->current_tp->transport_stream_id = transport_stream_id;
         /*check_duplicate_transponders();
         if (verbosity > 1) list_transponders();*/
         }
-     else if (current_tp->transport_stream_id)
+     else if (ctx->current_tp->transport_stream_id)
         verbose("unexpected transport_stream_id %d, expected %d\n",
-                transport_stream_id, current_tp->transport_stream_id);
+                transport_stream_id, ctx->current_tp->transport_stream_id);
      }
 
   // will find out later what this does
@@ -1304,20 +1507,20 @@ em_static void parse_pat(const unsigned char * buf, uint16_t section_length, uin
      if (service_id == 0) {
         if (program_number != 16)
            info("        %s: network_PID = %d (transport_stream_id %d)\n", __FUNCTION__, program_number, transport_stream_id);
-        current_tp->network_PID = program_number;
+        ctx->current_tp->network_PID = program_number;
         continue;
         }
      // SDT might have been parsed first...
-     s = find_service(current_tp, service_id);
+     s = find_service(ctx->current_tp, service_id);
      if (s == NULL)
-        s = alloc_service(current_tp, service_id);
+        s = alloc_service(ctx->current_tp, service_id);
      s->pmt_pid = program_number;
 
-     if (! (flags & SECTION_FLAG_INITIAL)) {
+     if (! (section_flags & SECTION_FLAG_INITIAL)) {
         if (s->priv == NULL) { //  && s->pmt_pid) {  pmt_pid is by spec: 0x0010 .. 0x1FFE . see EN13818-1 p.19 Table 2-3 - PID table
-           s->priv = calloc(1, sizeof(struct section_buf));
-           setup_filter(s->priv, demux_devname, s->pmt_pid, TABLE_PMT, -1, 1, 0, SECTION_FLAG_FREE);
-           add_filter(s->priv);
+           s->priv = alloc_section_buf(ctx);
+           setup_filter(ctx, s->priv, ctx->demux_devname, s->pmt_pid, TABLE_PMT, -1, 1, 0, SECTION_FLAG_FREE);
+           add_filter(ctx, s->priv);
            }
         }
      }
@@ -1334,13 +1537,13 @@ static unsigned int chan_to_freq(int channel, int channellist) {
     return 0;
 }
 
-static uint16_t check_frontend(int fd, int verbose) {
+static uint16_t check_frontend(struct scan_context * ctx, int fd, int verbose) {
   fe_status_t status = (fe_status_t)0;
   EMUL(em_status, &status)
   if (ioctl(fd, FE_READ_STATUS, &status) < 0) {
      error("FE_READ_STATUS failed during scan: %d %s\n", errno, strerror(errno));
   }
-  if (verbose && !flags.emulate) {
+  if (verbose && !ctx->flags.emulate) {
      uint16_t snr, signal;
      uint32_t ber, uncorrected_blocks;
 
@@ -1361,7 +1564,52 @@ static uint16_t check_frontend(int fd, int verbose) {
   return (status & 0x1F);
 }
 
-static int set_frontend(int frontend_fd, struct transponder * t) {
+/* waits for frontend events until one of the 'wanted' status bits or FE_TIMEDOUT is reported
+ * or timeout expires. 'status' is the last known frontend status, the new one is returned.
+ */
+static uint16_t wait_frontend(struct scan_context * ctx, int fd, uint16_t wanted, uint16_t status, struct timespec * timeout, struct timespec * meas_start) {
+  struct pollfd pfd = { .fd = fd, .events = POLLPRI };
+  struct dvb_frontend_event event;
+  struct timespec now;
+  int msec, n;
+
+  if (ctx->flags.emulate)
+     return check_frontend(ctx, fd, 0);
+
+  while((status & (wanted | FE_TIMEDOUT)) == 0) {
+     if ((msec = timeout_remaining(timeout)) == 0)
+        break;
+     n = poll(&pfd, 1, msec);
+     if (n < 0 && errno == EINTR && !ctx->interrupted)
+        continue;
+     if (n <= 0)
+        break;
+     if (ioctl(fd, FE_GET_EVENT, &event) < 0) {
+        if (errno == EOVERFLOW || errno == EWOULDBLOCK)
+           continue; // events lost or already taken, next one will be up to date.
+        error("FE_GET_EVENT failed during scan: %d %s\n", errno, strerror(errno));
+        break;
+        }
+     if (event.status != status) {
+        get_time(&now);
+        moreverbose("\n        (%4ums): %s%s%s%s (0x%X)",
+             (unsigned) (elapsed(meas_start, &now) * 1000),
+             event.status & FE_HAS_SIGNAL ?"S":"",
+             event.status & FE_HAS_CARRIER?"C":"",
+             event.status & FE_HAS_LOCK?   "L":"",
+             event.status & FE_TIMEDOUT?   "T":"",
+             event.status);
+        status = event.status;
+        }
+     }
+
+  // drivers are not required to emit events for every change, so read back once.
+  if ((status & (wanted | FE_TIMEDOUT)) == 0)
+     status = check_frontend(ctx, fd, (verbosity > 3) ? 1:0);
+  return status;
+}
+
+static int set_frontend(struct scan_context * ctx, int frontend_fd, struct transponder * t) {
   int sequence_len = 0;
   struct dtv_property cmds[13];
   struct dtv_properties cmdseq = {.num=0, .props=cmds};
@@ -1369,14 +1617,14 @@ static int set_frontend(int frontend_fd, struct transponder * t) {
   switch(t->type) {
      case SCAN_TERRESTRIAL:
         if (t->delsys == SYS_DVBT2) {
-           if (!(fe_info.caps & FE_CAN_2G_MODULATION)) {
+           if (!(ctx->fe_info.caps & FE_CAN_2G_MODULATION)) {
               info("\t%d: skipped (no driver support of DVBT2)\n", t->frequency);
               return -2;
               }
            }
         // no break needed here.
      case SCAN_TERRCABLE_ATSC:
-        if ((t->frequency < fe_info.frequency_min) || (t->frequency > fe_info.frequency_max)) {
+        if ((t->frequency < ctx->fe_info.frequency_min) || (t->frequency > ctx->fe_info.frequency_max)) {
            info("\t skipped: (freq %u unsupported by driver)\n", t->frequency);
            return -2;
            }
@@ -1386,7 +1634,7 @@ static int set_frontend(int frontend_fd, struct transponder * t) {
 
   // if (mem_is_zero(&t->param, sizeof(struct tuning_parameters)))
   //    return -1;
-  switch(flags.api_version) {
+  switch(ctx->flags.api_version) {
      case 0x0500 ... 0x05FF:
         #ifdef HWDBG
         #define set_cmd_sequence(_cmd, _data)   cmds[sequence_len].cmd = _cmd; \
@@ -1403,7 +1651,7 @@ static int set_frontend(int frontend_fd, struct transponder * t) {
         switch(t->type) {
            case SCAN_TERRESTRIAL:
               set_cmd_sequence(DTV_DELIVERY_SYSTEM,   t->delsys);
-              if (t->delsys == SYS_DVBT2 && multistream) {
+              if (t->delsys == SYS_DVBT2 && ctx->multistream) {
                  set_cmd_sequence(DTV_STREAM_ID, t->plp_id);
                  }
               set_cmd_sequence(DTV_FREQUENCY,         t->frequency);
@@ -1435,20 +1683,17 @@ static int set_frontend(int frontend_fd, struct transponder * t) {
         }
         break;
      default:
-        fatal("unsupported DVB API Version %d.%d\n", flags.api_version >> 8, flags.api_version & 0xFF);
+        fatal("unsupported DVB API Version %d.%d\n", ctx->flags.api_version >> 8, ctx->flags.api_version & 0xFF);
      }
   return 0;
 }
 
-void init_tp(struct transponder * t) {
-  current_tp = t;
-  if (current_tp->network_name != NULL) {
-     free(current_tp->network_name);
-     current_tp->network_name = NULL;
-     }
+void init_tp(struct scan_context * ctx, struct transponder * t) {
+  ctx->current_tp = t;
+  ctx->current_tp->network_name = NULL;
 }
 
-uint16_t fe_get_delsys(int frontend_fd, struct transponder * t) {
+uint16_t fe_get_delsys(struct scan_context * ctx, int frontend_fd, struct transponder * t) {
   struct dtv_property p[] = {{.cmd = DTV_DELIVERY_SYSTEM }};
   struct dtv_properties b = {.num = 1, .props = p};
 
@@ -1472,10 +1717,6 @@ static void copy_fe_params(struct transponder * dest, struct transponder * sourc
 }
 
 
-#define MOD_USE_STANDARD  0x0
-#define MOD_OVERRIDE_MIN  0x1
-#define MOD_OVERRIDE_MAX  0x2
-
 #define DVB_ADAPTER_MAX    32
 #define DVB_ADAPTER_SCAN   16
 #define DVB_ADAPTER_AUTO  999
@@ -1483,7 +1724,79 @@ static void copy_fe_params(struct transponder * dest, struct transponder * sourc
 
 #define cl(x)  if (x) { free(x); x=NULL; }  
 
-static void setup_filter(struct section_buf * s, const char * dmx_devname,
+/* adaptive filter timeouts: two bounds of the repetition interval of each table are measured on
+ * the current transponder, collected in tp_timing[] and kept per network in table_timings, which
+ * is saved with -k:
+ *   - the interval itself, if a filter sees its first section again. Only tables with several
+ *     sections (NIT other, SDT other, multi section NIT/SDT actual) stay open long enough.
+ *   - the time from starting the filter until its first section. That is a point somewhere within
+ *     the repetition cycle, but the longest one seen on several transponders comes close to the
+ *     interval. Single section tables, i.e. PAT, PMT and mostly SDT and NIT actual, complete on
+ *     their first section and only provide this one.
+ * Filters for a table start with twice the longest value seen, instead of repetition_rate(),
+ * once it was measured on LEARNED_SAMPLES transponders.
+ * The time until a table was complete isn't used: on one transponder it may be far below the interval.
+ */
+#define LEARNED_MIN     250     // msec, lower limit of learned filter timeouts
+#define LEARNED_SAMPLES 3
+#define IDLE_INTERVALS  2       // stop a filter if no new section arrived for this many repetition intervals
+
+static void learn_timing(struct scan_context * ctx, int table_id, uint32_t msec) {
+  if ((table_id >= 0) && (table_id < 256) && (msec > ctx->tp_timing[table_id]))
+     ctx->tp_timing[table_id] = msec;
+}
+
+// transponder t is done, move its timings to its network.
+static void store_timings(struct scan_context * ctx, struct transponder * t) {
+  struct table_timing * tt;
+  int table_id;
+
+  for(table_id = 0; table_id < 256; table_id++) {
+     if (ctx->tp_timing[table_id] == 0)
+        continue;
+     for(tt = ctx->table_timings->first; tt; tt = tt->next) {
+        if ((tt->table_id == table_id) && (tt->original_network_id == t->original_network_id) &&
+            (tt->network_id == t->network_id))
+           break;
+        }
+     if (tt == NULL) {
+        tt = session_alloc(ctx, sizeof(* tt));
+        tt->original_network_id = t->original_network_id;
+        tt->network_id = t->network_id;
+        tt->table_id = table_id;
+        AddItem(ctx->table_timings, tt);
+        }
+     tt->msec = max(tt->msec, ctx->tp_timing[table_id]);
+     if (tt->samples < 0xFFFF)
+        tt->samples++;
+     ctx->tp_timing[table_id] = 0;
+     }
+}
+
+/* returns the learned filter timeout in msec for table_id on the network of current_tp,
+ * or on any network if it isn't known yet. 0, if nothing was learned for this table.
+ */
+static uint32_t learned_timeout(struct scan_context * ctx, int table_id) {
+  struct table_timing * tt;
+  uint32_t msec = 0, network_msec = 0;
+
+  for(tt = ctx->table_timings->first; tt; tt = tt->next) {
+     if ((tt->table_id != table_id) || (tt->samples < LEARNED_SAMPLES))
+        continue;
+     msec = max(msec, tt->msec);
+     if (ctx->current_tp && (ctx->current_tp->original_network_id || ctx->current_tp->network_id) &&
+         (tt->original_network_id == ctx->current_tp->original_network_id) &&
+         (tt->network_id == ctx->current_tp->network_id))
+        network_msec = tt->msec;
+     }
+  if (network_msec)
+     msec = network_msec;
+  if (msec == 0)
+     return 0;
+  return max(2 * msec, LEARNED_MIN);
+}
+
+static void setup_filter(struct scan_context * ctx, struct section_buf * s, const char * dmx_devname,
                           int pid, int table_id, int table_id_ext,
                           int run_once, int segmented, uint32_t filter_flags) {
   memset(s, 0, sizeof(struct section_buf));
@@ -1496,10 +1809,14 @@ static void setup_filter(struct section_buf * s, const char * dmx_devname,
 
   s->run_once = run_once;
   s->segmented = segmented;
-  s->timeout = 5; // 5 sec safety buffer
-  s->timeout += repetition_rate(flags.scantype, table_id);
-  s->timeout = s->timeout * flags.timeout_multiplier; //currently no option to increase filter timeouts, we use the timeout_multiplier here
-  debug("Timeout length for table_id %d: %lld seconds.\n",table_id, (long long) s->timeout);
+  if ((s->timeout = learned_timeout(ctx, table_id)) == 0) {
+     s->timeout = repetition_rate(ctx->flags.scantype, table_id);
+     s->timeout += s->timeout / 4; // allow some jitter of the repetition rate
+     }
+  s->timeout = s->timeout * ctx->flags.timeout_multiplier; //currently no option to increase filter timeouts, we use the timeout_multiplier here
+  debug("Timeout length for table_id %d: %u msec.\n",table_id, s->timeout);
+  s->heap_index = -1;
+  s->first_section = -1;
   s->table_id_ext = table_id_ext;
   s->section_version_number = -1;
   s->next = 0;
@@ -1507,30 +1824,134 @@ static void setup_filter(struct section_buf * s, const char * dmx_devname,
   s->garbage = NULL;
 }
 
-static void update_poll_fds(void) {
+static void update_poll_fds(struct scan_context * ctx) {
   struct section_buf * s;
   int i;
 
-  memset(poll_section_bufs, 0, sizeof(poll_section_bufs));
+  memset(ctx->poll_section_bufs, 0, sizeof(ctx->poll_section_bufs));
   for(i = 0; i < MAX_RUNNING; i++)
-     poll_fds[i].fd = -1;
+     ctx->poll_fds[i].fd = -1;
   i = 0;
-  for(s = running_filters->first; s; s = s->next) {
+  for(s = ctx->running_filters->first; s; s = s->next) {
      if (i >= MAX_RUNNING)
         fatal("too many poll_fds\n");
      if (s->fd == -1)
         fatal("s->fd == -1 on running_filters\n");
      verbosedebug("poll fd %d\n", s->fd);
-     poll_fds[i].fd = s->fd;
-     poll_fds[i].events = POLLIN;
-     poll_fds[i].revents = 0;
-     poll_section_bufs[i] = s;
+     ctx->poll_fds[i].fd = s->fd;
+     ctx->poll_fds[i].events = POLLIN;
+     ctx->poll_fds[i].revents = 0;
+     ctx->poll_section_bufs[i] = s;
      i++;
      }
-  if (i != n_running)
+  if (i != ctx->n_running)
      fatal("n_running is hosed\n");
 }
 
+static bool deadline_before(struct scan_context * ctx, int a, int b) {
+  return timespec_cmp(&ctx->filter_heap[a]->deadline, &ctx->filter_heap[b]->deadline) < 0;
+}
+
+static void heap_swap(struct scan_context * ctx, int a, int b) {
+  struct section_buf * s = ctx->filter_heap[a];
+
+  ctx->filter_heap[a] = ctx->filter_heap[b];
+  ctx->filter_heap[b] = s;
+  ctx->filter_heap[a]->heap_index = a;
+  ctx->filter_heap[b]->heap_index = b;
+}
+
+static void heap_up(struct scan_context * ctx, int i) {
+  while((i > 0) && deadline_before(ctx, i, (i - 1) / 2)) {
+     heap_swap(ctx, i, (i - 1) / 2);
+     i = (i - 1) / 2;
+     }
+}
+
+static void heap_down(struct scan_context * ctx, int i) {
+  int child;
+
+  while((child = 2 * i + 1) < ctx->heap_count) {
+     if ((child + 1 < ctx->heap_count) && deadline_before(ctx, child + 1, child))
+        child++;
+     if (! deadline_before(ctx, child, i))
+        break;
+     heap_swap(ctx, i, child);
+     i = child;
+     }
+}
+
+static void heap_add(struct scan_context * ctx, struct section_buf * s) {
+  if (ctx->heap_count == ctx->heap_size) {
+     ctx->heap_size = ctx->heap_size ? 2 * ctx->heap_size : MAX_RUNNING;
+     ctx->filter_heap = realloc(ctx->filter_heap, ctx->heap_size * sizeof(* ctx->filter_heap));
+     }
+  s->heap_index = ctx->heap_count;
+  ctx->filter_heap[ctx->heap_count++] = s;
+  heap_up(ctx, s->heap_index);
+}
+
+static void heap_remove(struct scan_context * ctx, struct section_buf * s) {
+  int i = s->heap_index;
+
+  if (i < 0)
+     return;
+  s->heap_index = -1;
+  if (i == --ctx->heap_count)
+     return;
+  ctx->filter_heap[i] = ctx->filter_heap[ctx->heap_count];
+  ctx->filter_heap[i]->heap_index = i;
+  heap_up(ctx, i);
+  heap_down(ctx, ctx->filter_heap[i]->heap_index);
+}
+
+// (re-)calculate deadline of a running filter, i.e. after its timeout changed.
+static void set_deadline(struct scan_context * ctx, struct section_buf * s) {
+  add_timeout(s->timeout, &s->start_time, &s->deadline);
+  if (s->heap_index >= 0) {
+     heap_up(ctx, s->heap_index);
+     heap_down(ctx, s->heap_index);
+     }
+}
+
+/* measures the time until the first section and the repetition interval of the table from the
+ * first section seen coming again, see LEARNED_MIN. Once the interval is known, the filter ends
+ * if no new section arrived for IDLE_INTERVALS intervals.
+ */
+static void section_timing(struct scan_context * ctx, struct section_buf * s, int section, bool is_new) {
+  struct timespec now, idle;
+
+  get_time(&now);
+  if (is_new) {
+     s->last_new = now;
+     if (s->first_section < 0) {
+        s->first_section = section;
+        s->first_seen = now;
+        learn_timing(ctx, s->table_id, elapsed(&s->start_time, &now) * 1000);
+        }
+     }
+  else if ((section == s->first_section) && (s->interval == 0)) {
+     s->interval = elapsed(&s->first_seen, &now) * 1000;
+     learn_timing(ctx, s->table_id, s->interval);
+     verbosedebug("pid %d table_id 0x%02x: repetition interval %u msec\n", s->pid, s->table_id, s->interval);
+     }
+
+  if (s->interval && (s->heap_index >= 0)) {
+     add_timeout(IDLE_INTERVALS * s->interval, &s->last_new, &idle);
+     if (timespec_cmp(&idle, &s->deadline) < 0) {
+        s->deadline = idle;
+        heap_up(ctx, s->heap_index);
+        }
+     }
+}
+
+// msec until the next filter deadline, for poll().
+static int next_deadline(struct scan_context * ctx) {
+  if (ctx->heap_count == 0)
+     return 0;
+  return timeout_remaining(&ctx->filter_heap[0]->deadline);
+}
+
 static int get_bit(uint8_t *bitfield, int bit) {
   return (bitfield[bit/8] >> (bit % 8)) & 1;
 }
@@ -1543,7 +1964,8 @@ static void set_bit(uint8_t *bitfield, int bit) {
  *           1 when all sections are read on this pid
  *          -1 on invalid table id
  */
-static int parse_section(struct section_buf * s) {
+static int parse_section(struct scan_context * ctx, struct section_buf * s) {
+  struct section_buf * f = s;                                     // the running filter, s may become a segment of it.
   const unsigned char * buf = s->buf;
   uint8_t  table_id;
   uint16_t section_length;                                        // 12bit: 0..4095
@@ -1560,13 +1982,14 @@ static int parse_section(struct section_buf * s) {
 
   if (! crc_check(&buf[0],section_length+12)) {
      int verbosity = 5;
-     int slow_rep_rate = 30 + repetition_rate(flags.scantype, s->table_id);
+     uint32_t slow_rep_rate = 30000 + repetition_rate(ctx->flags.scantype, s->table_id);
 
      hexdump(__FUNCTION__,&buf[0], section_length+14);
      if (s->timeout < slow_rep_rate) {
-        info("increasing filter timeout to %d secs (pid:%d table_id:%d table_id_ext:%d).\n",
+        info("increasing filter timeout to %u msec (pid:%d table_id:%d table_id_ext:%d).\n",
              slow_rep_rate,s->pid,s->table_id, s->table_id_ext);
         s->timeout = slow_rep_rate;
+        set_deadline(ctx, s);
         }
 
      pList list = s->garbage;
@@ -1576,7 +1999,7 @@ static int parse_section(struct section_buf * s) {
         NewList(list, "s->garbage");
         s->garbage = list;
         }
-     memcpy(&p[sizeof(cItem)-1], buf, SECTION_BUF_SIZE);
+     memcpy(&p[sizeof(cItem)], buf, SECTION_BUF_SIZE);
      AddItem(s->garbage, p);
      return 0;
      }
@@ -1595,7 +2018,7 @@ static int parse_section(struct section_buf * s) {
         }
      if (s->table_id_ext != table_id_ext) {
         assert(s->next_seg == NULL);
-        s->next_seg = calloc(1, sizeof(struct section_buf));
+        s->next_seg = alloc_section_buf(ctx);
         s->next_seg->segmented = s->segmented;
         s->next_seg->run_once = s->run_once;
         s->next_seg->timeout = s->timeout;
@@ -1625,6 +2048,7 @@ static int parse_section(struct section_buf * s) {
 
   if (!get_bit(s->section_done, section_number)) {
      set_bit(s->section_done, section_number);
+     section_timing(ctx, f, table_id_ext << 8 | section_number, true);
 
      verbosedebug("pid %d (0x%02x), tid %d (0x%02x), table_id_ext %d (0x%04x), "
          "section_number %i, last_section_number %i, version %i\n",
@@ -1636,28 +2060,31 @@ static int parse_section(struct section_buf * s) {
      switch(table_id) {
      case TABLE_PAT:
         //verbose("PAT for transport_stream_id %d (0x%04x)\n", table_id_ext, table_id_ext);
-        parse_pat(buf, section_length, table_id_ext, s->flags);
+        ctx->current_tp->pat_version = section_version_number;
+        parse_pat(ctx, buf, section_length, table_id_ext, s->flags);
         break;
      case TABLE_PMT:
         moreverbose("PMT %d (0x%04x) for service %d (0x%04x)\n", s->pid, s->pid, table_id_ext, table_id_ext);
-        parse_pmt(buf, section_length, table_id_ext);
+        parse_pmt(ctx, buf, section_length, table_id_ext);
         break;
      case TABLE_NIT_ACT:
      case TABLE_NIT_OTH:
         //verbose("NIT(%s TS, network_id %d (0x%04x) )\n", table_id == 0x40 ? "actual":"other",
         //       table_id_ext, table_id_ext);
-        parse_nit(buf, section_length, table_id, table_id_ext, s->flags);
+        parse_nit(ctx, buf, section_length, table_id, table_id_ext, s->flags);
         break;
      case TABLE_SDT_ACT:
      case TABLE_SDT_OTH:
         moreverbose("SDT(%s TS, transport_stream_id %d (0x%04x) )\n", table_id == 0x42 ? "actual":"other",
                table_id_ext, table_id_ext);
-        parse_sdt(buf, section_length, table_id_ext);
+        if (table_id == TABLE_SDT_ACT)
+           ctx->current_tp->sdt_version = section_version_number;
+        parse_sdt(ctx, buf, section_length, table_id_ext);
         break;
      case TABLE_VCT_TERR:
      case TABLE_VCT_CABLE:
         moreverbose("ATSC VCT, table_id %d, table_id_ext %d\n", table_id, table_id_ext);
-        parse_psip_vct(buf, section_length, table_id, table_id_ext);
+        parse_psip_vct(ctx, buf, section_length, table_id, table_id_ext);
         break;
      default:;
      }
@@ -1669,6 +2096,8 @@ static int parse_section(struct section_buf * s) {
      if (i > last_section_number)
         s->sectionfilter_done = 1;
   }
+  else
+     section_timing(ctx, f, table_id_ext << 8 | section_number, false);
 
   if (s->segmented) {
      /* always wait for timeout; this is because we don't now how
@@ -1682,7 +2111,7 @@ static int parse_section(struct section_buf * s) {
   return 0;
 }
 
-static int read_sections(struct section_buf * s) {
+static int read_sections(struct scan_context * ctx, struct section_buf * s) {
   int section_length, count;
 
   if (s->sectionfilter_done && !s->segmented)
@@ -1706,16 +2135,72 @@ static int read_sections(struct section_buf * s) {
   if (count != section_length + 3)
      return -1;
 
-  if (parse_section(s) == 1)
+  if (parse_section(ctx, s) == 1)
      return 1;
 
   return 0;
 }
 
-static int start_filter(struct section_buf * s) {
+static void ts_section(uint16_t pid, const uint8_t * section, uint16_t len, void * priv);
+
+static int start_ts_filter(struct scan_context * ctx, struct section_buf * s) {
+  struct dmx_pes_filter_params f;
+  uint16_t pid = s->pid;
+
+  if ((ctx->ts_fd < 0) && (ctx->ts_input != NULL)) {
+     // the fd only marks the filters as running.
+     ctx->ts_fd = ctx->ts_input->fd;
+     ts_demux_init(&ctx->ts_demux, ts_section, ctx);
+     }
+  else if (ctx->ts_fd < 0) {
+     if ((ctx->ts_fd = open(s->dmx_devname, O_RDWR | O_NONBLOCK)) < 0) {
+        warning("%s: could not open demux.\n", __FUNCTION__);
+        return -1;
+        }
+     if (ioctl(ctx->ts_fd, DMX_SET_BUFFER_SIZE, TS_BUFFER_SIZE) == -1)
+        verbose("%s: could not set demux buffer size.\n", __FUNCTION__);
+
+     memset(&f, 0, sizeof(f));
+     f.pid      = pid;
+     f.input    = DMX_IN_FRONTEND;
+     f.output   = DMX_OUT_TSDEMUX_TAP;
+     f.pes_type = DMX_PES_OTHER;
+     f.flags    = DMX_IMMEDIATE_START;
+     if (ioctl(ctx->ts_fd, DMX_SET_PES_FILTER, &f) == -1) {
+        errorn("ioctl DMX_SET_PES_FILTER failed");
+        close(ctx->ts_fd);
+        ctx->ts_fd = -1;
+        return -1;
+        }
+     ts_demux_init(&ctx->ts_demux, ts_section, ctx);
+     }
+  else if ((ctx->ts_demux.pids[pid] == NULL) && (ctx->ts_input == NULL) && (ioctl(ctx->ts_fd, DMX_ADD_PID, &pid) == -1)) {
+     errorn("ioctl DMX_ADD_PID failed");
+     return -1;
+     }
+  ts_demux_add_pid(&ctx->ts_demux, pid);
+
+  verbosedebug("%s pid %d (0x%04x) table_id 0x%02x\n",
+               __FUNCTION__, s->pid, s->pid, s->table_id);
+
+  s->fd = ctx->ts_fd;
+  s->ts_start = ctx->ts_input_fed;
+  s->sectionfilter_done = 0;
+  get_time(&s->start_time);
+  set_deadline(ctx, s);
+  heap_add(ctx, s);
+  AddItem(ctx->running_filters, s);
+  ctx->n_running++;
+  return 0;
+}
+
+static int start_filter(struct scan_context * ctx, struct section_buf * s) {
   struct dmx_sct_filter_params f;
 
-  if (n_running >= MAX_RUNNING) {
+  if (ctx->use_ts_demux)
+     return start_ts_filter(ctx, s);
+
+  if (ctx->n_running >= MAX_RUNNING) {
      verbose("%s: too much filters. skip for now\n", __FUNCTION__); 
      goto err0;
      }
@@ -1744,12 +2229,14 @@ static int start_filter(struct section_buf * s) {
      }
 
   s->sectionfilter_done = 0;
-  time(&s->start_time);
+  get_time(&s->start_time);
+  set_deadline(ctx, s);
+  heap_add(ctx, s);
 
-  AddItem(running_filters, s);
+  AddItem(ctx->running_filters, s);
 
-  n_running++;
-  update_poll_fds();
+  ctx->n_running++;
+  update_poll_fds(ctx);
 
   return 0;
 
@@ -1760,18 +2247,41 @@ static int start_filter(struct section_buf * s) {
      return -1;
 }
 
-static void stop_filter(struct section_buf * s) {
+static void stop_filter(struct scan_context * ctx, struct section_buf * s) {
+  struct timespec now;
+
   verbosedebug("%s: pid %d (0x%04x)\n", __FUNCTION__,s->pid,s->pid);
 
-  ioctl(s->fd, DMX_STOP);
-  close(s->fd);
+  if (ctx->use_ts_demux) {
+     uint16_t pid = s->pid;
+     if ((ts_demux_remove_pid(&ctx->ts_demux, pid) == 0) && (ctx->running_filters->count > 1) && (ctx->ts_input == NULL))
+        ioctl(ctx->ts_fd, DMX_REMOVE_PID, &pid);
+     }
+  else {
+     ioctl(s->fd, DMX_STOP);
+     close(s->fd);
+     }
 
   s->fd = -1;
-  UnlinkItem(running_filters, s, false);
-  s->running_time += time(NULL) - s->start_time;
-
-  n_running--;
-  update_poll_fds();
+  UnlinkItem(ctx->running_filters, s, false);
+  heap_remove(ctx, s);
+  get_time(&now);
+  s->running_time += elapsed(&s->start_time, &now) * 1000;
+
+  ctx->n_running--;
+  if (ctx->use_ts_demux) {
+     if (ctx->n_running == 0) {
+        // the next filters may be on another transponder.
+        if (ctx->ts_input == NULL) {
+           ioctl(ctx->ts_fd, DMX_STOP);
+           close(ctx->ts_fd);
+           }
+        ctx->ts_fd = -1;
+        ts_demux_free(&ctx->ts_demux);
+        }
+     }
+  else
+     update_poll_fds(ctx);
   if (s->garbage) {
      ClearList(s->garbage);
      free(s->garbage);
@@ -1779,31 +2289,31 @@ static void stop_filter(struct section_buf * s) {
 }
 
 
-static void add_filter(struct section_buf * s) {
+static void add_filter(struct scan_context * ctx, struct section_buf * s) {
   verbosedebug("%s %d: pid=%d (0x%04x), s=%p\n",
      __FUNCTION__,__LINE__,s->pid, s->pid, s);
   EMUL(em_addfilter, s)
-  if (start_filter(s)) // could not start filter immediately.
-     AddItem(waiting_filters, s);
+  if (start_filter(ctx, s)) // could not start filter immediately.
+     AddItem(ctx->waiting_filters, s);
 }
 
-static void remove_filter(struct section_buf * s) {
+static void remove_filter(struct scan_context * ctx, struct section_buf * s) {
   verbosedebug("%s: pid %d (0x%04x)\n",__FUNCTION__,s->pid,s->pid);
-  stop_filter(s);
+  stop_filter(ctx, s);
 
   if (s->flags & SECTION_FLAG_FREE) {
-     free(s);
+     free_section_buf(ctx, s);
      s = NULL;
      }
 
-  if (running_filters->count > (MAX_RUNNING - 1)) // maximum num of filters reached.
+  if (ctx->running_filters->count > (MAX_RUNNING - 1)) // maximum num of filters reached.
      return;
 
-  for(s = waiting_filters->first; s; s = s->next) {
-     UnlinkItem(waiting_filters, s, false);
-     if (start_filter(s)) {
+  for(s = ctx->waiting_filters->first; s; s = s->next) {
+     UnlinkItem(ctx->waiting_filters, s, false);
+     if (start_filter(ctx, s)) {
         // any non-zero is error -> put again to list.
-        InsertItem(waiting_filters, s, 0);
+        InsertItem(ctx->waiting_filters, s, 0);
         break;
         }
      }
@@ -1813,58 +2323,162 @@ static void remove_filter(struct section_buf * s) {
  * non-zero on success.
  * zero on timeout.
  */
-static int read_filters(void) {
+static void filter_timeout_info(struct section_buf * s) {
+  const char * intro = "        Info: no data from ";
+  // timeout waiting for data.
+  switch(s->table_id) {
+     case TABLE_PAT:       info   ("%sPAT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_CAT:       info   ("%sCAT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_PMT:       info   ("%sPMT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_TSDT:      info   ("%sTSDT after %.1f seconds\n",        intro, s->timeout / 1000.0); break;
+     case TABLE_NIT_ACT:   info   ("%sNIT(actual )after %.1f seconds\n", intro, s->timeout / 1000.0); break;
+     case TABLE_NIT_OTH:   verbose("%sNIT(other) after %.1f seconds\n",  intro, s->timeout / 1000.0); break; // not always available.
+     case TABLE_SDT_ACT:   info   ("%sSDT(actual) after %.1f seconds\n", intro, s->timeout / 1000.0); break;
+     case TABLE_SDT_OTH:   info   ("%sSDT(other) after %.1f seconds\n",  intro, s->timeout / 1000.0); break;
+     case TABLE_BAT:       info   ("%sBAT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_EIT_ACT:   info   ("%sEIT(actual) after %.1f seconds\n", intro, s->timeout / 1000.0); break;
+     case TABLE_EIT_OTH:   info   ("%sEIT(other) after %.1f seconds\n",  intro, s->timeout / 1000.0); break;
+     case TABLE_TDT:       info   ("%sTDT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_RST:       info   ("%sRST after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_TOT:       info   ("%sTOT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_AIT:       info   ("%sAIT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_CST:       info   ("%sCST after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_RCT:       info   ("%sRCT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_CIT:       info   ("%sCIT after %.1f seconds\n",         intro, s->timeout / 1000.0); break;
+     case TABLE_VCT_TERR:  info   ("%sVCT(terr) after %.1f seconds\n",   intro, s->timeout / 1000.0); break;
+     case TABLE_VCT_CABLE: info   ("%sVCT(cable) after %.1f seconds\n",  intro, s->timeout / 1000.0); break;
+     default:              info   ("%spid %u after %.1f seconds\n",      intro, s->pid, s->timeout / 1000.0);
+     }
+}
+
+static void filter_done(struct scan_context * ctx, struct section_buf * s, int done) {
+  if (s->run_once) {
+     if (done)
+        verbosedebug("filter success: pid 0x%04x\n", s->pid);
+     else
+        filter_timeout_info(s);
+     remove_filter(ctx, s);
+     }
+}
+
+// -T: called by ts_demux for each section on one of the pids of running filters.
+static void ts_section(uint16_t pid, const uint8_t * section, uint16_t len, void * priv) {
+  struct scan_context * ctx = priv;
+  struct section_buf * s;
+
+  for(s = ctx->running_filters->first; s; s = s->next) {
+     if ((s->pid != pid) || (s->table_id != section[0]))
+        continue;
+     if (s->sectionfilter_done && !s->segmented)
+        continue;
+     memcpy(s->buf, section, len);
+     parse_section(ctx, s);
+     }
+}
+
+// remove all filters which reached their deadline.
+static void expire_filters(struct scan_context * ctx) {
   struct section_buf * s;
-  int i, n, done = 0;
 
-  n = poll(poll_fds, n_running, 25);
-  if (n == -1)
+  while((ctx->heap_count > 0) && (timeout_remaining(&ctx->filter_heap[0]->deadline) == 0)) {
+     s = ctx->filter_heap[0];
+     if (! s->run_once) {
+        get_time(&s->start_time);
+        set_deadline(ctx, s);
+        continue;
+        }
+     filter_done(ctx, s, 0);
+     }
+}
+
+/* -f: remove all filters which saw the whole recording. A section which was already
+ * in progress at the end of the recording is waited for, at most one more round.
+ */
+static void expire_file_filters(struct scan_context * ctx) {
+  struct section_buf * s, * next;
+  struct ts_pid * p;
+  uint64_t fed;
+
+  for(s = ctx->running_filters->first; s; s = next) {
+     next = s->next;
+     fed = ctx->ts_input_fed - s->ts_start;
+     p = ctx->ts_demux.pids[s->pid];
+     if ((fed < ctx->ts_input->size) || ((fed < 2 * ctx->ts_input->size) && p && p->collecting && (p->len > 0)))
+        continue;
+     if (! s->run_once) {
+        s->ts_start = ctx->ts_input_fed;
+        continue;
+        }
+     filter_done(ctx, s, 0);
+     }
+}
+
+/* -f: feed the next part of the recording, starting again at its begin after the end.
+ * Filters started by a section of this part count from its end on.
+ */
+static void read_ts_file(struct scan_context * ctx) {
+  size_t count = min((size_t) TS_BUFFER_SIZE, ctx->ts_input->size - ctx->ts_input->pos);
+
+  ctx->ts_input_fed += count;
+  ts_demux_feed(&ctx->ts_demux, ctx->ts_input->data + ctx->ts_input->pos, count);
+  ctx->ts_input->pos += count;
+  if (ctx->ts_input->pos == ctx->ts_input->size) {
+     ctx->ts_input->pos = 0;
+     ts_demux_flush(&ctx->ts_demux);
+     }
+}
+
+static void read_ts_filters(struct scan_context * ctx) {
+  struct pollfd pfd = { .fd = ctx->ts_fd, .events = POLLIN };
+  struct section_buf * s, * next;
+  uint8_t buf[TS_PACKET_SIZE * 64];
+  int count;
+
+  if (ctx->ts_input != NULL)
+     read_ts_file(ctx);
+  else if (poll(&pfd, 1, next_deadline(ctx)) > 0) {
+     while(((count = read(ctx->ts_fd, buf, sizeof(buf))) > 0) || ((count < 0) && (errno == EOVERFLOW)))
+        if (count > 0)
+           ts_demux_feed(&ctx->ts_demux, buf, count);
+     }
+
+  for(s = ctx->running_filters->first; s; s = next) {
+     next = s->next;
+     if (s->sectionfilter_done && !s->segmented)
+        filter_done(ctx, s, 1);
+     }
+  if (ctx->ts_input != NULL)
+     expire_file_filters(ctx);
+  else
+     expire_filters(ctx);
+}
+
+/* waits for data or the next filter deadline, whichever comes first. */
+static void read_filters(struct scan_context * ctx) {
+  struct section_buf * ready[MAX_RUNNING];
+  int i, n, count = 0;
+
+  if (ctx->use_ts_demux) {
+     read_ts_filters(ctx);
+     return;
+     }
+
+  n = poll(ctx->poll_fds, ctx->n_running, next_deadline(ctx));
+  if (n == -1 && errno != EINTR)
      errorn("poll");
 
-  for(i = 0; i < n_running; i++) {
-     s = poll_section_bufs[i];
-     if (!s)
+  // remove_filter() rebuilds poll_fds, therefore collect the filters with data first.
+  for(i = 0; (n > 0) && (i < ctx->n_running); i++) {
+     if (!ctx->poll_section_bufs[i])
         fatal("poll_section_bufs[%d] is NULL\n", i);
-     if (poll_fds[i].revents)
-        done = read_sections(s) == 1;
-     else
-        done = 0; /* timeout */
-     if (done || time(NULL) > s->start_time + s->timeout) {
-        if (s->run_once) {
-           if (done)
-              verbosedebug("filter success: pid 0x%04x\n", s->pid);
-           else {
-              const char * intro = "        Info: no data from ";
-              // timeout waiting for data.
-              switch(s->table_id) {
-                 case TABLE_PAT:       info   ("%sPAT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_CAT:       info   ("%sCAT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_PMT:       info   ("%sPMT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_TSDT:      info   ("%sTSDT after %lld seconds\n",        intro, (long long) s->timeout); break;
-                 case TABLE_NIT_ACT:   info   ("%sNIT(actual )after %lld seconds\n", intro, (long long) s->timeout); break;
-                 case TABLE_NIT_OTH:   verbose("%sNIT(other) after %lld seconds\n",  intro, (long long) s->timeout); break; // not always available.
-                 case TABLE_SDT_ACT:   info   ("%sSDT(actual) after %lld seconds\n", intro, (long long) s->timeout); break;
-                 case TABLE_SDT_OTH:   info   ("%sSDT(other) after %lld seconds\n",  intro, (long long) s->timeout); break;
-                 case TABLE_BAT:       info   ("%sBAT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_EIT_ACT:   info   ("%sEIT(actual) after %lld seconds\n", intro, (long long) s->timeout); break;
-                 case TABLE_EIT_OTH:   info   ("%sEIT(other) after %lld seconds\n",  intro, (long long) s->timeout); break;
-                 case TABLE_TDT:       info   ("%sTDT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_RST:       info   ("%sRST after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_TOT:       info   ("%sTOT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_AIT:       info   ("%sAIT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_CST:       info   ("%sCST after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_RCT:       info   ("%sRCT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_CIT:       info   ("%sCIT after %lld seconds\n",         intro, (long long) s->timeout); break;
-                 case TABLE_VCT_TERR:  info   ("%sVCT(terr) after %lld seconds\n",   intro, (long long) s->timeout); break;
-                 case TABLE_VCT_CABLE: info   ("%sVCT(cable) after %lld seconds\n",  intro, (long long) s->timeout); break;
-                 default:              info   ("%spid %u after %lld seconds\n",      intro, s->pid, (long long) s->timeout);
-                 }
-             }
-           remove_filter(s);
-           }
-        }
+     if (ctx->poll_fds[i].revents)
+        ready[count++] = ctx->poll_section_bufs[i];
      }
-  return done;
+  for(i = 0; i < count; i++) {
+     if (read_sections(ctx, ready[i]) == 1)
+        filter_done(ctx, ready[i], 1);
+     }
+  expire_filters(ctx);
 }
 
 
@@ -1915,68 +2529,90 @@ void print_signal_info(int frontend_fd, struct transponder * t) {
 
 
 
-static void scan_services(void) {
-  struct section_buf s[4];
-  int result = 0;
-
-  // scan for services: start filters for SDT and PAT (slowest filters first)
-
-  setup_filter(&s[2], demux_devname, PID_SDT_BAT_ST, TABLE_SDT_ACT, -1, 1, 0, 0);
-  add_filter(&s[2]);
-
-  setup_filter(&s[3], demux_devname, PID_PAT, TABLE_PAT, -1, 1, 0, 0);
-  add_filter(&s[3]);
-
-  verbose("     SDT/PMT lookup..\n");
-  EMUL(em_readfilters, &result)
-  do { read_filters(); }
-     while((running_filters->count > 0) || (waiting_filters->count > 0));
-}
-
+/* drop all filters of the current transponder, i.e. if it turned out to be invalid. */
+static void cancel_filters(struct scan_context * ctx) {
+  struct section_buf * s;
 
-/* scans a successful tuned new transponder's
- * program association table && network information table for update of its
- * transponder data
- */
-static bool scan_pat_nit(int frontend_fd) {
-  struct section_buf s;
-  int result;
-  current_tp->network_PID = PID_NIT_ST;
-  memset(&s, 0, sizeof(s));
-  verbose("     PAT lookup..\n");
-  setup_filter(&s, demux_devname, PID_PAT, TABLE_PAT, -1, 1, 0, SECTION_FLAG_INITIAL);
-  add_filter(&s);
-  EMUL(em_readfilters, &result)
-  do { result = read_filters(); }                
-     while((running_filters->count > 0) || (waiting_filters->count > 0));
-  
-  if (result == 0) {
-     // doesnt look like valid tp.
-     return false;
+  while((s = ctx->waiting_filters->first)) {
+     UnlinkItem(ctx->waiting_filters, s, false);
+     if (s->flags & SECTION_FLAG_FREE)
+        free_section_buf(ctx, s);
      }
+  while((s = ctx->running_filters->first))
+     remove_filter(ctx, s);
+}
 
+/* NIT actual of the current transponder, on the network_PID announced by PAT. */
+static void start_nit(struct scan_context * ctx, int frontend_fd, struct section_buf * nit) {
   // cxd2820r overwrites silently delsys, toggling between SYS_DVBT && SYS_DVBT2.
   // Therefore updating current_tp, kindly asking driver for actual delsys.
-  fe_get_delsys(frontend_fd, current_tp);
-  memset(&s, 0, sizeof(s));
-  verbose("     NIT lookup..\n");
-  setup_filter(&s, demux_devname, current_tp->network_PID, TABLE_NIT_ACT, -1, 1, 0, SECTION_FLAG_INITIAL);
-  add_filter(&s);
-  EMUL(em_readfilters, &result)
-  do { result = read_filters(); }                
-     while((running_filters->count > 0) || (waiting_filters->count > 0));
-  return true;
+  fe_get_delsys(ctx, frontend_fd, ctx->current_tp);
+  setup_filter(ctx, nit, ctx->demux_devname, ctx->current_tp->network_PID, TABLE_NIT_ACT, -1, 1, 0, SECTION_FLAG_INITIAL);
+  add_filter(ctx, nit);
 }
 
-static int is_nearly_same_frequency(uint32_t f1, uint32_t f2, scantype_t type) {
-  uint32_t diff;
-  if (f1 == f2)
-     return 1;
-  diff = (f1 > f2) ? (f1 - f2) : (f2 - f1);
+/* scans a successful tuned new transponder: PAT and SDT actual are read at the same time,
+ * the PMT filters are started by parse_pat() as soon as a PAT section arrives. NIT actual
+ * follows as soon as PAT is complete: parse_nit() needs the transport_stream_id from PAT
+ * to find the entry of this transponder. Each filter is removed as soon as its table is
+ * complete, the transponder is done if no filter is left.
+ * returns false if no PAT was found, i.e. not a valid transponder.
+ */
+static bool scan_transponder(struct scan_context * ctx, int frontend_fd) {
+  struct section_buf pat, nit, sdt;
+  bool nit_started = false;
+  int result = 1, nit_result;
+
+  ctx->current_tp->network_PID = PID_NIT_ST;
+  verbose("     PAT/NIT/SDT/PMT lookup..\n");
+
+  setup_filter(ctx, &pat, ctx->demux_devname, PID_PAT, TABLE_PAT, -1, 1, 0, 0);
+  add_filter(ctx, &pat);
+  setup_filter(ctx, &sdt, ctx->demux_devname, PID_SDT_BAT_ST, TABLE_SDT_ACT, -1, 1, 0, 0);
+  add_filter(ctx, &sdt);
+
+  EMUL(em_readfilters, ctx, &result)
+  do {
+     read_filters(ctx);
+     if (ctx->interrupted) {
+        // incomplete transponder, not added to the result.
+        cancel_filters(ctx);
+        result = 0;
+        break;
+        }
+     if (pat.start_time.tv_sec && (pat.fd == -1) && !pat.sectionfilter_done) {
+        // PAT timed out, doesnt look like valid tp.
+        cancel_filters(ctx);
+        result = 0;
+        break;
+        }
+     if (!nit_started && pat.sectionfilter_done) {
+        start_nit(ctx, frontend_fd, &nit);
+        nit_started = true;
+        }
+     } while((ctx->running_filters->count > 0) || (ctx->waiting_filters->count > 0));
+
+  if (ctx->flags.emulate && result) {
+     // emulation reads all filters at once, so NIT is read after all others here.
+     start_nit(ctx, frontend_fd, &nit);
+     em_readfilters(ctx, &nit_result);
+     }
+
+  store_timings(ctx, ctx->current_tp);
+  return result != 0;
+}
+
+#define SAME_TP_RANGE 750000   // Hz, see is_nearly_same_frequency()
+
+static int is_nearly_same_frequency(uint32_t f1, uint32_t f2, scantype_t type) {
+  uint32_t diff;
+  if (f1 == f2)
+     return 1;
+  diff = (f1 > f2) ? (f1 - f2) : (f2 - f1);
   //FIXME: use symbolrate etc. to estimate bandwidth
   
    // 750kHz
-   if (diff < 750000) {
+   if (diff < SAME_TP_RANGE) {
       debug("f1 = %u is same TP as f2 = %u (diff=%d)\n", f1, f2, diff);
       return 1;
    }
@@ -1984,13 +2620,125 @@ static int is_nearly_same_frequency(uint32_t f1, uint32_t f2, scantype_t type) {
   return 0;
 }
 
+/* scanned_transponders ordered by frequency, so that the 'already scanned' checks
+ * only need to look at the transponders within SAME_TP_RANGE.
+ */
+
+// returns the first position in freq_index with a frequency >= f.
+static int freq_index_lower(struct scan_context * ctx, uint32_t f) {
+  int lo = 0, hi = ctx->freq_index_count, mid;
+
+  while(lo < hi) {
+     mid = (lo + hi) / 2;
+     if (ctx->freq_index[mid]->frequency < f)
+        lo = mid + 1;
+     else
+        hi = mid;
+     }
+  return lo;
+}
+
+// first position in freq_index which might be nearly the same frequency as f.
+static int freq_index_first(struct scan_context * ctx, uint32_t f) {
+  return freq_index_lower(ctx, f > SAME_TP_RANGE ? f - SAME_TP_RANGE + 1 : 0);
+}
+
+// all transponders in freq_index which might be nearly the same frequency as f.
+#define for_nearly_same_frequency(i, f) \
+  for(i = freq_index_first(ctx, f); (i < ctx->freq_index_count) && (ctx->freq_index[i]->frequency < (f) + SAME_TP_RANGE); i++)
+
+/* libt2scan callbacks. The public structs are filled on the stack, their strings
+ * point into the transponder's arena and are valid during the callback only.
+ */
+static int public_plp_id(struct transponder * t) {
+  if ((t->delsys != SYS_DVBT2) || (t->plp_id == NO_STREAM_ID_FILTER))
+     return -1;
+  return t->plp_id;
+}
+
+static void report_tune_result(struct scan_context * ctx, struct transponder * t, enum t2scan_tune_result result) {
+  if (ctx->callbacks.on_tune_result != NULL)
+     ctx->callbacks.on_tune_result(ctx->callback_priv, t->frequency, t->delsys, public_plp_id(t), result);
+}
+
+static void report_progress(struct scan_context * ctx, unsigned done, unsigned total) {
+  if (ctx->callbacks.on_progress != NULL)
+     ctx->callbacks.on_progress(ctx->callback_priv, done, total);
+}
+
+static void report_transponder(struct scan_context * ctx, struct transponder * t) {
+  struct t2scan_transponder pt;
+  struct t2scan_service ps;
+  struct service * s;
+
+  if ((ctx->callbacks.on_transponder == NULL) && (ctx->callbacks.on_service == NULL))
+     return;
+  memset(&pt, 0, sizeof(pt));
+  pt.frequency           = t->frequency;
+  pt.bandwidth           = t->bandwidth;
+  pt.delsys              = t->delsys;
+  pt.modulation          = t->modulation;
+  pt.plp_id              = public_plp_id(t);
+  pt.network_id          = t->network_id;
+  pt.original_network_id = t->original_network_id;
+  pt.transport_stream_id = t->transport_stream_id;
+  pt.network_name        = t->network_name;
+  pt.services            = t->services->count;
+  if (ctx->callbacks.on_transponder != NULL)
+     ctx->callbacks.on_transponder(ctx->callback_priv, &pt);
+  if (ctx->callbacks.on_service == NULL)
+     return;
+  for(s = t->services->first; s; s = s->next) {
+     memset(&ps, 0, sizeof(ps));
+     ps.service_id             = s->service_id;
+     ps.pmt_pid                = s->pmt_pid;
+     ps.pcr_pid                = s->pcr_pid;
+     ps.video_pid              = s->video_pid;
+     ps.teletext_pid           = s->teletext_pid;
+     ps.type                   = s->type;
+     ps.scrambled              = s->scrambled;
+     ps.logical_channel_number = s->logical_channel_number;
+     ps.name                   = s->service_name;
+     ps.provider_name          = s->provider_name;
+     ctx->callbacks.on_service(ctx->callback_priv, &pt, &ps);
+     }
+}
+
+/* adds a completely scanned transponder. Workers (-j) pass it on to the parent process at once,
+ * with -u it is written to the output, in libt2scan it is passed to the callbacks.
+ */
+static void add_scanned_transponder(struct scan_context * ctx, struct transponder * t) {
+  int i;
+
+  AddItem(ctx->scanned_transponders, t);
+  if (ctx->worker_fd >= 0) {
+     if (write_transponder(ctx->worker_fd, t) < 0)
+        errorn("writing scan result failed");
+     }
+  else if (stream_output)
+     stream_transponder(ctx, t);
+  else
+     report_transponder(ctx, t);
+  if (ctx->freq_index_count == ctx->freq_index_size) {
+     ctx->freq_index_size = ctx->freq_index_size ? 2 * ctx->freq_index_size : 64;
+     ctx->freq_index = realloc(ctx->freq_index, ctx->freq_index_size * sizeof(* ctx->freq_index));
+     }
+  // behind transponders on the same frequency, to keep the order of the list for them.
+  i = freq_index_lower(ctx, t->frequency + 1);
+  memmove(&ctx->freq_index[i + 1], &ctx->freq_index[i], (ctx->freq_index_count - i) * sizeof(* ctx->freq_index));
+  ctx->freq_index[i] = t;
+  ctx->freq_index_count++;
+}
+
 /* identify if tn is already in list of new transponders and needs PLP update */
-static int is_already_scanned_transponder_t2_samefreq(struct transponder * tn) {
+static int is_already_scanned_transponder_t2_samefreq(struct scan_context * ctx, struct transponder * tn) {
   int isProbablySame = 0;
   if (tn->delsys != SYS_DVBT2) return 0;
 
   struct transponder * t;
-  for(t = scanned_transponders->first; t; t = t->next) {
+  int i;
+  for_nearly_same_frequency(i, tn->frequency) {
+     t = ctx->freq_index[i];
      if ((t->type == tn->type) && is_nearly_same_frequency(t->frequency, tn->frequency, t->type)) {   
 
 
@@ -2000,6 +2748,7 @@ static int is_already_scanned_transponder_t2_samefreq(struct transponder * tn) {
               isProbablySame = 1;
               t->original_network_id = tn->original_network_id;
               t->network_id = tn->network_id;
+              ctx->dup_stale = true;
            }
            if (tn->original_network_id == 0 && tn->network_id == 0) { // NIT most likely hasn't been read in later scan, assume it's the same
               isProbablySame = 1;
@@ -2024,9 +2773,11 @@ static int is_already_scanned_transponder_t2_samefreq(struct transponder * tn) {
 
 
 /* identify wether tn is already in list of new transponders */
-static int is_already_scanned_transponder_plp(struct transponder * tn, int test_plp) {
+static int is_already_scanned_transponder_plp(struct scan_context * ctx, struct transponder * tn, int test_plp) {
   struct transponder * t;
-  for(t = scanned_transponders->first; t; t = t->next) {
+  int i;
+  for_nearly_same_frequency(i, tn->frequency) {
+     t = ctx->freq_index[i];
      switch(tn->type) {
         case SCAN_TERRESTRIAL:
            if ((t->type == tn->type) && is_nearly_same_frequency(t->frequency, tn->frequency, t->type)) {
@@ -2045,26 +2796,108 @@ static int is_already_scanned_transponder_plp(struct transponder * tn, int test_
   return 0;
 }
 
-static int is_already_scanned_transponder(struct transponder * tn) {
-  return is_already_scanned_transponder_plp(tn, 0);
+static int is_already_scanned_transponder(struct scan_context * ctx, struct transponder * tn) {
+  return is_already_scanned_transponder_plp(ctx, tn, 0);
 }
 
-static int find_duplicate_transponders(FILE * dest, struct transponder * tn, struct transponder * ts) {
+/* duplicate detection: links all transponders with same (ONID, NID, TSID) and all services
+ * with same (ONID, NID, service_id) in list order, using hash tables keyed by these ids.
+ * add_duplicates() appends one transponder, so streaming output (-u) doesn't need a pass over
+ * all transponders for each new one.
+ */
+struct dup_slot {
+  uint64_t key;
+  void * first;
+  void * last;
+};
+
+static struct dup_slot * dup_lookup(struct dup_slot * table, uint32_t size, uint64_t key) {
+  uint32_t i = ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1);
+
+  while(table[i].first && (table[i].key != key))
+     i = (i + 1) & (size - 1);
+  table[i].key = key;
+  return &table[i];
+}
+
+// slot for key in d, d is kept at most half full. The caller links into an unused slot.
+static struct dup_slot * dup_slot(struct dup_table * d, uint64_t key) {
+  struct dup_slot * slot, * old = d->slots;
+  uint32_t i, old_size = d->size;
+
+  if (2 * (d->count + 1) > d->size) {
+     d->size = d->size ? 2 * d->size : 64;
+     d->slots = calloc(d->size, sizeof(* d->slots));
+     for(i = 0; i < old_size; i++) {
+        if (old[i].first)
+           * dup_lookup(d->slots, d->size, old[i].key) = old[i];
+        }
+     free(old);
+     }
+  slot = dup_lookup(d->slots, d->size, key);
+  if (slot->first == NULL)
+     d->count++;
+  return slot;
+}
+
+static void dup_table_free(struct dup_table * d) {
+  free(d->slots);
+  d->slots = NULL;
+  d->size = d->count = 0;
+}
+
+// appends t and its services to the duplicate chains.
+static void add_duplicates(struct scan_context * ctx, struct transponder * t) {
+  struct dup_slot * slot;
+  struct service * s;
+  uint64_t network = (uint64_t) t->original_network_id << 16 | t->network_id;
+
+  slot = dup_slot(&ctx->dup_transponders, network << 16 | t->transport_stream_id);
+  t->dup_next = NULL;
+  if (slot->first)
+     ((struct transponder *) slot->last)->dup_next = t;
+  else
+     slot->first = t;
+  slot->last = t;
+  t->dup_first = slot->first;
+
+  for(s = t->services->first; s; s = s->next) {
+     slot = dup_slot(&ctx->dup_services, network << 16 | s->service_id);
+     s->dup_next = NULL;
+     if (slot->first)
+        ((struct service *) slot->last)->dup_next = s;
+     else
+        slot->first = s;
+     slot->last = s;
+     s->dup_first = slot->first;
+     }
+}
+
+// duplicate chains of all transponders from scratch.
+static void find_duplicates(struct scan_context * ctx) {
+  struct transponder * t;
+
+  dup_table_free(&ctx->dup_transponders);
+  dup_table_free(&ctx->dup_services);
+  ctx->dup_stale = false;
+  for(t = ctx->scanned_transponders->first; t; t = t->next)
+     add_duplicates(ctx, t);
+}
+
+/* returns non-zero, if the mux of tn was also found on another frequency,
+ * if 'all' is false only transponders after tn in the list are checked.
+ * Needs find_duplicates() first.
+ */
+static int find_duplicate_transponders(struct scan_context * ctx, FILE * dest, struct transponder * tn, bool all) {
   struct transponder * t;
   int is_dup = 0;
 
-  for(t = ts; t; t = t->next) {
+  for(t = all ? tn->dup_first : tn->dup_next; t; t = t->dup_next) {
     if ((t->type == tn->type) && is_nearly_same_frequency(t->frequency, tn->frequency, t->type)) 
          continue; // ensure we do not compare the transponder with itself
-      if (t->original_network_id != tn->original_network_id)
-         continue;
-      if (t->network_id != tn->network_id)
-         continue;
-      if (t->transport_stream_id != tn->transport_stream_id)
-         continue;
       // same ONID, NID, TID = same transponder
       if (dest) {
-         if (flags.reception_info>0) 
+         if (ctx->flags.reception_info>0) 
            fprintf(dest, ":# DUPLICATE: mux (%d,%d,%d) on %d (strength=%2.1f %s, quality=%2.1f %s) also found on %d\n",
              tn->original_network_id, 
              tn->network_id, 
@@ -2088,33 +2921,29 @@ static int find_duplicate_transponders(FILE * dest, struct transponder * tn, str
   return is_dup;
 }
 
-static int find_duplicate_services(FILE * dest, struct transponder * tn, struct transponder * ts, struct service * s) {
+/* same for service s of transponder tn within its network. */
+static int find_duplicate_services(struct scan_context * ctx, FILE * dest, struct transponder * tn, struct service * s, bool all) {
   struct transponder * t;
-  int s_original_network_id = tn->original_network_id;
-  int s_network_id = tn->network_id;
-  int s_service_id = s->service_id;
+  struct service * d;
   int is_dup = 0;
   char * s_name = "";
 
   if (s->service_name) s_name = s->service_name;
 
-  for(t = ts; t; t = t->next) {
+  for(d = all ? s->dup_first : s->dup_next; d; d = d->dup_next) {
+    t = d->transponder;
     if ((t->type == tn->type) && is_nearly_same_frequency(t->frequency, tn->frequency, t->type)) 
          continue; // ensure we do not compare the transponder with itself
-      for(s = (t->services)->first; s; s = s->next) {
-         if (s->service_id==s_service_id && t->original_network_id == s_original_network_id && t-> network_id == s_network_id) {
-           if (dest) {
-             if (flags.reception_info>0)
-               fprintf(dest, ":# DUPLICATE: service '%s' in network (%d, %d) on %d (strength=%2.1f %s, quality=%2.1f %s) also found on %d\n",
-                  s_name, s_original_network_id, s_network_id, freq_scale(tn->frequency, 1e-3), 
-                  tn->signal_strength, tn->signal_strength_unit, tn->signal_quality, tn->signal_quality_unit,freq_scale(t->frequency, 1e-3));
-             else
-               fprintf(dest, ":# DUPLICATE: service '%s' in network (%d, %d) on %d also found on %d\n",
-                  s_name, s_original_network_id, s_network_id, freq_scale(tn->frequency, 1e-3), freq_scale(t->frequency, 1e-3));
-           }  
-           is_dup = 1;
-         }
-      }
+      if (dest) {
+        if (ctx->flags.reception_info>0)
+          fprintf(dest, ":# DUPLICATE: service '%s' in network (%d, %d) on %d (strength=%2.1f %s, quality=%2.1f %s) also found on %d\n",
+             s_name, tn->original_network_id, tn->network_id, freq_scale(tn->frequency, 1e-3), 
+             tn->signal_strength, tn->signal_strength_unit, tn->signal_quality, tn->signal_quality_unit,freq_scale(t->frequency, 1e-3));
+        else
+          fprintf(dest, ":# DUPLICATE: service '%s' in network (%d, %d) on %d also found on %d\n",
+             s_name, tn->original_network_id, tn->network_id, freq_scale(tn->frequency, 1e-3), freq_scale(t->frequency, 1e-3));
+      }  
+      is_dup = 1;
   }
   return is_dup;
 }
@@ -2122,45 +2951,202 @@ static int find_duplicate_services(FILE * dest, struct transponder * tn, struct
 
 
 
-static void dump_lists(int adapter, int frontend) {
-  struct transponder * t;
+/* service types (-s) and FTA only (-E) */
+static bool service_wanted(struct scan_context * ctx, struct service * s) {
+  if (s->video_pid && !(serv_select & 1))                                         // vpid, this is tv
+     return false; /* no TV services */
+  if (!s->video_pid &&  (first_component(s, ES_AUDIO) || first_component(s, ES_AC3)) && !(serv_select & 2))       // no vpid, but apid or ac3pid, this is radio
+     return false; /* no radio services */
+  if (!s->video_pid && !(first_component(s, ES_AUDIO) || first_component(s, ES_AC3)) && !(serv_select & 4))       // no vpid, no apid, no ac3pid, this is service/other
+     return false; /* no data/other services */
+  if (s->scrambled && (ctx->flags.ca_select == 0))                                     // caid, this is scrambled tv or radio
+     return false; /* FTA only */
+  return true;
+}
+
+static bool have_output(enum __output_format format) {
+  int i;
+
+  for(i = 0; i < output_count; i++)
+     if (outputs[i].format == format)
+        return true;
+  return false;
+}
+
+/* opens all outputs and writes their headers. */
+static void open_outputs(struct scan_context * ctx, int adapter, int frontend) {
+  struct output * o;
+
+  for(o = outputs; o < outputs + output_count; o++) {
+     if (o->path == NULL)
+        o->dest = ctx->flags.emulate ? stderr:stdout; // no fprintf output to stdout /w emul. why? :(
+     else if ((o->dest = fopen(o->path, "w")) == NULL)
+        fatal("could not open output file '%s': %d %s\n", o->path, errno, strerror(errno));
+     o->flags = ctx->flags;
+     o->flags.vdr_version = o->vdr_version;
+     o->flags.print_pmt = o->print_pmt;
+     o->index = 0;
+     switch(o->format) {
+        case OUTPUT_VLC_M3U:
+           vlc_xspf_prolog(o->dest, adapter, frontend, &o->flags);
+           break;
+        case OUTPUT_XML:
+           xml_prolog(o->dest);
+           break;
+        default:;
+        }
+     }
+}
+
+static void close_outputs(void) {
+  struct output * o;
+
+  for(o = outputs; o < outputs + output_count; o++) {
+     switch(o->format) {
+        case OUTPUT_VLC_M3U:
+           vlc_xspf_epilog(o->dest);
+           break;
+        case OUTPUT_XML:
+           xml_epilog(o->dest);
+           break;
+        default:;
+        }
+     if (o->path != NULL) {
+        if (fclose(o->dest) != 0)
+           error("writing '%s' failed: %d %s\n", o->path, errno, strerror(errno));
+        }
+     else
+        fflush(o->dest);
+     o->dest = NULL;
+     }
+  fflush(stderr);
+  fflush(stdout);
+}
+
+/* writes transponder t and its services to all outputs.
+ * Duplicate and service filter decisions are made once and shared by all outputs.
+ * 'all': compare with all transponders in the list, otherwise only with the ones after t.
+ * returns the number of services written.
+ */
+static int dump_transponder(struct scan_context * ctx, struct transponder * t, bool all) {
+  struct output * o;
   struct service * s;
-  int n = 0, i, index = 0;
   char sn[20];
-  FILE * dest = flags.emulate ? stderr:stdout; // no fprintf output to stdout /w emul. why? :(
+  int i, n = 0;
+
+  for(o = outputs; o < outputs + output_count; o++) {
+     // XML contains all transponders.
+     if (o->format == OUTPUT_XML)
+        xml_dump_transponder(o->dest, t);
+     }
+  if (ctx->flags.dedup == 1 && find_duplicate_transponders(ctx, NULL, t, all))
+     return 0;
+
+  for(o = outputs; o < outputs + output_count; o++) {
+     o->mux_duplicate = 0;
+     if (ctx->flags.dedup == 2 && o->format == OUTPUT_VDR)
+        o->mux_duplicate = find_duplicate_transponders(ctx, o->dest, t, true);
+     if (o->format == OUTPUT_DVBSCAN_TUNING_DATA && ((t->source >> 8) == 64))
+        dvbscan_dump_tuningdata(o->dest, t, o->index++, &o->flags);
+     }
+
+  for(s = (t->services)->first; s; s = s->next) {
+     if (ctx->flags.dedup == 1 && find_duplicate_services(ctx, NULL, t, s, all))
+        continue;
+     if (!s->service_name) { // no service name in SDT                                
+        snprintf(sn, sizeof(sn), "service_id %d", s->service_id);
+        s->service_name = tp_strdup(t, sn);
+        }
+     /* ':' is field separator in vdr service lists */
+     for(i = 0; s->service_name[i]; i++) {
+        if (s->service_name[i] == ':')
+           s->service_name[i] = ' ';
+        }
+     for(i = 0; s->provider_name && s->provider_name[i]; i++) {
+        if (s->provider_name[i] == ':')
+           s->provider_name[i] = ' ';
+        }
+     if (! service_wanted(ctx, s))
+        continue;
+     n++;
+     for(o = outputs; o < outputs + output_count; o++) {
+        switch(o->format) {
+           case OUTPUT_VDR:
+              if (ctx->flags.dedup==2 && o->mux_duplicate==0) find_duplicate_services(ctx, o->dest, t, s, true);
+              vdr_dump_service_parameter_set(o->dest, s, t, &o->flags);
+              break;
+           case OUTPUT_XINE:
+              xine_dump_service_parameter_set(o->dest, s, t, &o->flags);
+              break;
+           case OUTPUT_MPLAYER:
+              mplayer_dump_service_parameter_set(o->dest, s, t, &o->flags);
+              break;
+           case OUTPUT_VLC_M3U:
+              vlc_dump_service_parameter_set_as_xspf(o->dest, s, t, &o->flags);
+              break;
+           default:
+              break;
+           }
+        }
+     }
+  return n;
+}
+
+/* streaming output (-u): called for every transponder added to scanned_transponders.
+ * Duplicates are only known among the transponders scanned so far, therefore
+ * the first instance of a mux or service is kept and later ones are dropped or marked.
+ */
+static void stream_transponder(struct scan_context * ctx, struct transponder * t) {
+  struct output * o;
+
+  if (ctx->dup_stale)
+     find_duplicates(ctx);
+  else
+     add_duplicates(ctx, t);
+  streamed_services += dump_transponder(ctx, t, true);
+  for(o = outputs; o < outputs + output_count; o++)
+     fflush(o->dest);
+}
+
+static void dump_lists(struct scan_context * ctx) {
+  struct transponder * t;
+  struct service * s;
+  int n = 0;
+
+  if (stream_output) {
+     close_outputs();
+     info("(time: %s) %d services written.\n", run_time(), streamed_services);
+     info("Done, scan time: %s\n", run_time());
+     return;
+     }
 
-  if (verbosity > 4) bubbleSort(scanned_transponders, cmp_freq_pol);
+  if (verbosity > 4) SortList(ctx->scanned_transponders, cmp_freq_pol);
+  find_duplicates(ctx);
 
   int duplicates_in_list = 0;
 
-  for(t = scanned_transponders->first; t; t = t->next) {
-     int tp_has_dup = find_duplicate_transponders(NULL, t, t);
+  for(t = ctx->scanned_transponders->first; t; t = t->next) {
+     int tp_has_dup = find_duplicate_transponders(ctx, NULL, t, false);
      if (tp_has_dup) duplicates_in_list = 1;
-     if (flags.dedup == 1 && tp_has_dup)
+     if (ctx->flags.dedup == 1 && tp_has_dup)
         continue;
 
      for(s = (t->services)->first; s; s = s->next) {
-        if (s->video_pid && !(serv_select & 1))
-           continue;  /* no TV services */
-        if (!s->video_pid &&  (s->audio_num || s->ac3_num) && !(serv_select & 2))
-           continue;  /* no radio services */
-        if (!s->video_pid && !(s->audio_num || s->ac3_num) && !(serv_select & 4))
-           continue;  /* no data/other services */
-        if (s->scrambled && (flags.ca_select == 0))
-           continue; /* FTA only */
-        int service_has_dup = find_duplicate_services(NULL, t, t, s);
+        if (! service_wanted(ctx, s))
+           continue;
+        int service_has_dup = find_duplicate_services(ctx, NULL, t, s, false);
         if (service_has_dup) duplicates_in_list = 1;
-        if (flags.dedup == 1 && service_has_dup)
+        if (ctx->flags.dedup == 1 && service_has_dup)
            continue; /* Duplicate service to be ignored */
         n++;
         }
      }
 
   if (duplicates_in_list) {
-     switch (flags.dedup) {
+     switch (ctx->flags.dedup) {
         case 2:
           info("NOTE: There are duplicate services in your channel list.");
-          if (output_format==OUTPUT_VDR) info(" They will be marked.\n");
+          if (have_output(OUTPUT_VDR)) info(" They will be marked.\n");
           else info("\n");
           break;
         case 1:
@@ -2173,93 +3159,33 @@ static void dump_lists(int adapter, int frontend) {
   }
   info("(time: %s) dumping lists (%d services)\n..\n", run_time(), n);
 
-  switch(output_format) {
-     case OUTPUT_VLC_M3U:
-        vlc_xspf_prolog(dest, adapter, frontend, &flags);
-        break;
-     case OUTPUT_XML:
-        xml_dump(dest, scanned_transponders);
-        break;
-     default:;
-     }
-
-  for(t = scanned_transponders->first; t; t = t->next) {
-     if (flags.dedup ==1 && find_duplicate_transponders(NULL, t, t))
-        continue;
-     int mux_duplicate = 0;
-     if (flags.dedup==2 && output_format==OUTPUT_VDR) {
-       mux_duplicate = find_duplicate_transponders(dest,t, scanned_transponders->first); 
-     }
-     if (output_format == OUTPUT_DVBSCAN_TUNING_DATA && ((t->source >> 8) == 64)) {
-        dvbscan_dump_tuningdata(dest, t, index++, &flags);
-        continue;
-        }
-    
-     for(s = (t->services)->first; s; s = s->next) {
-        if (flags.dedup ==1 && find_duplicate_services(NULL, t, t, s))
-           continue;
-        if (!s->service_name) { // no service name in SDT                                
-           snprintf(sn, sizeof(sn), "service_id %d", s->service_id);
-           s->service_name = strdup(sn);
-           }
-        /* ':' is field separator in vdr service lists */
-        for(i = 0; s->service_name[i]; i++) {
-           if (s->service_name[i] == ':')
-              s->service_name[i] = ' ';
-           }
-        for(i = 0; s->provider_name && s->provider_name[i]; i++) {
-           if (s->provider_name[i] == ':')
-              s->provider_name[i] = ' ';
-           }
-        if (s->video_pid && !(serv_select & 1))                                         // vpid, this is tv
-           continue; /* no TV services */
-        if (!s->video_pid &&  (s->audio_num || s->ac3_num) && !(serv_select & 2))       // no vpid, but apid or ac3pid, this is radio
-           continue; /* no radio services */
-        if (!s->video_pid && !(s->audio_num || s->ac3_num) && !(serv_select & 4))       // no vpid, no apid, no ac3pid, this is service/other
-           continue; /* no data/other services */
-        if (s->scrambled && (flags.ca_select == 0))                                     // caid, this is scrambled tv or radio
-           continue; /* FTA only */
-        switch(output_format) {
-           case OUTPUT_VDR:
-              if (flags.dedup==2 && mux_duplicate==0) find_duplicate_services(dest, t, scanned_transponders->first, s);
-              vdr_dump_service_parameter_set(dest, s, t, &flags);
-              break;
-           case OUTPUT_XINE:
-              xine_dump_service_parameter_set(dest, s, t, &flags);
-              break;
-           case OUTPUT_MPLAYER:
-              mplayer_dump_service_parameter_set(dest, s, t, &flags);
-              break;
-           case OUTPUT_VLC_M3U:
-              vlc_dump_service_parameter_set_as_xspf(dest, s, t, &flags);
-              break;
-           default:
-              break;
-           }
-     }
-  }
-  switch(output_format) {
-     case OUTPUT_VLC_M3U:
-        vlc_xspf_epilog(dest);
-        break;
-     default:;
-     }
-  fflush(stderr);
-  fflush(stdout);
+  for(t = ctx->scanned_transponders->first; t; t = t->next)
+     dump_transponder(ctx, t, false);
+  close_outputs();
   info("Done, scan time: %s\n", run_time());
 }
 
+/* SIGINT only sets a flag, the scan loops stop at their next check and the partial result
+ * is written as usual. The handler must not touch stdio or the lists. A second SIGINT
+ * exits immediately.
+ */
+static struct scan_context * sigint_ctx;         // the scan stopped by SIGINT
+
 static void handle_sigint(int sig) {
-  error("interrupted by SIGINT, dumping partial result...\n");
-  dump_lists(-1, -1);
-  exit(2);
+  static const char msg[] = "interrupted by SIGINT, stopping scan...\n";
+
+  if (sigint_ctx->interrupted)
+     _exit(2);
+  sigint_ctx->interrupted = 1;
+  if (write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0)
+     return;
 }
 
-static bool channel_in_userlist(int channel) {
+static bool channel_in_userlist(struct scan_context * ctx, int channel) {
   int i;
-  int channellist_length = sizeof(user_channellist) / sizeof(int);
+  int channellist_length = sizeof(ctx->user_channellist) / sizeof(int);
   for (i=0;i<channellist_length;i++)
-    if (user_channellist[i]==channel) return true;
+    if (ctx->user_channellist[i]==channel) return true;
   return false;
 }
 
@@ -2275,10 +3201,163 @@ fe_delivery_system_t atsc_del_sys(fe_modulation_t modulation) {
 
 
 
-static void network_scan(int frontend_fd, int tuning_data) {
+static void init_terrestrial_test(struct scan_context * ctx, struct transponder * test, uint32_t f, int channel, uint8_t delsys) {
+  test->type              = SCAN_TERRESTRIAL;
+  test->frequency         = f;
+  test->inversion         = ctx->caps_inversion;
+  test->bandwidth         = (__u32) bandwidth(channel, ctx->this_channellist);
+  test->coderate          = ctx->caps_fec;
+  test->coderate_LP       = ctx->caps_fec;
+  test->modulation        = ctx->caps_qam;
+  test->transmission      = ctx->caps_transmission_mode;
+  test->guard             = ctx->caps_guard_interval;
+  test->hierarchy         = ctx->caps_hierarchy;
+  test->delsys            = delsys;
+}
+
+/* signal strength for comparing channels: percent, or dBm if the driver supports it.
+ * returns -1000.0 if the strength is unknown.
+ */
+static double signal_level(int frontend_fd) {
+  struct dtv_property p[] = {{.cmd = DTV_STAT_SIGNAL_STRENGTH }};
+  struct dtv_properties cmdseq = {.num = 1, .props = p};
+  uint16_t strength;
+
+  if ((ioctl(frontend_fd, FE_GET_PROPERTY, &cmdseq) == 0) && (p[0].u.st.len > 0)) {
+     switch (p[0].u.st.stat[0].scale) {
+        case FE_SCALE_RELATIVE: return (p[0].u.st.stat[0].uvalue/65535.0)*100.0;
+        case FE_SCALE_DECIBEL:  return p[0].u.st.stat[0].svalue/1000.0;
+        default:;
+        }
+     }
+  if (ioctl(frontend_fd, FE_READ_SIGNAL_STRENGTH, &strength) == 0)
+     return (strength/65535.0)*100.0;
+  return -1000.0;
+}
+
+struct channel_level {
+  int channel;
+  double strength;
+};
+
+static int cmp_level(const void * a, const void * b) {
+  const struct channel_level * c1 = a, * c2 = b;
+  if (c1->strength < c2->strength) return 1;
+  if (c1->strength > c2->strength) return -1;
+  return c1->channel - c2->channel;
+}
+
+/* pre-sweep (-w): tune every channel only long enough to see wether there is any signal.
+ * channels is reduced to the channels with signal, strongest first. returns the new count.
+ */
+static int sweep_channels(struct scan_context * ctx, int frontend_fd, int * channels, int count) {
+  struct channel_level levels[count];
+  struct transponder test;
+  struct timespec timeout, meas_start;
+  uint8_t delsys = (ctx->flags.dvbt_type == 2) ? SYS_DVBT2 : SYS_DVBT;
+  uint32_t f;
+  int i, offs, n = 0;
+
+  info("Checking channels for signal...\n");
+  for(i = 0; (i < count) && !ctx->interrupted; i++) {
+     if (ctx->use_user_channellist && (!channel_in_userlist(ctx, channels[i]))) continue;
+     if (! (f = chan_to_freq(channels[i], ctx->this_channellist))) continue;
+     for(offs = ctx->freq_offset_min; offs <= (int) ctx->freq_offset_max; offs++)
+        if (freq_offset(channels[i], ctx->this_channellist, offs) != -1) break;
+     if (offs > (int) ctx->freq_offset_max) continue;
+     f += freq_offset(channels[i], ctx->this_channellist, offs);
+
+     memset(&test, 0, sizeof(test));
+     init_terrestrial_test(ctx, &test, f, channels[i], delsys);
+     test.plp_id = NO_STREAM_ID_FILTER;
+     if (set_frontend(ctx, frontend_fd, &test) < 0)
+        continue;
+     get_time(&meas_start);
+     set_timeout(SWEEP_TIMEOUT * ctx->flags.timeout_multiplier, &timeout);
+     if ((wait_frontend(ctx, frontend_fd, FE_HAS_SIGNAL | FE_HAS_CARRIER, 0, &timeout, &meas_start) &
+         (FE_HAS_SIGNAL | FE_HAS_CARRIER)) == 0) {
+        verbose("%d (CH%d): no signal\n", freq_scale(f, 1e-3), channels[i]);
+        continue;
+        }
+     levels[n].channel = channels[i];
+     levels[n].strength = signal_level(frontend_fd);
+     info("%d (CH%d): signal %.1f\n", freq_scale(f, 1e-3), channels[i], levels[n].strength);
+     n++;
+     }
+
+  qsort(levels, n, sizeof(levels[0]), cmp_level);
+  for(i = 0; i < n; i++)
+     channels[i] = levels[i].channel;
+  info("(time: %s) %d of %d channels with signal.\n", run_time(), n, count);
+  return n;
+}
+
+/* the channels scanned by network_scan(), in this order. Also sets up the modulation and delivery
+ * system loops, so a parallel scan (-j) does this once in the parent process, including the pre-sweep.
+ */
+static int network_channels(struct scan_context * ctx, int frontend_fd, int * channels) {
+  uint32_t channel;
+  int n_channels = 0;
+
+    //do last things before starting scan loop
+  switch(ctx->flags.scantype) {
+     case SCAN_TERRCABLE_ATSC:
+        switch(ctx->ATSC_type) {
+           case ATSC_VSB:
+              ctx->modulation_min=ctx->modulation_max=ATSC_VSB;
+              break;
+           case ATSC_QAM:
+              ctx->modulation_min=ctx->modulation_max=ATSC_QAM;
+              break;
+           default:
+              ctx->modulation_min=ATSC_VSB;
+              ctx->modulation_max=ATSC_QAM;
+              break;
+           }
+        break;
+     case SCAN_TERRESTRIAL:
+        // disable qam loop, disable symbolrate loop
+        ctx->modulation_min=ctx->modulation_max=0;
+        // enable legacy delsys loop.
+        ctx->delsys_min = delsysloop_min(0, ctx->this_channellist);
+        // enable T2 loop.
+        ctx->delsys_max = delsysloop_max(0, ctx->this_channellist);
+
+        break;
+     default:warning("unsupported delivery system %d.\n", ctx->flags.scantype);
+  }
+
+  for(channel=ctx->flags.channel_min; channel <= ctx->flags.channel_max; channel++)
+     channels[n_channels++] = channel;
+  if (ctx->pre_sweep && (ctx->flags.scantype == SCAN_TERRESTRIAL) && !ctx->flags.emulate)
+     n_channels = sweep_channels(ctx, frontend_fd, channels, n_channels);
+  return n_channels;
+}
+
+/* whether this context scans step of scan_channels(), one step being one channel with one modulation.
+ * The parent process of the workers (-j) hands out the steps on demand and in ascending order, so a
+ * worker busy with an occupied channel gets fewer of them. assigned is the last step this worker got.
+ */
+static bool own_step(struct scan_context * ctx, int step, int * assigned) {
+  int32_t next;
+
+  if (ctx->worker_fd < 0)
+     return true;
+  if (* assigned < step) {
+     if ((write_step_request(ctx->worker_fd) < 0) ||
+         (read(ctx->worker_step_fd, &next, sizeof(next)) != sizeof(next)))
+        next = INT32_MAX; // parent process gone, no more steps.
+     * assigned = next;
+     }
+  return * assigned == step;
+}
+
+static void scan_channels(struct scan_context * ctx, int frontend_fd, const int * channels, int n_channels) {
   uint32_t f = 0, channel, mod_parm, offs;
-  uint8_t delsys_parm, delsys = 0, last_delsys = 255;
-  uint16_t ret = 0, lastret = 0;
+  int ch_i, step, assigned = -1;
+  uint8_t delsys_parm, delsys = 0;
+  uint16_t ret = 0;
+  unsigned time2signal;
   int current_plp = -1;
   int plp_i = 0;
   int* my_plplist;
@@ -2291,243 +3370,693 @@ static void network_scan(int frontend_fd, int tuning_data) {
   memset(&test, 0, sizeof(test));
   struct timespec timeout, meas_start, meas_stop;
   uint16_t time2carrier = 8000, time2lock = 8000;  
+  unsigned n_steps;
 
 
-    //do last things before starting scan loop
-  switch(flags.scantype) {
+  n_steps = (ctx->modulation_max - ctx->modulation_min + 1) * n_channels;
+
+  if (ctx->flags.scantype == SCAN_TERRESTRIAL)
+     info("Scanning %s...\n", ctx->flags.dvbt_type == 1 ? "DVB-T" : ctx->flags.dvbt_type == 2 ? "DVB-T2" : "DVB-T and DVB-T2");
+
+  /* ATSC VSB, ATSC QAM, DVB-T, DVB-C, here,
+   * please change freqs inside country.c for ATSC, DVB-T, DVB-C
+   *
+   * each frequency is visited once, trying all delivery systems on it.
+   * If one delivery system doesn't find a carrier, the others are skipped.
+   */
+  for(mod_parm = ctx->modulation_min; (mod_parm <= ctx->modulation_max) && !ctx->interrupted; mod_parm++) {
+     for(ch_i = 0; (ch_i < n_channels) && !ctx->interrupted; ch_i++) {
+        step = (mod_parm - ctx->modulation_min) * n_channels + ch_i;
+        if (! own_step(ctx, step, &assigned))
+           continue; // scanned by another frontend (-j)
+        channel = channels[ch_i];
+        report_progress(ctx, step, n_steps);
+        for(offs = ctx->freq_offset_min; (offs <= ctx->freq_offset_max) && !ctx->interrupted; offs++) {
+           no_signal_on_freq = false; // first assume the frequency can be used
+           for(delsys_parm = ctx->delsys_min; (delsys_parm <= ctx->delsys_max) && !ctx->interrupted; delsys_parm++) {
+              if ((delsys_parm > 0) && ((ctx->fe_info.caps & FE_CAN_2G_MODULATION) == 0))
+                 break;
+              if (no_signal_on_freq)
+                 break; // no carrier with previous delivery system
+              test.type = ctx->flags.scantype;
+              switch(test.type) {
+                 case SCAN_TERRESTRIAL:
+                    delsys = delsys_parm == 0? SYS_DVBT : SYS_DVBT2;
+                    if (delsys==SYS_DVBT && ctx->flags.dvbt_type==2) continue;
+                    if (delsys==SYS_DVBT2 && ctx->flags.dvbt_type==1) continue;
+                    if (ctx->use_user_channellist && (!channel_in_userlist(ctx, channel))) continue;
+                    f = chan_to_freq(channel, ctx->this_channellist);
+                    if (! f) continue; //skip unused channels
+                    if (freq_offset(channel, ctx->this_channellist, offs) == -1)
+                       continue; //skip this one
+                    f += freq_offset(channel, ctx->this_channellist, offs);                
+                    if (test.bandwidth != (__u32) bandwidth(channel, ctx->this_channellist))
+                       info("Scanning %sMHz frequencies...\n", vdr_bandwidth_name(bandwidth(channel, ctx->this_channellist)));
+                    init_terrestrial_test(ctx, &test, f, channel, delsys);
+                    time2carrier = carrier_timeout(test.delsys);
+                    time2lock    = lock_timeout   (test.delsys);
+                    if (is_already_scanned_transponder(ctx, &test)) {
+                       info("%d (CH%d): skipped (already scanned transponder)\n", freq_scale(f, 1e-3),channel);
+                       continue;
+                    }
+                    info("%d (CH%d) DVB-%s: ", freq_scale(f, 1e-3),channel, delsys == SYS_DVBT?"T":"T2");
+                    break;
+                 case SCAN_TERRCABLE_ATSC:
+                    switch(mod_parm) {
+                        case ATSC_VSB:
+                            ctx->this_atsc = VSB_8;
+                            f = chan_to_freq(channel, ATSC_VSB);
+                            if (!f)
+                               continue;       //skip unused channels
+                            if (freq_offset(channel, ATSC_VSB, offs) == -1)
+                               continue;       //skip this one
+                            f += freq_offset(channel, ATSC_VSB, offs);
+                            break;
+                        case ATSC_QAM:
+                            ctx->this_atsc = QAM_256;
+                            f = chan_to_freq(channel, ATSC_QAM);
+                            if (!f)
+                               continue;       //skip unused channels
+                            if (freq_offset(channel, ATSC_QAM, offs) == -1)
+                               continue;       //skip this one
+                            f += freq_offset(channel, ATSC_QAM, offs);
+                            break;
+                        default:
+                            fatal("unknown modulation id\n");
+                    }
+                    test.frequency  = f;
+                    test.inversion  = ctx->caps_inversion;
+                    test.modulation = ctx->this_atsc;
+                    test.delsys     = atsc_del_sys(ctx->this_atsc);
+                    time2carrier    = carrier_timeout(test.delsys);
+                    time2lock       = lock_timeout(test.delsys);
+                    if (is_already_scanned_transponder(ctx, &test)) {
+                        info("%d %s: skipped (already known transponder)\n", freq_scale(f, 1e-3), atsc_mod_to_txt(ctx->this_atsc));
+                        continue;
+                    }
+                    info("%d: %s", freq_scale(f, 1e-3), atsc_mod_to_txt(ctx->this_atsc));
+                    break;
+
+                 default:;
+              } // END: switch (test.type)
+
+              // plp loop
+              if (delsys == SYS_DVBT2 && (!ctx->multistream)) {
+                 // multistream is not supported, so use plp id -1 ("autodetection") as only value to scan
+                 my_plplist = &ctx->plplist;
+                 my_plplist[0] = -1;
+                 my_plplist_length = 1;
+              } else if (delsys == SYS_DVBT2 && ctx->use_user_plplist) {
+                 my_plplist = &ctx->user_plplist;
+                 my_plplist_length = ctx->user_plplist_length;
+              } else if (delsys == SYS_DVBT2) {
+                 my_plplist = &ctx->plplist;
+                 my_plplist_length = ctx->plplist_length;
+              } else {
+                 // for legacy DVB-T (or ATSC) there is nothing such as PLPs
+                 // therefore we just set the list lenght to 1 to let the frequency be scanned
+                 // my_plplist will actually not be read at all in this scenario
+                 my_plplist_length = 1;
+              }
+              for (plp_i = 0; (plp_i < my_plplist_length) && !ctx->interrupted; plp_i++) {
+                if (delsys == SYS_DVBT2) current_plp = my_plplist[plp_i];
+                // check if plp id = -1 and this is supported
+                if (no_signal_on_freq) continue;
+                if (delsys == SYS_DVBT2)
+                   test.plp_id = (current_plp==-1) ? NO_STREAM_ID_FILTER : current_plp;
+                info("(time: %s) ", run_time());
+                if (delsys == SYS_DVBT2) info("\n   plp id %d: ",current_plp);
+                if (delsys == SYS_DVBT2 && is_already_scanned_transponder_plp(ctx, &test, 1)) {
+                    info("  skipped (already scanned PLP ID)\n");
+                    continue;
+                }
+                if (set_frontend(ctx, frontend_fd, ptest) < 0) {
+                   print_transponder(buffer, ptest);
+                   dprintf(1,"\n%s:%d: Setting frontend failed %s\n", __FUNCTION__, __LINE__, buffer);
+                   report_tune_result(ctx, ptest, T2SCAN_TUNE_FAILED);
+                   continue;
+                }
+                get_time(&meas_start);
+                set_timeout(time2carrier * ctx->flags.timeout_multiplier, &timeout);  // N msec * {1,2,3}
+
+                // look for some signal.
+                ret = wait_frontend(ctx, frontend_fd, FE_HAS_SIGNAL | FE_HAS_CARRIER, 0, &timeout, &meas_start);
+                if ((ret & (FE_HAS_SIGNAL | FE_HAS_CARRIER)) == 0) {                
+                   info("  no signal\n");
+                   report_tune_result(ctx, ptest, T2SCAN_NO_SIGNAL);
+                   no_signal_on_freq = true;
+                   continue;
+                }
+                get_time(&meas_stop);
+                time2signal = elapsed(&meas_start, &meas_stop) * 1000;
+
+                //now, we should get also lock.
+                set_timeout(time2lock * ctx->flags.timeout_multiplier, &timeout);  // N msec * {1,2,3}
+                ret = wait_frontend(ctx, frontend_fd, FE_HAS_LOCK, ret, &timeout, &meas_start);
+                if ((ret & FE_HAS_LOCK) == 0) {
+                   info("  no lock (signal after %ums)\n", time2signal);
+                   report_tune_result(ctx, ptest, T2SCAN_NO_LOCK);
+                   continue;
+                }
+                get_time(&meas_stop);
+                verbose("\n        signal after %ums, lock after %ums\n",
+                        time2signal, (unsigned) (elapsed(&meas_start, &meas_stop) * 1000));
+
+                if ((test.type == SCAN_TERRESTRIAL) && (delsys != fe_get_delsys(ctx, frontend_fd, NULL))) {
+                   verbose("wrong delsys: skip over.\n");                    // cxd2820r: T <-> T2
+                   report_tune_result(ctx, ptest, T2SCAN_WRONG_DELSYS);
+                   continue;
+                }
+
+                t = alloc_transponder(ctx, f, test.delsys, test.polarization);
+                t->type = ptest->type;
+                t->source = 0;
+                t->network_name=NULL;
+                init_tp(ctx, t);
+
+                copy_fe_params(t, ptest);
+                print_transponder(buffer, t);
+                info("  signal ok:\t%s\n", buffer);
+                report_tune_result(ctx, t, T2SCAN_LOCKED);
+                                                      
+                if (scan_transponder(ctx, frontend_fd)) {
+                  print_transponder(buffer,ctx->current_tp);
+                  if (!is_already_scanned_transponder_t2_samefreq(ctx, ctx->current_tp)) {
+                     info("        %s : %u services\n", buffer, ctx->current_tp->services->count);
+                     if (ctx->flags.reception_info==1)
+                        print_signal_info(frontend_fd, ctx->current_tp);
+                     add_scanned_transponder(ctx, ctx->current_tp);
+                  }
+                }                
+              } // END: of plp loop          
+           } // END: for delsys_parm
+        } // END: for offs
+     } // END: for channel
+  } // END: for mod_parm
+  if (! ctx->interrupted)
+     report_progress(ctx, n_steps, n_steps);
+}
+
+static void network_scan(struct scan_context * ctx, int frontend_fd, int tuning_data) {
+  int channels[256];
+  int n_channels = network_channels(ctx, frontend_fd, channels);
+
+  scan_channels(ctx, frontend_fd, channels, n_channels);
+}
+
+void set_country(struct scan_context * ctx, const char * country, uint16_t * scantype, int modulation_flags) {
+  int atsc = ctx->ATSC_type;
+  int dvb  = * scantype;
+
+  ctx->flags.atsc_type = ctx->ATSC_type;
+  ctx->plplist[0] = -1; ctx->plplist[1] = 0; ctx->plplist[2] = 1;
+  ctx->plplist_length = 3;
+  choose_country(country, &atsc, &dvb, scantype, &ctx->this_channellist, ctx->plplist, &ctx->plplist_length);
+  //dvbc: setting qam loop
+  if ((modulation_flags & MOD_OVERRIDE_MAX) == MOD_USE_STANDARD)
+     ctx->modulation_max = dvbc_qam_max(2, ctx->this_channellist);
+  if ((modulation_flags & MOD_OVERRIDE_MIN) == MOD_USE_STANDARD)
+     ctx->modulation_min = dvbc_qam_min(2, ctx->this_channellist);
+  ctx->flags.list_id = txt_to_country(country);
+}
+
+/* frontend capabilities of ctx->fe_info: auto detection of inversion, fec, qam etc, or fixed values to try.
+ * returns -1 if the frontend type isn't supported.
+ */
+static int get_frontend_caps(struct scan_context * ctx) {
+  switch(ctx->flags.scantype) {
+     case SCAN_TERRESTRIAL:
+        if (ctx->fe_info.caps & FE_CAN_2G_MODULATION) {
+           info("DVB-T2\n");
+           }
+        if (ctx->fe_info.caps & FE_CAN_INVERSION_AUTO) {
+           info("INVERSION_AUTO\n");
+           ctx->caps_inversion=INVERSION_AUTO;
+           }
+        else {
+           info("INVERSION_AUTO not supported, trying INVERSION_OFF.\n");
+           ctx->caps_inversion=INVERSION_OFF;
+           }
+        if (ctx->fe_info.caps & FE_CAN_QAM_AUTO) {
+           info("QAM_AUTO\n");
+           ctx->caps_qam=QAM_AUTO;
+           }
+        else {
+           info("QAM_AUTO not supported, trying QAM_64.\n");
+           ctx->caps_qam=QAM_64;
+           }
+        if (ctx->fe_info.caps & FE_CAN_TRANSMISSION_MODE_AUTO) {
+           info("TRANSMISSION_MODE_AUTO\n");
+           ctx->caps_transmission_mode=TRANSMISSION_MODE_AUTO;
+           }
+        else {
+           ctx->caps_transmission_mode=dvbt_transmission_mode(5, ctx->this_channellist);
+           info("TRANSMISSION_MODE not supported, trying %s.\n",
+                 transmission_mode_name(ctx->caps_transmission_mode));
+           }
+        if (ctx->fe_info.caps & FE_CAN_GUARD_INTERVAL_AUTO) {
+           info("GUARD_INTERVAL_AUTO\n");
+           ctx->caps_guard_interval=GUARD_INTERVAL_AUTO;
+           }
+        else {
+           info("GUARD_INTERVAL_AUTO not supported, trying GUARD_INTERVAL_1_8.\n");
+           ctx->caps_guard_interval=GUARD_INTERVAL_1_8;
+           }
+        if (ctx->fe_info.caps & FE_CAN_HIERARCHY_AUTO) {
+           info("HIERARCHY_AUTO\n");
+           ctx->caps_hierarchy=HIERARCHY_AUTO;
+           }
+        else {
+           info("HIERARCHY_AUTO not supported, trying HIERARCHY_NONE.\n");
+           ctx->caps_hierarchy=HIERARCHY_NONE;
+           }
+        if (ctx->fe_info.caps & FE_CAN_FEC_AUTO) {
+           info("FEC_AUTO\n");
+           ctx->caps_fec=FEC_AUTO;
+           }
+        else {
+           info("FEC_AUTO not supported, trying FEC_NONE.\n");
+           ctx->caps_fec=FEC_NONE;
+           }
+        if (ctx->fe_info.caps & FE_CAN_BANDWIDTH_AUTO) {
+           info("BANDWIDTH_AUTO\n");
+           ctx->bandwidth_auto = true;
+           }
+        else {
+           info("BANDWIDTH_AUTO not supported, trying 6/7/8 MHz.\n");
+           ctx->bandwidth_auto = false;
+           }
+        if (ctx->fe_info.caps % FE_CAN_MULTISTREAM) {
+           info("MULTISTREAM\n");
+           ctx->multistream = true; //
+           }
+        else {
+           info("MULTISTREAM not supported, disabling PLP ID selection.\n");
+           ctx->multistream = false;
+        }
+        if (ctx->fe_info.frequency_min == 0 || ctx->fe_info.frequency_max == 0) {
+           info("This dvb driver is *buggy*: the frequency limits are undefined - please report to linuxtv.org\n");
+           ctx->fe_info.frequency_min = 177500000; ctx->fe_info.frequency_max = 858000000;
+           }
+        else {
+           info("FREQ (%.2fMHz ... %.2fMHz)\n", ctx->fe_info.frequency_min/1e6, ctx->fe_info.frequency_max/1e6);
+           }
+        break;
      case SCAN_TERRCABLE_ATSC:
-        switch(ATSC_type) {
-           case ATSC_VSB:
-              modulation_min=modulation_max=ATSC_VSB;
-              break;
-           case ATSC_QAM:
-              modulation_min=modulation_max=ATSC_QAM;
-              break;
-           default:
-              modulation_min=ATSC_VSB;
-              modulation_max=ATSC_QAM;
-              break;
+        if (ctx->fe_info.caps & FE_CAN_INVERSION_AUTO) {
+           info("INVERSION_AUTO\n");
+           ctx->caps_inversion=INVERSION_AUTO;
+           }
+        else {
+           info("INVERSION_AUTO not supported, trying INVERSION_OFF.\n");
+           ctx->caps_inversion=INVERSION_OFF;
+           }
+        if (ctx->fe_info.caps & FE_CAN_8VSB) {
+           info("8VSB\n");
+           }
+        if (ctx->fe_info.caps & FE_CAN_16VSB) {
+           info("16VSB\n");
+           }
+        if (ctx->fe_info.caps & FE_CAN_QAM_64) {
+           info("QAM_64\n");
+           }
+        if (ctx->fe_info.caps & FE_CAN_QAM_256) {
+           info("QAM_256\n");
+           }
+        if (ctx->fe_info.frequency_min == 0 || ctx->fe_info.frequency_max == 0) {
+           info("This dvb driver is *buggy*: the frequency limits are undefined - please report to linuxtv.org\n");
+           ctx->fe_info.frequency_min = 177500000; ctx->fe_info.frequency_max = 858000000;
+           }
+        else {
+           info("FREQ (%.2fMHz ... %.2fMHz)\n", ctx->fe_info.frequency_min/1e6, ctx->fe_info.frequency_max/1e6);
            }
         break;
-     case SCAN_TERRESTRIAL:
-        // disable qam loop, disable symbolrate loop
-        modulation_min=modulation_max=0;
-        // enable legacy delsys loop.
-        delsys_min = delsysloop_min(0, this_channellist);
-        // enable T2 loop.
-        delsys_max = delsysloop_max(0, this_channellist);
+     default:
+        return -1;
+     }
+  return 0;
+}
+
+int device_scan(struct scan_context * ctx, int adapter, int frontend) {
+  char frontend_devname[80];
+  int frontend_fd;
+
+  snprintf(frontend_devname, sizeof(frontend_devname), "/dev/dvb/adapter%i/frontend%i", adapter, frontend);
+  snprintf(ctx->demux_devname, sizeof(ctx->demux_devname),       "/dev/dvb/adapter%i/demux%i"   , adapter, 0);
+
+  if ((frontend_fd = open(frontend_devname, O_RDWR)) < 0) {
+     error("failed to open '%s': %d %s\n", frontend_devname, errno, strerror(errno));
+     return -1;
+     }
+  if ((ioctl(frontend_fd, FE_GET_INFO, &ctx->fe_info) == -1) ||
+      (get_api_version(frontend_fd, &ctx->flags) < 0) ||
+      (get_frontend_caps(ctx) < 0) ||
+      (! fe_supports_scan(ctx, frontend_fd, ctx->flags.scantype, ctx->fe_info) && ctx->flags.api_version < 0x0505)) {
+     error("frontend '%s' can't be used for %s scan.\n", frontend_devname, scantype_to_text(ctx->flags.scantype));
+     close(frontend_fd);
+     return -1;
+     }
+  network_scan(ctx, frontend_fd, 0);
+  close(frontend_fd);
+  return 0;
+}
+
+/* releases all memory of the current scan: transponders, services, filters and learned timings.
+ * Afterwards t2scan is ready for the next scan, i.e. when running inside a resident process.
+ */
+void free_scan_session(struct scan_context * ctx) {
+  EmptyList(ctx->scanned_transponders);
+  EmptyList(ctx->table_timings);
+  EmptyList(ctx->running_filters);
+  EmptyList(ctx->waiting_filters);
+  free(ctx->freq_index);
+  ctx->freq_index = NULL;
+  ctx->freq_index_count = ctx->freq_index_size = 0;
+  dup_table_free(&ctx->dup_transponders);
+  dup_table_free(&ctx->dup_services);
+  ctx->dup_stale = false;
+  free(ctx->filter_heap);
+  ctx->filter_heap = NULL;
+  ctx->heap_count = ctx->heap_size = 0;
+  if (ctx->use_ts_demux)
+     ts_demux_free(&ctx->ts_demux);
+  memset(ctx->tp_timing, 0, sizeof(ctx->tp_timing));
+  ctx->current_tp = NULL;
+  ctx->free_section_bufs = NULL;
+  arena_free(ctx->scan_arena);
+  ctx->scan_arena = NULL;
+}
+
+struct scan_context * scan_context_new(void) {
+  struct scan_context * ctx = calloc(1, sizeof(* ctx));
+  int i;
+
+  if (ctx == NULL)
+     fatal("could not allocate scan context.\n");
+  ctx->flags                  = default_flags;
+  ctx->bandwidth_auto         = true;
+  ctx->multistream            = true;
+  ctx->caps_inversion         = INVERSION_AUTO;
+  ctx->caps_fec               = FEC_AUTO;
+  ctx->caps_qam               = QAM_AUTO;
+  ctx->this_atsc              = VSB_8;
+  ctx->caps_transmission_mode = TRANSMISSION_MODE_AUTO;
+  ctx->caps_guard_interval    = GUARD_INTERVAL_AUTO;
+  ctx->caps_hierarchy         = HIERARCHY_AUTO;
+  ctx->modulation_max         = 1;
+  ctx->freq_offset_max        = 4;
+  ctx->this_channellist       = DVBT_EU_VHFUHF;   // t2scan uses by default DVB-T with all VHF and UHF channels
+  ctx->ATSC_type              = ATSC_VSB;
+  ctx->worker_fd              = -1;
+  ctx->worker_step_fd         = -1;
+  ctx->ts_fd                  = -1;
+  ctx->char_coding            = char_coding_new();
+  for(i = 0; i < MAX_RUNNING; i++)
+     ctx->poll_fds[i].fd = -1;
+
+  ctx->running_filters      = &ctx->_running_filters;
+  ctx->waiting_filters      = &ctx->_waiting_filters;
+  ctx->scanned_transponders = &ctx->_scanned_transponders;
+  ctx->table_timings        = &ctx->_table_timings;
+  NewList(ctx->running_filters, "running_filters");
+  NewList(ctx->waiting_filters, "waiting_filters");
+  NewList(ctx->scanned_transponders, "scanned_transponders");
+  NewList(ctx->table_timings, "table_timings");
+  return ctx;
+}
+
+void scan_context_free(struct scan_context * ctx) {
+  if (ctx == NULL)
+     return;
+  free_scan_session(ctx);
+  char_coding_free(ctx->char_coding);
+  free(ctx);
+}
+
+/* incremental rescan (-k): tune to all transponders of the previous scan and read PAT and SDT.
+ * If their versions didn't change, the cached transponder and services are taken over,
+ * otherwise the transponder is scanned again.
+ */
+static void rescan_cached(struct scan_context * ctx, int frontend_fd, pList cache) {
+  struct transponder * c, * next, * t;
+  struct section_buf s[2];
+  struct timespec timeout, meas_start;
+  char buffer[128];
+  int result;
+
+  info("Checking %u known transponders...\n", cache->count);
+  for(c = cache->first; c && !ctx->interrupted; c = next) {
+     next = c->next;
+     print_transponder(buffer, c);
+     info("(time: %s) %s: ", run_time(), buffer);
+     if (set_frontend(ctx, frontend_fd, c) < 0) {
+        info("  tuning failed\n");
+        continue;
+        }
+     get_time(&meas_start);
+     set_timeout((carrier_timeout(c->delsys) + lock_timeout(c->delsys)) * ctx->flags.timeout_multiplier, &timeout);
+     if ((wait_frontend(ctx, frontend_fd, FE_HAS_LOCK, 0, &timeout, &meas_start) & FE_HAS_LOCK) == 0) {
+        info("  no lock, removed\n");
+        continue;
+        }
+
+     t = alloc_transponder(ctx, c->frequency, c->delsys, c->polarization);
+     copy_fe_params(t, c);
+     init_tp(ctx, t);
+
+     // PAT without PMTs, and SDT actual.
+     setup_filter(ctx, &s[0], ctx->demux_devname, PID_PAT, TABLE_PAT, -1, 1, 0, SECTION_FLAG_INITIAL);
+     add_filter(ctx, &s[0]);
+     setup_filter(ctx, &s[1], ctx->demux_devname, PID_SDT_BAT_ST, TABLE_SDT_ACT, -1, 1, 0, 0);
+     add_filter(ctx, &s[1]);
+     EMUL(em_readfilters, ctx, &result)
+     do { read_filters(ctx); }
+        while(!ctx->interrupted && ((ctx->running_filters->count > 0) || (ctx->waiting_filters->count > 0)));
+     if (ctx->interrupted) {
+        cancel_filters(ctx);
+        discard_transponder(t);
+        break;
+        }
+     store_timings(ctx, c);
+
+     if ((t->pat_version >= 0) && (t->sdt_version >= 0) &&
+         (t->pat_version == c->pat_version) && (t->sdt_version == c->sdt_version) &&
+         (t->transport_stream_id == c->transport_stream_id)) {
+        info("  unchanged\n");
+        if (ctx->flags.reception_info == 1)
+           print_signal_info(frontend_fd, c);
+        add_scanned_transponder(ctx, c);
+        discard_transponder(t);
+        continue;
+        }
+
+     info("  changed (PAT version %d -> %d, SDT version %d -> %d), scanning again\n",
+          c->pat_version, t->pat_version, c->sdt_version, t->sdt_version);
+     // start from scratch, not with the services of the PAT and SDT read above.
+     release_transponder(t);
+     if (scan_transponder(ctx, frontend_fd)) {
+        if (ctx->flags.reception_info == 1)
+           print_signal_info(frontend_fd, ctx->current_tp);
+        add_scanned_transponder(ctx, ctx->current_tp);
+        }
+     }
+}
+
+/* offline scan (-f): each recorded TS file is one transponder, its tables are read
+ * through the userspace demux (as with -T) instead of a tuned frontend.
+ */
+void file_scan(struct scan_context * ctx, pList files) {
+  struct ts_file * f;
+  struct transponder * t;
+  char buffer[128];
+  unsigned done = 0;
+
+  ctx->use_ts_demux = true;
+  for(f = files->first; f && !ctx->interrupted; f = f->next, done++) {
+     report_progress(ctx, done, files->count);
+     t = alloc_transponder(ctx, f->frequency, f->delsys, 0);
+     init_tp(ctx, t);
+     t->inversion    = ctx->caps_inversion;
+     t->bandwidth    = f->bandwidth;
+     t->coderate     = ctx->caps_fec;
+     t->coderate_LP  = ctx->caps_fec;
+     t->transmission = ctx->caps_transmission_mode;
+     t->guard        = ctx->caps_guard_interval;
+     t->hierarchy    = ctx->caps_hierarchy;
+     switch(f->delsys) {
+        case SYS_ATSC:
+           t->modulation = VSB_8;
+           break;
+        case SYS_DVBC_ANNEX_B:
+           t->modulation = QAM_256;
+           break;
+        default:
+           t->modulation = ctx->caps_qam;
+        }
+     if (f->delsys == SYS_DVBT2)
+        t->plp_id = (f->plp_id < 0) ? NO_STREAM_ID_FILTER : (uint32_t) f->plp_id;
+     print_transponder(buffer, t);
+     info("(time: %s) %s:\n        %s\n", run_time(), f->path, buffer);
+
+     ctx->ts_input = f;
+     ctx->ts_input->pos = 0;
+     ctx->ts_input_fed = 0;
+     report_tune_result(ctx, t, T2SCAN_LOCKED);
+     if (scan_transponder(ctx, -1)) {
+        print_transponder(buffer, ctx->current_tp);
+        if (! is_already_scanned_transponder_t2_samefreq(ctx, ctx->current_tp)) {
+           info("        %s : %u services\n", buffer, ctx->current_tp->services->count);
+           add_scanned_transponder(ctx, ctx->current_tp);
+           }
+        }
+     ctx->ts_input = NULL;
+     }
+  if (! ctx->interrupted)
+     report_progress(ctx, done, files->count);
+}
 
-        break;
-     default:warning("unsupported delivery system %d.\n", flags.scantype);
-  }
+/* parallel scan (-j): one worker process per adapter, each with its own frontend and demux.
+ * Workers ask the parent for the next step to scan and pass their transponders back through a pipe.
+ */
+struct scan_worker {
+  int adapter;
+  int frontend;
+  int preferred;
+  pid_t pid;
+  int fd;
+  int step_fd;
+};
 
-  /* ATSC VSB, ATSC QAM, DVB-T, DVB-C, here,
-   * please change freqs inside country.c for ATSC, DVB-T, DVB-C
-   */
-  for(delsys_parm = delsys_min; delsys_parm <= delsys_max; delsys_parm++) {
-     if ((delsys_parm > 0) && ((fe_info.caps & FE_CAN_2G_MODULATION) == 0)) {
-        break;
-        }
-     for(mod_parm = modulation_min; mod_parm <= modulation_max; mod_parm++) {
-        for(channel=flags.channel_min; channel <= flags.channel_max; channel++) {
-           for(offs = freq_offset_min; offs <= freq_offset_max; offs++) {                             
-              test.type = flags.scantype;
-              switch(test.type) {
-                 case SCAN_TERRESTRIAL:
-                    if (delsys_parm != last_delsys) {
-                       delsys = delsys_parm == 0? SYS_DVBT : SYS_DVBT2;
-                       if (delsys==SYS_DVBT && flags.dvbt_type==2) continue;
-                       if (delsys==SYS_DVBT2 && flags.dvbt_type==1) continue;
-                       info("Scanning DVB-%s...\n", delsys == SYS_DVBT?"T":"T2");
-                       last_delsys = delsys_parm;
-                    }
-                    if (use_user_channellist && (!channel_in_userlist(channel))) continue;
-                    f = chan_to_freq(channel, this_channellist);
-                    if (! f) continue; //skip unused channels
-                    if (freq_offset(channel, this_channellist, offs) == -1)
-                       continue; //skip this one
-                    f += freq_offset(channel, this_channellist, offs);                
-                    if (test.bandwidth != (__u32) bandwidth(channel, this_channellist))
-                       info("Scanning %sMHz frequencies...\n", vdr_bandwidth_name(bandwidth(channel, this_channellist)));
-                    test.frequency         = f;
-                    test.inversion         = caps_inversion;
-                    test.bandwidth         = (__u32) bandwidth(channel, this_channellist);
-                    test.coderate          = caps_fec;
-                    test.coderate_LP       = caps_fec;
-                    test.modulation        = caps_qam;
-                    test.transmission      = caps_transmission_mode;
-                    test.guard             = caps_guard_interval;
-                    test.hierarchy         = caps_hierarchy;
-                    test.delsys            = delsys;
-                    time2carrier = carrier_timeout(test.delsys);
-                    time2lock    = lock_timeout   (test.delsys);
-                    if (is_already_scanned_transponder(&test)) {
-                       info("%d (CH%d): skipped (already scanned transponder)\n", freq_scale(f, 1e-3),channel);
-                       continue;
-                    }
-                    info("%d (CH%d): ", freq_scale(f, 1e-3),channel);
-                    break;
-                 case SCAN_TERRCABLE_ATSC:
-                    switch(mod_parm) {
-                        case ATSC_VSB:
-                            this_atsc = VSB_8;
-                            f = chan_to_freq(channel, ATSC_VSB);
-                            if (!f)
-                               continue;       //skip unused channels
-                            if (freq_offset(channel, ATSC_VSB, offs) == -1)
-                               continue;       //skip this one
-                            f += freq_offset(channel, ATSC_VSB, offs);
-                            break;
-                        case ATSC_QAM:
-                            this_atsc = QAM_256;
-                            f = chan_to_freq(channel, ATSC_QAM);
-                            if (!f)
-                               continue;       //skip unused channels
-                            if (freq_offset(channel, ATSC_QAM, offs) == -1)
-                               continue;       //skip this one
-                            f += freq_offset(channel, ATSC_QAM, offs);
-                            break;
-                        default:
-                            fatal("unknown modulation id\n");
-                    }
-                    test.frequency  = f;
-                    test.inversion  = caps_inversion;
-                    test.modulation = this_atsc;
-                    test.delsys     = atsc_del_sys(this_atsc);
-                    time2carrier    = carrier_timeout(test.delsys);
-                    time2lock       = lock_timeout(test.delsys);
-                    if (is_already_scanned_transponder(&test)) {
-                        info("%d %s: skipped (already known transponder)\n", freq_scale(f, 1e-3), atsc_mod_to_txt(this_atsc));
-                        continue;
-                    }
-                    info("%d: %s", freq_scale(f, 1e-3), atsc_mod_to_txt(this_atsc));
-                    break;
+static void run_worker(struct scan_context * ctx, struct scan_worker * w, const int * channels, int n_channels) {
+  char frontend_devname[80];
+  int frontend_fd;
 
-                 default:;
-              } // END: switch (test.type)
-             
-              no_signal_on_freq = false; // first assume the frequency can be used
-              // plp loop
-              if (delsys == SYS_DVBT2 && (!multistream)) {
-                 // multistream is not supported, so use plp id -1 ("autodetection") as only value to scan
-                 my_plplist = &plplist;
-                 my_plplist[0] = -1;
-                 my_plplist_length = 1;
-              } else if (delsys == SYS_DVBT2 && use_user_plplist) {
-                 my_plplist = &user_plplist;
-                 my_plplist_length = user_plplist_length;
-              } else if (delsys == SYS_DVBT2) {
-                 my_plplist = &plplist;
-                 my_plplist_length = plplist_length;
-              } else {
-                 // for legacy DVB-T (or ATSC) there is nothing such as PLPs
-                 // therefore we just set the list lenght to 1 to let the frequency be scanned
-                 // my_plplist will actually not be read at all in this scenario
-                 my_plplist_length = 1;
-              }
-              for (plp_i = 0; plp_i < my_plplist_length; plp_i++) {
-                if (delsys == SYS_DVBT2) current_plp = my_plplist[plp_i];
-                // check if plp id = -1 and this is supported
-                if (no_signal_on_freq) continue;
-                if (delsys == SYS_DVBT2)
-                   test.plp_id = (current_plp==-1) ? NO_STREAM_ID_FILTER : current_plp;
-                info("(time: %s) ", run_time());
-                if (delsys == SYS_DVBT2) info("\n   plp id %d: ",current_plp);
-                if (delsys == SYS_DVBT2 && is_already_scanned_transponder_plp(&test, 1)) {
-                    info("  skipped (already scanned PLP ID)\n");
-                    continue;
-                }
-                if (set_frontend(frontend_fd, ptest) < 0) {
-                   print_transponder(buffer, ptest);
-                   dprintf(1,"\n%s:%d: Setting frontend failed %s\n", __FUNCTION__, __LINE__, buffer);
-                   continue;
-                }
-                get_time(&meas_start);
-                set_timeout(time2carrier * flags.timeout_multiplier, &timeout);  // N msec * {1,2,3}
-                if (!flags.emulate)
-                   usleep(100000);
-                ret = 0; lastret = ret;
+  snprintf(frontend_devname, sizeof(frontend_devname), "/dev/dvb/adapter%i/frontend%i", w->adapter, w->frontend);
+  snprintf(ctx->demux_devname, sizeof(ctx->demux_devname),       "/dev/dvb/adapter%i/demux%i"   , w->adapter, 0);
 
-                // look for some signal.
-                while((ret & (FE_HAS_SIGNAL | FE_HAS_CARRIER)) == 0) {
-                   ret = check_frontend(frontend_fd, (verbosity>3)? 1:0);
-                   if (ret != lastret) {
-                      get_time(&meas_stop);
-                      moreverbose("\n        (%.3fsec): %s%s%s (0x%X)",
-                           elapsed(&meas_start, &meas_stop),
-                           ret & FE_HAS_SIGNAL ?"S":"",
-                           ret & FE_HAS_CARRIER?"C":"",
-                           ret & FE_HAS_LOCK?   "L":"",
-                           ret);
-                      lastret = ret;
-                   }
-                   if (timeout_expired(&timeout) || flags.emulate) break;
-                   usleep(50000);
-                }
-                if ((ret & (FE_HAS_SIGNAL | FE_HAS_CARRIER)) == 0) {                
-                   info("  no signal\n");
-                   no_signal_on_freq = true;
-                   continue;
-                }
-                moreverbose("\n        (%.3fsec) signal", elapsed(&meas_start, &meas_stop));
+  if ((frontend_fd = open(frontend_devname, O_RDWR)) < 0)
+     fatal("failed to open '%s': %d %s\n", frontend_devname, errno, strerror(errno));
+  // the frontend caps were taken from the preferred device, but 2G support may differ.
+  if (ioctl(frontend_fd, FE_GET_INFO, &ctx->fe_info) == -1)
+     fatal("FE_GET_INFO failed: %d %s\n", errno, strerror(errno));
 
-                //now, we should get also lock.
-                set_timeout(time2lock * flags.timeout_multiplier, &timeout);  // N msec * {1,2,3}
-                while((ret & FE_HAS_LOCK) == 0) {
-                    ret = check_frontend(frontend_fd, (verbosity>3)?1:0);
-                    if (ret != lastret) {
-                       get_time(&meas_stop);
-                       moreverbose("\n        (%.3fsec): %s%s%s (0x%X)",
-                            elapsed(&meas_start, &meas_stop),
-                            ret & FE_HAS_SIGNAL ?"S":"",
-                            ret & FE_HAS_CARRIER?"C":"",
-                            ret & FE_HAS_LOCK?   "L":"",
-                            ret);
-                       lastret = ret;
-                    }
-                    if (timeout_expired(&timeout) || flags.emulate) break;
-                    usleep(50000);
-                }
-                if ((ret & FE_HAS_LOCK) == 0) {
-                   info("  no lock\n");
-                   continue;
-                }
-                moreverbose("\n        (%.3fsec) lock\n", elapsed(&meas_start, &meas_stop));
+  info("worker %u: using %s \"%s\"\n", ctx->worker_id, frontend_devname, ctx->fe_info.name);
+  // each transponder was passed on already by add_scanned_transponder().
+  signal(SIGINT, handle_sigint);
+  scan_channels(ctx, frontend_fd, channels, n_channels);
+  close(frontend_fd);
+  close(ctx->worker_fd);
+  close(ctx->worker_step_fd);
+  _exit(ctx->interrupted ? 2 : 0);
+}
 
-                if ((test.type == SCAN_TERRESTRIAL) && (delsys != fe_get_delsys(frontend_fd, NULL))) {
-                   verbose("wrong delsys: skip over.\n");                    // cxd2820r: T <-> T2
-                   continue;
-                }
+static int cmp_freq_delsys(void * a, void * b) {
+  struct transponder * t1 = a, * t2 = b;
+  int result = cmp_freq_pol(a, b);
+  if (result != 0) return result;
+  if (t1->delsys > t2->delsys) return 1;
+  if (t1->delsys < t2->delsys) return -1;
+  return 0;
+}
 
-                t = alloc_transponder(f, test.delsys, test.polarization);
-                t->type = ptest->type;
-                t->source = 0;
-                t->network_name=NULL;
-                init_tp(t);
+/* the parent process: sweeps with frontend_fd if requested (-w), hands out the steps of scan_channels()
+ * one at a time and merges the results of the workers.
+ */
+static void parallel_network_scan(struct scan_context * ctx, int frontend_fd, struct scan_worker * workers, int count) {
+  struct transponder * t;
+  struct pollfd pfds[count];
+  int channels[256], n_channels;
+  int32_t n_steps, step = 0;
+  int i, k, status, pipe_fds[2], step_fds[2], running = count;
+
+  n_channels = network_channels(ctx, frontend_fd, channels);
+  n_steps = (ctx->modulation_max - ctx->modulation_min + 1) * n_channels;
+  // every worker opens its own frontend.
+  close(frontend_fd);
 
-                copy_fe_params(t, ptest);
-                print_transponder(buffer, t);
-                info("  signal ok:\t%s\n", buffer);
-                                                      
-                if (scan_pat_nit(frontend_fd)) {
-                  print_transponder(buffer,current_tp);
-                  if (!is_already_scanned_transponder_t2_samefreq(current_tp)) {
-                     info("        %s : scanning for services\n",buffer);
-                     scan_services(); 
-                     if (flags.reception_info==1)
-                        print_signal_info(frontend_fd, current_tp);
-                     AddItem(scanned_transponders, current_tp);
-                  }
-                }                
-              } // END: of plp loop          
-           } // END: for offs
-        } // END: for channel       
-     } // END: for mod_parm
-  } // END: for delsys_parm
+  // workers pass on their partial result if interrupted and exit with 2, see run_worker().
+  signal(SIGINT, SIG_IGN);
+  // a worker dying between its request and our answer.
+  signal(SIGPIPE, SIG_IGN);
+  // e.g. the prologs of -o vlc= and -o xml=, otherwise each worker inherits a copy of them.
+  fflush(NULL);
+
+  for(i = 0; i < count; i++) {
+     if ((pipe(pipe_fds) < 0) || (pipe(step_fds) < 0))
+        fatal("pipe failed: %d %s\n", errno, strerror(errno));
+     workers[i].pid = fork();
+     if (workers[i].pid < 0)
+        fatal("fork failed: %d %s\n", errno, strerror(errno));
+     if (workers[i].pid == 0) {
+        fatal_exit_no_flush();
+        for(k = 0; k < i; k++) {
+           close(workers[k].fd);
+           close(workers[k].step_fd);
+           }
+        close(pipe_fds[0]);
+        close(step_fds[1]);
+        ctx->worker_fd = pipe_fds[1];
+        ctx->worker_step_fd = step_fds[0];
+        ctx->worker_id = i;
+        run_worker(ctx, &workers[i], channels, n_channels);
+        }
+     close(pipe_fds[1]);
+     close(step_fds[0]);
+     workers[i].fd = pipe_fds[0];
+     workers[i].step_fd = step_fds[1];
+     }
+
+  // merge results as they arrive, using the same checks as for a single frontend.
+  for(i = 0; i < count; i++) {
+     pfds[i].fd = workers[i].fd;
+     pfds[i].events = POLLIN;
+     }
+  while(running > 0) {
+     if (poll(pfds, count, -1) < 0) {
+        if (errno == EINTR)
+           continue;
+        fatal("poll failed: %d %s\n", errno, strerror(errno));
+        }
+     for(i = 0; i < count; i++) {
+        if ((pfds[i].fd < 0) || (pfds[i].revents == 0))
+           continue;
+        switch(read_worker_record(ctx, workers[i].fd, &t)) {
+           case WORKER_STEP_REQUEST:
+              // the next step, n_steps if nothing is left.
+              if (write(workers[i].step_fd, &step, sizeof(step)) == sizeof(step) && (step < n_steps))
+                 step++;
+              continue;
+           case WORKER_TRANSPONDER:
+              if (is_already_scanned_transponder_plp(ctx, t, 1) || is_already_scanned_transponder_t2_samefreq(ctx, t)) {
+                 verbose("worker %d: %d: skipped (already scanned transponder)\n", i, freq_scale(t->frequency, 1e-3));
+                 discard_transponder(t);
+                 continue;
+                 }
+              add_scanned_transponder(ctx, t);
+              continue;
+           default:;
+           }
+        // end of data, worker is done.
+        close(workers[i].fd);
+        close(workers[i].step_fd);
+        pfds[i].fd = -1;
+        running--;
+        if (waitpid(workers[i].pid, &status, 0) < 0)
+           status = -1; // not WIFEXITED()
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == 2))
+           ctx->interrupted = 1; // stopped by SIGINT, its partial result was passed on.
+        else if (! WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+           warning("worker %d (adapter %d) did not finish its scan, result may be incomplete.\n", i, workers[i].adapter);
+        }
+     }
 
+  // same order as a scan with one frontend: ascending frequencies, DVB-T before DVB-T2.
+  SortList(ctx->scanned_transponders, cmp_freq_delsys);
+  signal(SIGPIPE, SIG_DFL);
+  signal(SIGINT, handle_sigint);
 }
 
-int main(int argc, char ** argv) {
+int t2scan_main(int argc, char ** argv) {
   char frontend_devname [80];
   int adapter = DVB_ADAPTER_AUTO, frontend = 0, demux = 0;
   int opt;
@@ -2550,20 +4079,27 @@ int main(int argc, char ** argv) {
   char * positionfile = NULL;
   char * user_channel = NULL;
   char * user_plp = NULL;
+  bool parallel = false;
+  bool full_scan = true;
+  char * cache_file = NULL;
+  cList cached_transponders;
+  struct scan_worker workers[DVB_ADAPTER_SCAN];
+  int n_workers = 0;
+  struct scan_context * ctx = scan_context_new();
+  bool interrupted;
 
   // initialize lists.
-  NewList(running_filters, "running_filters");
-  NewList(waiting_filters, "waiting_filters");
-  NewList(scanned_transponders, "scanned_transponders");
+  NewList(ts_files, "ts_files");
+  sigint_ctx = ctx;
 
-  #define cleanup() cl(country); cl(satellite); cl(initdata); cl(positionfile); cl(codepage);
+  #define cleanup() cl(country); cl(satellite); cl(initdata); cl(positionfile); cl(codepage); cl(cache_file);
 
-  flags.version = version;
+  ctx->flags.version = version;
   run_time_init();
   
   for (opt=0; opt<argc; opt++) info("%s ", argv[opt]); info("%s", "\n");
 
-  while((opt = getopt_long(argc, argv, "a:c:dhi:l:m:o:p:q:rs:t:vA:C:DEFGHI:L:MP:S:UVY:Z", long_options, NULL)) != -1) {
+  while((opt = getopt_long(argc, argv, "a:c:df:hi:jk:l:m:o:p:q:rs:t:uvwA:C:DEFGHI:KL:MP:S:TUVY:Z", long_options, NULL)) != -1) {
      switch(opt) {
      case 'a': //adapter
              if (strstr(optarg, "/dev/dvb")) {
@@ -2574,17 +4110,17 @@ int main(int argc, char ** argv) {
                 adapter = DVB_ADAPTER_AUTO, frontend = 0;
                 if (sscanf(optarg, "%d", &adapter) < 1) {
                    adapter = 9999, frontend = 0;
-                   flags.emulate = 1;
+                   ctx->flags.emulate = 1;
                    em_init(optarg);
                    }                   
                 }
              break;
      case 'A': //ATSC type
-             ATSC_type = strtoul(optarg,NULL,0);
-             switch(ATSC_type) {
-                case 1: ATSC_type = ATSC_VSB; break;
-                case 2: ATSC_type = ATSC_QAM; break;
-                case 3: ATSC_type = (ATSC_VSB + ATSC_QAM); break;
+             ctx->ATSC_type = strtoul(optarg,NULL,0);
+             switch(ctx->ATSC_type) {
+                case 1: ctx->ATSC_type = ATSC_VSB; break;
+                case 2: ctx->ATSC_type = ATSC_QAM; break;
+                case 3: ctx->ATSC_type = (ATSC_VSB + ATSC_QAM); break;
                 default:
                    cleanup();
                    bad_usage(argv[0]);
@@ -2594,21 +4130,21 @@ int main(int argc, char ** argv) {
              scantype = SCAN_TERRCABLE_ATSC;
              break;
      case 'c': // lowest channel to scan
-             flags.channel_min = strtoul(optarg, NULL, 0);
-             if ((flags.channel_min > 133)) bad_usage(argv[0]);
+             ctx->flags.channel_min = strtoul(optarg, NULL, 0);
+             if ((ctx->flags.channel_min > 133)) bad_usage(argv[0]);
              break;
      case 'C': // highest channel to scan
-             flags.channel_max = strtoul(optarg, NULL, 0);
-             if ((flags.channel_max > 133)) bad_usage(argv[0]);
+             ctx->flags.channel_max = strtoul(optarg, NULL, 0);
+             if ((ctx->flags.channel_max > 133)) bad_usage(argv[0]);
              break;
      case 'D': // exclude duplicate services in output
-             flags.dedup = 1;
+             ctx->flags.dedup = 1;
              break;
      case 'd': // mark duplicate services in output (VDR output only)
-             flags.dedup = 2;
+             ctx->flags.dedup = 2;
              break;
      case 'E': //exclude encrypted channels
-             flags.ca_select = 0;
+             ctx->flags.ca_select = 0;
              break;
      case 'h': // help
              bad_usage("t2scan");
@@ -2621,17 +4157,45 @@ int main(int argc, char ** argv) {
              return 0;
              break;
      case 'i': // default charset to be used for data in descriptors
-             set_reset_to_charset(strdup(optarg));
+             set_char_coding_default_charset(ctx->char_coding, optarg);
              break;
      case 'I': // iconv to charset (-C in w_scan)
              codepage = strdup(optarg);
              break;
+     case 'k': // incremental rescan using cache file
+             cache_file = strdup(optarg);
+             break;
+     case 'K': // incremental rescan, but also scan all channels
+             cache_full_scan = true;
+             break;
+     case 'f': // recorded TS file
+             {
+             struct ts_file * f = ts_file_open(optarg);
+             if (f == NULL) {
+                cleanup();
+                fatal("could not use TS file '%s'\n", optarg);
+                }
+             AddItem(ts_files, f);
+             }
+             break;
+     case 'T': // one TS filter for all tables
+             ctx->use_ts_demux = true;
+             break;
+     case 'u': // output each transponder as soon as it is scanned
+             stream_output = true;
+             break;
+     case 'w': // check channels for signal first
+             ctx->pre_sweep = true;
+             break;
+     case 'j': // use all usable adapters in parallel
+             parallel = true;
+             break;
      case 'l': // comma-separated channel list
-             use_user_channellist = true;
+             ctx->use_user_channellist = true;
              i = 0;
              user_channel = strtok(optarg,",");
              while (user_channel != NULL) {
-               user_channellist[i] = atoi(user_channel);
+               ctx->user_channellist[i] = atoi(user_channel);
                user_channel = strtok(NULL, ",");
                i++;
              }
@@ -2644,46 +4208,35 @@ int main(int argc, char ** argv) {
              if (strcmp(optarg, "t") == 0) scantype = SCAN_TERRESTRIAL;
              if (strcmp(optarg, "a") == 0) scantype = SCAN_TERRCABLE_ATSC;
              if (scantype == SCAN_TERRCABLE_ATSC) {
-                this_channellist = ATSC_VSB;
+                ctx->this_channellist = ATSC_VSB;
                 country = strdup("US");
                 }
              break;
-     case 'o': //output format
-             if (strcmp(optarg, "xine") == 0) output_format = OUTPUT_XINE;
-             else if (strcmp(optarg, "xml") == 0) output_format = OUTPUT_XML;
-             else if (strcmp(optarg, "mplayer") == 0) output_format = OUTPUT_MPLAYER;
-             else if (strcmp(optarg, "vlc") == 0) output_format = OUTPUT_VLC_M3U;
-             else if (strcmp(optarg, "gstreamer") == 0) output_format = OUTPUT_GSTREAMER;
-             else if (strcmp(optarg, "vdr20") == 0) {
-                output_format = OUTPUT_VDR;
-                flags.vdr_version = 2;
-             } else {
-                output_format = OUTPUT_VDR;
-                flags.vdr_version = 21;
-             }
+     case 'o': //output format, optionally '=' output file
+             add_output(optarg);
              break;
      case 'p': //plp id to be used
              i = 0;
              user_plp = strtok(optarg,",");
              while (user_plp != NULL) {
-               user_plplist[i] = atoi(user_plp);
-               if (user_plplist[i]<-1) user_plplist[i]=-1;
+               ctx->user_plplist[i] = atoi(user_plp);
+               if (ctx->user_plplist[i]<-1) ctx->user_plplist[i]=-1;
                user_plp = strtok(NULL, ",");
                i++;
              }
-             user_plplist_length = i;
-             use_user_plplist = true;
+             ctx->user_plplist_length = i;
+             ctx->use_user_plplist = true;
              i=0;
              break;
      case 'P': //ATSC PSIP scan
-             no_ATSC_PSIP = 1;
+             ctx->no_ATSC_PSIP = 1;
              break;
      case 'q': //quiet
              if (--verbosity < 0)
                 verbosity = 0;
              break;
      case 'r': // experimental switch for measuring the reception
-             flags.reception_info = 1;
+             ctx->flags.reception_info = 1;
              break;
      case 's': // included services in output
              TV_Services = (strstr(optarg, "t"))? 1: 0;
@@ -2691,16 +4244,16 @@ int main(int argc, char ** argv) {
              Other_Services = (strstr(optarg, "o"))? 1: 0;
              break;
      case 'S': // multiply tuning & filter timeouts, in w_scan this option was 't'/'F'
-             flags.timeout_multiplier = strtoul(optarg, NULL, 0);
-             if ((flags.timeout_multiplier < 1)) bad_usage(argv[0]);
-             if ((flags.timeout_multiplier > 5)) bad_usage(argv[0]);
+             ctx->flags.timeout_multiplier = strtoul(optarg, NULL, 0);
+             if ((ctx->flags.timeout_multiplier < 1)) bad_usage(argv[0]);
+             if ((ctx->flags.timeout_multiplier > 5)) bad_usage(argv[0]);
              break;
      case 't': // dvb-t modes to scan (0=all, 1=DVB-T, 2=DVB-T2)
-             flags.dvbt_type = strtoul(optarg, NULL, 0);
-             if ((flags.dvbt_type > 2)) bad_usage(argv[0]);
+             ctx->flags.dvbt_type = strtoul(optarg, NULL, 0);
+             if ((ctx->flags.dvbt_type > 2)) bad_usage(argv[0]);
              break;
      case 'U': // don't update transponder parameters from NIT
-             flags.update_transponder_params = 0;
+             ctx->flags.update_transponder_params = 0;
              break;
      case 'v': //verbose
              verbosity++;
@@ -2743,13 +4296,13 @@ int main(int argc, char ** argv) {
       }                
   }
   serv_select = 1 * TV_Services + 2 * Radio_Services + 4 * Other_Services;
-  if (caps_inversion > INVERSION_AUTO) {
+  if (ctx->caps_inversion > INVERSION_AUTO) {
      info("Inversion out of range!\n");
      bad_usage(argv[0]);
      cleanup();
      return -1;
      }
-  if (((adapter >= DVB_ADAPTER_MAX) && (adapter != DVB_ADAPTER_AUTO) && (!flags.emulate)) || (adapter < 0)) {
+  if (((adapter >= DVB_ADAPTER_MAX) && (adapter != DVB_ADAPTER_AUTO) && (!ctx->flags.emulate)) || (adapter < 0)) {
      info("Invalid adapter: out of range (0..%d)\n", DVB_ADAPTER_MAX - 1);
      bad_usage(argv[0]);
      cleanup();
@@ -2759,28 +4312,17 @@ int main(int argc, char ** argv) {
      case SCAN_TERRCABLE_ATSC:
      case SCAN_TERRESTRIAL:
         if (country != NULL) {
-           int atsc = ATSC_type;
-           int dvb  = scantype;
-           flags.atsc_type = ATSC_type;
-           plplist[0] = -1; plplist[1] = 0; plplist[2] = 1;
-           plplist_length = 3;
-           choose_country(country, &atsc, &dvb, &scantype, &this_channellist, plplist, &plplist_length);
-           //dvbc: setting qam loop
-           if ((modulation_flags & MOD_OVERRIDE_MAX) == MOD_USE_STANDARD)
-              modulation_max = dvbc_qam_max(2, this_channellist);
-           if ((modulation_flags & MOD_OVERRIDE_MIN) == MOD_USE_STANDARD)
-              modulation_min = dvbc_qam_min(2, this_channellist);
-           flags.list_id = txt_to_country(country);
+           set_country(ctx, country, &scantype, modulation_flags);
            cl(country);
         }
         switch(override_channellist) {             
-           case 0: this_channellist = DVBT_EU_UHF800; break;
-           case 1: this_channellist = DVBT_EU_UHF700; break;
-           case 2: this_channellist = DVBT_EU_UHF; break;
-           case 3: this_channellist = DVBT_EU_VHFUHF; break;
-           case 4: this_channellist = DVBT_FR; break;
-           case 5: this_channellist = DVBT_GB; break;
-           case 6: this_channellist = DVBT_AU; break;
+           case 0: ctx->this_channellist = DVBT_EU_UHF800; break;
+           case 1: ctx->this_channellist = DVBT_EU_UHF700; break;
+           case 2: ctx->this_channellist = DVBT_EU_UHF; break;
+           case 3: ctx->this_channellist = DVBT_EU_VHFUHF; break;
+           case 4: ctx->this_channellist = DVBT_FR; break;
+           case 5: ctx->this_channellist = DVBT_GB; break;
+           case 6: ctx->this_channellist = DVBT_AU; break;
            default: break;
         }
         break;
@@ -2791,80 +4333,103 @@ int main(int argc, char ** argv) {
      }
 
   if (initdata != NULL) {
-     valid_initial_data = dvbscan_parse_tuningdata(initdata, &flags);
+     valid_initial_data = dvbscan_parse_tuningdata(ctx, initdata);
      cl(initdata);
      if (valid_initial_data == 0) {
         cleanup();
         fatal("Could not read initial tuning data. EXITING.\n");
         }
-     if (flags.scantype != scantype) {
+     if (ctx->flags.scantype != scantype) {
         warning("\n"
                 "========================================================================\n"
                 "INITIAL TUNING DATA NEEDS FRONTEND TYPE %s, YOU SELECTED TYPE %s.\n"
                 "I WILL OVERRIDE YOUR DEFAULTS TO %s\n"
                 "========================================================================\n",
-                scantype_to_text(flags.scantype),
+                scantype_to_text(ctx->flags.scantype),
                 scantype_to_text(scantype),
-                scantype_to_text(flags.scantype));
-        scantype = flags.scantype;                        
+                scantype_to_text(ctx->flags.scantype));
+        scantype = ctx->flags.scantype;                        
         sleep(10); // ensure that user reads warning.
         }
      }
-  info("scan type %s, channellist %d\n", scantype_to_text(scantype), this_channellist);
-  switch(output_format) {
-     case OUTPUT_VDR:
-        switch(flags.vdr_version) {
-           case 2:
-              info("output format vdr-2.0\n");
-              break;
-           case 21:
-              info("output format vdr-2.1\n");
-              break;
-           default:
-              fatal("UNKNOWN VDR VERSION.");
-           }
-        break;
-     case OUTPUT_GSTREAMER:
-        // Gstreamer output: As vdr-1.7+, but pmt_pid added at end of line.
-        flags.print_pmt = 1;
-        flags.vdr_version = 2;
-        output_format = OUTPUT_VDR;
-        info("output format gstreamer\n");
-        break;
-     case OUTPUT_XINE:
-        info("output format czap/tzap/szap/xine\n");
-        break;
-     case OUTPUT_MPLAYER:
-        info("output format mplayer\n");
-        break;
-     case OUTPUT_DVBSCAN_TUNING_DATA:
-         info("output format initial tuning data\n");
-         break;
-     case OUTPUT_PIDS:
-        info("output format PIDs only\n");
-        break;
-     case OUTPUT_VLC_M3U:
-        info("output format vlc xspf playlist\n");
-        break;
-     case OUTPUT_XML:
-        info("output format w_scan XML tuning data\n");
-        // 20200518 following lines uncommented since services are currently not printed in xml anyways 
-        //if (codepage)
-        //   free(codepage);
-        //codepage = strdup("ISO-8859-1");
-        break;
-     default:
-        cleanup();
-        fatal("unhandled output format %d\n", output_format);
+  info("scan type %s, channellist %d\n", scantype_to_text(scantype), ctx->this_channellist);
+  if (output_count == 0)
+     add_output("vdr");
+  for(i = 0; i < (unsigned) output_count; i++) {
+     struct output * o = &outputs[i];
+     const char * name;
+
+     switch(o->format) {
+        case OUTPUT_VDR:
+           switch(o->vdr_version) {
+              case 2:
+                 name = "vdr-2.0";
+                 break;
+              case 21:
+                 name = "vdr-2.1";
+                 break;
+              default:
+                 fatal("UNKNOWN VDR VERSION.");
+              }
+           break;
+        case OUTPUT_GSTREAMER:
+           // Gstreamer output: As vdr-1.7+, but pmt_pid added at end of line.
+           o->print_pmt = 1;
+           o->vdr_version = 2;
+           o->format = OUTPUT_VDR;
+           name = "gstreamer";
+           break;
+        case OUTPUT_XINE:
+           name = "czap/tzap/szap/xine";
+           break;
+        case OUTPUT_MPLAYER:
+           name = "mplayer";
+           break;
+        case OUTPUT_DVBSCAN_TUNING_DATA:
+           name = "initial tuning data";
+           break;
+        case OUTPUT_PIDS:
+           name = "PIDs only";
+           break;
+        case OUTPUT_VLC_M3U:
+           name = "vlc xspf playlist";
+           break;
+        case OUTPUT_XML:
+           name = "w_scan XML tuning data";
+           // 20200518 following lines uncommented since services are currently not printed in xml anyways 
+           //if (codepage)
+           //   free(codepage);
+           //codepage = strdup("ISO-8859-1");
+           break;
+        default:
+           cleanup();
+           fatal("unhandled output format %d\n", o->format);
+        }
+     if (o->path)
+        info("output format %s to '%s'\n", name, o->path);
+     else
+        info("output format %s\n", name);
      }
   if (codepage) {
-     flags.codepage = get_codepage_index(codepage);
-     info("output charset '%s'\n", iconv_codes[flags.codepage]);
+     ctx->flags.codepage = get_codepage_index(codepage);
+     info("output charset '%s'\n", iconv_codes[ctx->flags.codepage]);
      }
   else {
-     flags.codepage = get_user_codepage();
-     info("output charset '%s', use -I <charset> to override\n", iconv_codes[flags.codepage]);
+     ctx->flags.codepage = get_user_codepage();
+     info("output charset '%s', use -I <charset> to override\n", iconv_codes[ctx->flags.codepage]);
      }        
+  if (ts_files->count > 0) {
+     // recorded TS files (-f), no device needed.
+     if (cache_file != NULL) {
+        info("Info: cache (-k) not used with TS files.\n");
+        cl(cache_file);
+        }
+     ctx->flags.scantype = scantype;
+     signal(SIGINT, handle_sigint);
+     open_outputs(ctx, 0, 0);
+     file_scan(ctx, ts_files);
+     goto scan_done;
+     }
   if ( adapter == DVB_ADAPTER_AUTO ) {
      info("Info: using DVB adapter auto detection.\n");
      fe_open_mode = O_RDWR | O_NONBLOCK;
@@ -2875,20 +4440,33 @@ int main(int argc, char ** argv) {
                continue;
                }
            /* determine FE type and caps */
-           if (ioctl(frontend_fd, FE_GET_INFO, &fe_info) == -1) {
+           if (ioctl(frontend_fd, FE_GET_INFO, &ctx->fe_info) == -1) {
               info("   ERROR: unable to determine frontend type\n");
               close(frontend_fd);
               continue;
               }
            
-           if (flags.api_version < 0x0500)
-              get_api_version(frontend_fd, &flags);
+           if (ctx->flags.api_version < 0x0500)
+              get_api_version(frontend_fd, &ctx->flags);
            
-           if (fe_supports_scan(frontend_fd, scantype, fe_info)) {
-              info("\t%s -> %s \"%s\": ", frontend_devname, scantype_to_text(scantype), fe_info.name);
-              if (device_is_preferred(fe_info.caps, fe_info.name, scantype) >= device_preferred) {
-                 if (device_is_preferred(fe_info.caps, fe_info.name, scantype) > device_preferred) {
-                    device_preferred = device_is_preferred(fe_info.caps, fe_info.name, scantype);
+           if (fe_supports_scan(ctx, frontend_fd, scantype, ctx->fe_info)) {
+              info("\t%s -> %s \"%s\": ", frontend_devname, scantype_to_text(scantype), ctx->fe_info.name);
+              if (parallel) {
+                 // one worker per adapter, using the adapter's preferred frontend.
+                 if (n_workers == 0 || workers[n_workers - 1].adapter != (int) i) {
+                    workers[n_workers].adapter = i;
+                    workers[n_workers].frontend = j;
+                    workers[n_workers].preferred = device_is_preferred(ctx->fe_info.caps, ctx->fe_info.name, scantype);
+                    n_workers++;
+                    }
+                 else if (device_is_preferred(ctx->fe_info.caps, ctx->fe_info.name, scantype) > workers[n_workers - 1].preferred) {
+                    workers[n_workers - 1].frontend = j;
+                    workers[n_workers - 1].preferred = device_is_preferred(ctx->fe_info.caps, ctx->fe_info.name, scantype);
+                    }
+                 }
+              if (device_is_preferred(ctx->fe_info.caps, ctx->fe_info.name, scantype) >= device_preferred) {
+                 if (device_is_preferred(ctx->fe_info.caps, ctx->fe_info.name, scantype) > device_preferred) {
+                    device_preferred = device_is_preferred(ctx->fe_info.caps, ctx->fe_info.name, scantype);
                     adapter=i;
                     frontend=j;
                     }
@@ -2901,7 +4479,8 @@ int main(int argc, char ** argv) {
                        break;
                     case 2: // perfect device found. stop scanning
                        info("very good :-))\n\n");
-                       i=DVB_ADAPTER_AUTO;
+                       if (! parallel)
+                          i=DVB_ADAPTER_AUTO;
                        break;
                     default:;
                     }
@@ -2913,7 +4492,7 @@ int main(int argc, char ** argv) {
               }
            else {
               info("\t%s -> \"%s\" doesnt support %s -> SEARCH NEXT ONE.\n",
-                  frontend_devname, fe_info.name, scantype_to_text(scantype));
+                  frontend_devname, ctx->fe_info.name, scantype_to_text(scantype));
               close(frontend_fd);
               }
            } // END: for j
@@ -2922,12 +4501,15 @@ int main(int argc, char ** argv) {
         snprintf(frontend_devname, sizeof(frontend_devname), "/dev/dvb/adapter%i/frontend%i", adapter, frontend);
         info("Using %s frontend (adapter %s)\n", scantype_to_text(scantype), frontend_devname);
         }
+     if (parallel && n_workers > 1)
+        info("Using %d adapters in parallel\n", n_workers);
+     else if (parallel)
+        info("Only one usable adapter found, parallel scan disabled.\n");
      }
+  else if (parallel)
+     info("Parallel scan needs adapter auto detection, disabled.\n");
   snprintf(frontend_devname, sizeof(frontend_devname), "/dev/dvb/adapter%i/frontend%i", adapter, frontend);
-  snprintf(demux_devname, sizeof(demux_devname),       "/dev/dvb/adapter%i/demux%i"   , adapter, demux);
-
-  for(i = 0; i < MAX_RUNNING; i++)
-     poll_fds[i].fd = -1;
+  snprintf(ctx->demux_devname, sizeof(ctx->demux_devname),       "/dev/dvb/adapter%i/demux%i"   , adapter, demux);
 
   fe_open_mode = O_RDWR;
   if (adapter == DVB_ADAPTER_AUTO) {
@@ -2946,12 +4528,12 @@ int main(int argc, char ** argv) {
      }
   info("-_-_-_-_ Getting frontend capabilities-_-_-_-_ \n");
   /* determine FE type and caps */
-  EMUL(em_info, &fe_info)
-  if (ioctl(frontend_fd, FE_GET_INFO, &fe_info) == -1) {
+  EMUL(em_info, &ctx->fe_info)
+  if (ioctl(frontend_fd, FE_GET_INFO, &ctx->fe_info) == -1) {
      cleanup();
      fatal("FE_GET_INFO failed: %d %s\n", errno, strerror(errno));
      }
-  flags.scantype = scantype;
+  ctx->flags.scantype = scantype;
 
   fe_status_t fe_status = (fe_status_t)0;
   EMUL(em_status, &fe_status)
@@ -2961,137 +4543,62 @@ int main(int argc, char ** argv) {
   }
 
 
-  EMUL(em_dvbapi, &flags.api_version)
-  if (get_api_version(frontend_fd, &flags) < 0)
+  EMUL(em_dvbapi, &ctx->flags.api_version)
+  if (get_api_version(frontend_fd, &ctx->flags) < 0)
      fatal("Your DVB driver doesnt support DVB API v5. Please upgrade.\n");
 
-  info("Using DVB API %d.%d\n", flags.api_version >> 8, flags.api_version & 0xFF);
+  info("Using DVB API %d.%d\n", ctx->flags.api_version >> 8, ctx->flags.api_version & 0xFF);
 
-  info("frontend '%s' supports\n", fe_info.name && *fe_info.name?fe_info.name:"<NULL pointer>");
+  info("frontend '%s' supports\n", ctx->fe_info.name && *ctx->fe_info.name?ctx->fe_info.name:"<NULL pointer>");
 
-  switch(flags.scantype) {
-     case SCAN_TERRESTRIAL:
-        if (fe_info.caps & FE_CAN_2G_MODULATION) {
-           info("DVB-T2\n");
-           }
-        if (fe_info.caps & FE_CAN_INVERSION_AUTO) {
-           info("INVERSION_AUTO\n");
-           caps_inversion=INVERSION_AUTO;
-           }
-        else {
-           info("INVERSION_AUTO not supported, trying INVERSION_OFF.\n");
-           caps_inversion=INVERSION_OFF;
-           }
-        if (fe_info.caps & FE_CAN_QAM_AUTO) {
-           info("QAM_AUTO\n");
-           caps_qam=QAM_AUTO;
-           }
-        else {
-           info("QAM_AUTO not supported, trying QAM_64.\n");
-           caps_qam=QAM_64;
-           }
-        if (fe_info.caps & FE_CAN_TRANSMISSION_MODE_AUTO) {
-           info("TRANSMISSION_MODE_AUTO\n");
-           caps_transmission_mode=TRANSMISSION_MODE_AUTO;
-           }
-        else {
-           caps_transmission_mode=dvbt_transmission_mode(5, this_channellist);
-           info("TRANSMISSION_MODE not supported, trying %s.\n",
-                 transmission_mode_name(caps_transmission_mode));
-           }
-        if (fe_info.caps & FE_CAN_GUARD_INTERVAL_AUTO) {
-           info("GUARD_INTERVAL_AUTO\n");
-           caps_guard_interval=GUARD_INTERVAL_AUTO;
-           }
-        else {
-           info("GUARD_INTERVAL_AUTO not supported, trying GUARD_INTERVAL_1_8.\n");
-           caps_guard_interval=GUARD_INTERVAL_1_8;
-           }
-        if (fe_info.caps & FE_CAN_HIERARCHY_AUTO) {
-           info("HIERARCHY_AUTO\n");
-           caps_hierarchy=HIERARCHY_AUTO;
-           }
-        else {
-           info("HIERARCHY_AUTO not supported, trying HIERARCHY_NONE.\n");
-           caps_hierarchy=HIERARCHY_NONE;
-           }
-        if (fe_info.caps & FE_CAN_FEC_AUTO) {
-           info("FEC_AUTO\n");
-           caps_fec=FEC_AUTO;
-           }
-        else {
-           info("FEC_AUTO not supported, trying FEC_NONE.\n");
-           caps_fec=FEC_NONE;
-           }
-        if (fe_info.caps & FE_CAN_BANDWIDTH_AUTO) {
-           info("BANDWIDTH_AUTO\n");
-           bandwidth_auto = true;
-           }
-        else {
-           info("BANDWIDTH_AUTO not supported, trying 6/7/8 MHz.\n");
-           bandwidth_auto = false;
-           }
-        if (fe_info.caps % FE_CAN_MULTISTREAM) {
-           info("MULTISTREAM\n");
-           multistream = true; //
-           }
-        else {
-           info("MULTISTREAM not supported, disabling PLP ID selection.\n");
-           multistream = false;
-        }
-        if (fe_info.frequency_min == 0 || fe_info.frequency_max == 0) {
-           info("This dvb driver is *buggy*: the frequency limits are undefined - please report to linuxtv.org\n");
-           fe_info.frequency_min = 177500000; fe_info.frequency_max = 858000000;
-           }
-        else {
-           info("FREQ (%.2fMHz ... %.2fMHz)\n", fe_info.frequency_min/1e6, fe_info.frequency_max/1e6);
-           }
-        break;
-     case SCAN_TERRCABLE_ATSC:
-        if (fe_info.caps & FE_CAN_INVERSION_AUTO) {
-           info("INVERSION_AUTO\n");
-           caps_inversion=INVERSION_AUTO;
-           }
-        else {
-           info("INVERSION_AUTO not supported, trying INVERSION_OFF.\n");
-           caps_inversion=INVERSION_OFF;
-           }
-        if (fe_info.caps & FE_CAN_8VSB) {
-           info("8VSB\n");
-           }
-        if (fe_info.caps & FE_CAN_16VSB) {
-           info("16VSB\n");
-           }
-        if (fe_info.caps & FE_CAN_QAM_64) {
-           info("QAM_64\n");
-           }
-        if (fe_info.caps & FE_CAN_QAM_256) {
-           info("QAM_256\n");
-           }
-        if (fe_info.frequency_min == 0 || fe_info.frequency_max == 0) {
-           info("This dvb driver is *buggy*: the frequency limits are undefined - please report to linuxtv.org\n");
-           fe_info.frequency_min = 177500000; fe_info.frequency_max = 858000000;
-           }
-        else {
-           info("FREQ (%.2fMHz ... %.2fMHz)\n", fe_info.frequency_min/1e6, fe_info.frequency_max/1e6);
-           }
-        break;
-     default:
-        cleanup();
-        fatal("unsupported frontend type.\n");
+  if (get_frontend_caps(ctx) < 0) {
+     cleanup();
+     fatal("unsupported frontend type.\n");
      }
   info("-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_ \n");
 
-  if (! fe_supports_scan(frontend_fd, scantype, fe_info) && flags.api_version < 0x0505) {
+  if (! fe_supports_scan(ctx, frontend_fd, scantype, ctx->fe_info) && ctx->flags.api_version < 0x0505) {
      cleanup();
      fatal("Frontend '%s' doesnt support your choosen scan type '%s'\n",
-           fe_info.name, scantype_to_text(scantype));
+           ctx->fe_info.name, scantype_to_text(scantype));
      }
 
   signal(SIGINT, handle_sigint);
-  network_scan(frontend_fd, valid_initial_data);
-  close(frontend_fd);
-  dump_lists(adapter, frontend);
+  open_outputs(ctx, adapter, frontend);
+  if (cache_file != NULL) {
+     NewList(&cached_transponders, "cached_transponders");
+     if (load_transponder_cache(ctx, cache_file, &cached_transponders, ctx->table_timings) > 0) {
+        rescan_cached(ctx, frontend_fd, &cached_transponders);
+        full_scan = cache_full_scan;
+        }
+     }
+  if (! full_scan)
+     close(frontend_fd);
+  else if (parallel && n_workers > 1)
+     parallel_network_scan(ctx, frontend_fd, workers, n_workers);
+  else {
+     network_scan(ctx, frontend_fd, valid_initial_data);
+     close(frontend_fd);
+     }
+scan_done:
+  // channels were not scanned in order of frequency, restore usual order.
+  if (ctx->pre_sweep || (cache_file != NULL) || (ts_files->count > 0))
+     SortList(ctx->scanned_transponders, cmp_freq_delsys);
+  if (ctx->interrupted)
+     error("interrupted by SIGINT, dumping partial result...\n");
+  else if (cache_file != NULL)
+     save_transponder_cache(cache_file, ctx->scanned_transponders, ctx->table_timings);
+  dump_lists(ctx);
+  if (cache_file != NULL)
+     EmptyList(&cached_transponders);
+  interrupted = ctx->interrupted;
+  signal(SIGINT, SIG_DFL);
+  scan_context_free(ctx);
+  while(ts_files->first != NULL) {
+     struct ts_file * f = ts_files->first;
+     UnlinkItem(ts_files, f, false);
+     ts_file_close(f);
+     }
   cleanup();
-  return 0;
+  return interrupted ? 2 : 0;
 }
@@ -31,9 +31,13 @@
 #include "extended_frontend.h"
 #include <sys/types.h>
 #include <stdint.h>
+#include <signal.h>
+#include <sys/poll.h>
 #include "tools.h"
 #include "descriptors.h"
 #include "emulate.h"
+#include "ts-demux.h"
+#include "libt2scan.h"
 
 
 
@@ -64,11 +68,142 @@ struct t2scan_flags {
    uint8_t     emulate;
 };
 
+#define MAX_RUNNING 27                          // section filters running at the same time
+
+#define MOD_USE_STANDARD  0x0
+#define MOD_OVERRIDE_MIN  0x1
+#define MOD_OVERRIDE_MAX  0x2
+
+struct ts_file;
+struct arena;
+struct char_coding_ctx;
+
+// hash table of duplicate chains, see find_duplicates() in scan.c.
+struct dup_table {
+  struct dup_slot * slots;
+  uint32_t size;
+  uint32_t count;
+};
+
+/*******************************************************************************
+/* everything one scan works on: settings, frontend capabilities, the running
+/* section filters and the result. Contexts don't share any state changed while
+/* scanning, scans of different contexts may run in separate threads.
+/* see scan_context_new() for the defaults.
+ ******************************************************************************/
+struct scan_context {
+  struct t2scan_flags flags;
+  char demux_devname[80];
+  volatile sig_atomic_t interrupted;            // stop scanning, i.e. set by a SIGINT handler
+
+  /* frontend */
+  struct dvb_frontend_info fe_info;
+  bool bandwidth_auto;
+  bool multistream;
+  enum fe_spectral_inversion caps_inversion;
+  enum fe_code_rate caps_fec;
+  enum fe_modulation caps_qam;
+  enum fe_modulation this_atsc;
+  enum fe_transmit_mode caps_transmission_mode;
+  enum fe_guard_interval caps_guard_interval;
+  enum fe_hierarchy caps_hierarchy;
+
+  /* what to scan */
+  unsigned int delsys_min;                      // initialization of delsys loop. 0 = delsys legacy.
+  unsigned int delsys_max;                      // initialization of delsys loop. 0 = delsys legacy.
+  unsigned int modulation_min;                  // initialization of modulation loop. QAM64  if FE_QAM
+  unsigned int modulation_max;                  // initialization of modulation loop. QAM256 if FE_QAM
+  unsigned int freq_offset_min;                 // initialization of freq offset loop. 0 == offset (0), 1 == offset(+), 2 == offset(-), 3 == offset1(+), 4 == offset2(+)
+  unsigned int freq_offset_max;                 // initialization of freq offset loop.
+  int this_channellist;
+  unsigned int ATSC_type;
+  unsigned int no_ATSC_PSIP;
+  int user_channellist[200];                    // for user channel list given by parameter -l
+  bool use_user_channellist;                    // for user channel list given by parameter -l
+  int plplist[256];                             // list of plp IDs to scan
+  int plplist_length;                           // length of list of plp IDs to scan
+  int user_plplist[256];                        // for user list of plp IDs to scan (-p)
+  int user_plplist_length;                      // length of user list of plp IDs to scan (-p)
+  bool use_user_plplist;                        // for user list of plp IDs to scan (-p)
+  uint32_t worker_id;                           // number of this worker process (-j)
+  int worker_fd;                                // pipe to parent process, only used by workers (-j)
+  int worker_step_fd;                           // pipe from parent process: next step to scan (-j)
+  bool pre_sweep;                               // check all channels for signal before scanning (-w)
+  bool use_ts_demux;                            // one demux TS filter for all tables (-T)
+  struct char_coding_ctx * char_coding;         // default charset (-i) and conversion caches for names
+
+  /* libt2scan callbacks, not used by the t2scan program */
+  struct t2scan_callbacks callbacks;
+  void * callback_priv;
+
+  /* section filters */
+  cList _running_filters, * running_filters;
+  cList _waiting_filters, * waiting_filters;
+  int n_running;
+  struct pollfd poll_fds[MAX_RUNNING];
+  struct section_buf * poll_section_bufs[MAX_RUNNING];
+  struct section_buf ** filter_heap;            // running filters, ordered by deadline
+  int heap_count, heap_size;
+  int ts_fd;                                    // -T: demux fd shared by all running filters
+  struct ts_demux ts_demux;
+  struct ts_file * ts_input;                    // -f: recording of the current transponder, NULL: demux device
+  uint64_t ts_input_fed;                        // bytes of ts_input fed to ts_demux so far
+  struct section_buf * free_section_bufs;       // PMT filters and segments for reuse
+  uint32_t tp_timing[256];                      // msec needed per table_id on current_tp
+
+  /* result */
+  struct transponder * current_tp;
+  cList _scanned_transponders, * scanned_transponders;
+  cList _table_timings, * table_timings;
+  struct transponder ** freq_index;             // scanned_transponders ordered by frequency
+  int freq_index_count, freq_index_size;
+  struct dup_table dup_transponders;            // duplicate detection, see find_duplicates()
+  struct dup_table dup_services;
+  bool dup_stale;                               // ids of a transponder changed after it was added to them
+  struct arena * scan_arena;                    // everything allocated while scanning, see free_scan_session()
+};
+
+/* allocates a context with default settings, free it with scan_context_free(). */
+struct scan_context * scan_context_new(void);
+void                  scan_context_free(struct scan_context * ctx);
+
+/* channel list, PLP ids and modulation loop for country. May change scantype, i.e. to ATSC. */
+void set_country(struct scan_context * ctx, const char * country, uint16_t * scantype, int modulation_flags);
+
+/* scan /dev/dvb/adapterN/frontendM with the settings of ctx. returns -1 if the frontend isn't usable. */
+int  device_scan(struct scan_context * ctx, int adapter, int frontend);
+
+/* scan recorded TS files (struct ts_file), each one is a transponder. */
+void file_scan(struct scan_context * ctx, pList files);
+
+/* the t2scan program: parses the command line, scans and writes the outputs. */
+int  t2scan_main(int argc, char ** argv);
 
 struct service * find_service (struct transponder * t, uint16_t service_id);
 struct service * alloc_service(struct transponder * t, uint16_t service_id);
+void             index_service(struct transponder * t, struct service * s);
+
+/* elementary streams and CA ids of a service, see struct es_components. */
+struct es_component * add_component(struct service * s, enum es_kind kind, uint16_t pid, uint8_t stream_type);
+struct es_component * last_component(struct service * s);
+struct es_component * first_component(struct service * s, enum es_kind kind);
+int                   count_components(struct service * s, enum es_kind kind);
+bool                  add_ca_id(struct service * s, uint16_t id);
+
+#define for_each_component(s, e) \
+  for(e = (s)->components ? (s)->components->item : NULL; \
+      e && (e < (s)->components->item + (s)->components->count); e++)
+
+struct transponder * alloc_transponder(struct scan_context * ctx, uint32_t frequency, unsigned delsys, uint8_t polarization);
 
-struct transponder * alloc_transponder(uint32_t frequency, unsigned delsys, uint8_t polarization);
+/* scan session memory, see free_scan_session(). */
+void * session_alloc(struct scan_context * ctx, size_t size);
+void * tp_alloc(struct transponder * t, size_t size);
+char * tp_strdup(struct transponder * t, const char * str);
+void   release_transponder(struct transponder * t);
+void   discard_transponder(struct transponder * t);
+void   free_section_buf(struct scan_context * ctx, struct section_buf * s);
+void   free_scan_session(struct scan_context * ctx);
 
 /* write transponder data to dest. no memory allocating,
  * so dest has to be big enough - think about before use!
@@ -0,0 +1,380 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "scan.h"
+#include "serialize.h"
+#include "arena.h"
+
+#define TP_MAGIC      0x54325450   // "T2TP", start of each transponder record
+#define STEP_MAGIC    0x54325351   // "T2SQ", a worker asks for its next step (-j)
+#define NO_STRING     0xFFFFFFFF   // length of a NULL string
+#define CACHE_MAGIC   "t2scan cache"
+#define CACHE_FORMAT  3
+
+struct cache_header {
+  char     magic[16];
+  uint32_t format;
+  uint32_t transponder_size;      // any change of the structs makes old caches unusable.
+  uint32_t service_size;
+  uint32_t cell_size;
+  uint32_t count;
+};                                // followed by count transponders, number of timings and the timings.
+
+static int write_buf(int fd, const void * buf, size_t len) {
+  const uint8_t * p = buf;
+  ssize_t n;
+
+  while (len > 0) {
+     n = write(fd, p, len);
+     if (n < 0) {
+        if (errno == EINTR)
+           continue;
+        return -1;
+        }
+     p += n;
+     len -= n;
+     }
+  return 0;
+}
+
+// returns number of bytes read; less than len only on end of data or error.
+static size_t read_buf(int fd, void * buf, size_t len) {
+  uint8_t * p = buf;
+  size_t done = 0;
+  ssize_t n;
+
+  while (done < len) {
+     n = read(fd, p + done, len - done);
+     if (n < 0 && errno == EINTR)
+        continue;
+     if (n <= 0)
+        break;
+     done += n;
+     }
+  return done;
+}
+
+static int write_u32(int fd, uint32_t v) {
+  return write_buf(fd, &v, sizeof(v));
+}
+
+static bool read_u32(int fd, uint32_t * v) {
+  return read_buf(fd, v, sizeof(* v)) == sizeof(* v);
+}
+
+// ES components and CA ids: count, followed by the entries.
+static int write_components(int fd, struct service * s) {
+  uint32_t count = s->components ? s->components->count : 0;
+
+  if (write_u32(fd, count) < 0 ||
+      (count && write_buf(fd, s->components->item, count * sizeof(s->components->item[0])) < 0))
+     return -1;
+  count = s->ca_ids ? s->ca_ids->count : 0;
+  if (write_u32(fd, count) < 0 ||
+      (count && write_buf(fd, s->ca_ids->id, count * sizeof(s->ca_ids->id[0])) < 0))
+     return -1;
+  return 0;
+}
+
+static bool read_components(int fd, struct service * s) {
+  struct es_component e;
+  uint32_t count, i;
+  uint16_t id;
+
+  if (! read_u32(fd, &count))
+     return false;
+  for(i = 0; i < count; i++) {
+     if (read_buf(fd, &e, sizeof(e)) != sizeof(e))
+        return false;
+     * add_component(s, e.kind, e.pid, e.stream_type) = e;
+     }
+  if (! read_u32(fd, &count))
+     return false;
+  for(i = 0; i < count; i++) {
+     if (read_buf(fd, &id, sizeof(id)) != sizeof(id))
+        return false;
+     add_ca_id(s, id);
+     }
+  return true;
+}
+
+static int write_string(int fd, const char * s) {
+  if (s == NULL)
+     return write_u32(fd, NO_STRING);
+  if (write_u32(fd, strlen(s)) < 0)
+     return -1;
+  return write_buf(fd, s, strlen(s));
+}
+
+// strings belong to transponder t and are allocated from its arena.
+static bool read_string(int fd, struct transponder * t, char ** s) {
+  uint32_t len;
+
+  * s = NULL;
+  if (! read_u32(fd, &len))
+     return false;
+  if (len == NO_STRING)
+     return true;
+  * s = tp_alloc(t, len + 1);
+  return read_buf(fd, * s, len) == len;
+}
+
+int write_transponder(int fd, struct transponder * t) {
+  struct cell * c;
+  struct service * s;
+
+  if (write_u32(fd, TP_MAGIC) < 0 ||
+      write_buf(fd, t, sizeof(* t)) < 0 ||
+      write_string(fd, t->network_name) < 0 ||
+      write_string(fd, t->signal_strength_unit) < 0 ||
+      write_string(fd, t->signal_quality_unit) < 0)
+     return -1;
+
+  if (write_u32(fd, t->cells->count) < 0)
+     return -1;
+  for(c = t->cells->first; c; c = c->next) {
+     if (write_buf(fd, c, sizeof(* c)) < 0)
+        return -1;
+     }
+
+  if (write_u32(fd, t->services->count) < 0)
+     return -1;
+  for(s = t->services->first; s; s = s->next) {
+     if (write_buf(fd, s, sizeof(* s)) < 0 ||
+         write_string(fd, s->provider_name) < 0 ||
+         write_string(fd, s->provider_short_name) < 0 ||
+         write_string(fd, s->service_name) < 0 ||
+         write_string(fd, s->service_short_name) < 0 ||
+         write_components(fd, s) < 0)
+        return -1;
+     }
+  return 0;
+}
+
+// the transponder record following TP_MAGIC.
+static struct transponder * read_transponder_data(struct scan_context * ctx, int fd) {
+  struct transponder * t;
+  struct cell * c;
+  struct service * s;
+  uint32_t count, i;
+  char name[20];
+  cList list;
+  char * network_name, * strength_unit, * quality_unit;
+
+  t = session_alloc(ctx, sizeof(* t));
+  if (read_buf(fd, t, sizeof(* t)) != sizeof(* t)) {
+     warning("%s: truncated transponder record\n", __FUNCTION__);
+     return NULL;
+     }
+
+  // pointers are only valid in the writing process.
+  t->prev = t->next = NULL;
+  // _cells and _services may be unaligned in the packed struct, fill them through locals.
+  sprintf(name, "cells_%u", t->frequency);
+  NewList(&list, name);
+  t->_cells = list;
+  t->cells = (pList) ((char *) t + offsetof(struct transponder, _cells));
+  sprintf(name, "services_%u", t->frequency);
+  NewList(&list, name);
+  t->_services = list;
+  t->services = (pList) ((char *) t + offsetof(struct transponder, _services));
+  t->service_index = NULL;
+  t->service_index_size = 0;
+  t->arena = arena_new(ctx->scan_arena);
+
+  // struct transponder is packed, don't pass pointers to its members.
+  t->network_change.num_networks = 0;
+  t->network_change.network = NULL;
+  if (! read_string(fd, t, &network_name) ||
+      ! read_string(fd, t, &strength_unit) ||
+      ! read_string(fd, t, &quality_unit))
+     goto fail;
+  t->network_name = network_name;
+  t->signal_strength_unit = strength_unit;
+  t->signal_quality_unit = quality_unit;
+
+  if (! read_u32(fd, &count))
+     goto fail;
+  for(i = 0; i < count; i++) {
+     c = tp_alloc(t, sizeof(* c));
+     if (read_buf(fd, c, sizeof(* c)) != sizeof(* c))
+        goto fail;
+     AddItem(t->cells, c);
+     }
+
+  if (! read_u32(fd, &count))
+     goto fail;
+  for(i = 0; i < count; i++) {
+     s = tp_alloc(t, sizeof(* s));
+     if (read_buf(fd, s, sizeof(* s)) != sizeof(* s))
+        goto fail;
+     s->transponder = t;
+     s->priv = NULL;
+     s->components = NULL;
+     s->ca_ids = NULL;
+     AddItem(t->services, s);
+     index_service(t, s);
+     if (! read_string(fd, t, &s->provider_name) ||
+         ! read_string(fd, t, &s->provider_short_name) ||
+         ! read_string(fd, t, &s->service_name) ||
+         ! read_string(fd, t, &s->service_short_name) ||
+         ! read_components(fd, s))
+        goto fail;
+     }
+  return t;
+
+fail:
+  warning("%s: truncated transponder record\n", __FUNCTION__);
+  discard_transponder(t);
+  return NULL;
+}
+
+struct transponder * read_transponder(struct scan_context * ctx, int fd) {
+  uint32_t magic;
+
+  if (! read_u32(fd, &magic))
+     return NULL; // end of data
+  if (magic != TP_MAGIC) {
+     warning("%s: invalid transponder record\n", __FUNCTION__);
+     return NULL;
+     }
+  return read_transponder_data(ctx, fd);
+}
+
+int write_step_request(int fd) {
+  return write_u32(fd, STEP_MAGIC);
+}
+
+enum worker_record read_worker_record(struct scan_context * ctx, int fd, struct transponder ** t) {
+  uint32_t magic;
+
+  * t = NULL;
+  if (! read_u32(fd, &magic))
+     return WORKER_END;
+  if (magic == STEP_MAGIC)
+     return WORKER_STEP_REQUEST;
+  if (magic != TP_MAGIC) {
+     warning("%s: invalid worker record\n", __FUNCTION__);
+     return WORKER_END;
+     }
+  if ((* t = read_transponder_data(ctx, fd)) == NULL)
+     return WORKER_END;
+  return WORKER_TRANSPONDER;
+}
+
+static void cache_header(struct cache_header * h, uint32_t count) {
+  memset(h, 0, sizeof(* h));
+  strcpy(h->magic, CACHE_MAGIC);
+  h->format = CACHE_FORMAT;
+  h->transponder_size = sizeof(struct transponder);
+  h->service_size = sizeof(struct service);
+  h->cell_size = sizeof(struct cell);
+  h->count = count;
+}
+
+int save_transponder_cache(const char * path, pList list, pList timings) {
+  struct cache_header h;
+  struct transponder * t;
+  struct table_timing * tt;
+  int fd;
+
+  if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+     warning("could not write cache '%s': %d %s\n", path, errno, strerror(errno));
+     return -1;
+     }
+  cache_header(&h, list->count);
+  if (write_buf(fd, &h, sizeof(h)) < 0)
+     goto fail;
+  for(t = list->first; t; t = t->next) {
+     if (write_transponder(fd, t) < 0)
+        goto fail;
+     }
+  if (write_u32(fd, timings->count) < 0)
+     goto fail;
+  for(tt = timings->first; tt; tt = tt->next) {
+     if (write_u32(fd, tt->original_network_id << 16 | tt->network_id) < 0 ||
+         write_u32(fd, tt->samples << 8 | tt->table_id) < 0 ||
+         write_u32(fd, tt->msec) < 0)
+        goto fail;
+     }
+  close(fd);
+  verbose("saved %u transponders to cache '%s'\n", list->count, path);
+  return 0;
+
+fail:
+  warning("could not write cache '%s': %d %s\n", path, errno, strerror(errno));
+  close(fd);
+  unlink(path);
+  return -1;
+}
+
+int load_transponder_cache(struct scan_context * ctx, const char * path, pList list, pList timings) {
+  struct cache_header h, expected;
+  struct transponder * t;
+  struct table_timing * tt;
+  uint32_t i, j, count, network, table_id;
+  int fd;
+
+  if ((fd = open(path, O_RDONLY)) < 0) {
+     info("no cache '%s' yet, doing a full scan.\n", path);
+     return -1;
+     }
+  cache_header(&expected, 0);
+  if ((read_buf(fd, &h, sizeof(h)) != sizeof(h)) ||
+      memcmp(h.magic, expected.magic, sizeof(h.magic)) ||
+      (h.format != expected.format) ||
+      (h.transponder_size != expected.transponder_size) ||
+      (h.service_size != expected.service_size) ||
+      (h.cell_size != expected.cell_size)) {
+     info("cache '%s' is not usable with this version, doing a full scan.\n", path);
+     close(fd);
+     return -1;
+     }
+  for(i = 0; i < h.count; i++) {
+     if ((t = read_transponder(ctx, fd)) == NULL)
+        break;
+     AddItem(list, t);
+     }
+  if ((i == h.count) && read_u32(fd, &count)) {
+     for(j = 0; j < count; j++) {
+        tt = session_alloc(ctx, sizeof(* tt));
+        if (! read_u32(fd, &network) || ! read_u32(fd, &table_id) || ! read_u32(fd, &tt->msec))
+           break;
+        tt->original_network_id = network >> 16;
+        tt->network_id = network & 0xFFFF;
+        tt->table_id = table_id & 0xFF;
+        tt->samples = table_id >> 8;
+        AddItem(timings, tt);
+        }
+     }
+  close(fd);
+  return i;
+}
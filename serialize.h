@@ -0,0 +1,70 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+#ifndef __SERIALIZE_H__
+#define __SERIALIZE_H__
+
+#include "si_types.h"
+
+struct scan_context;
+
+/*
+ * write transponder t, including its cells and services, to file descriptor fd.
+ * The data is in host byte order and only meant to be read back by the same binary.
+ * returns 0 on success, -1 on write error.
+ */
+int write_transponder(int fd, struct transponder * t);
+
+/*
+ * read one transponder written by write_transponder() from fd.
+ * returns a newly allocated transponder, or NULL on end of data or read error.
+ */
+struct transponder * read_transponder(struct scan_context * ctx, int fd);
+
+/*
+ * parallel scan (-j): the pipe from a worker process to its parent carries the worker's
+ * transponders and its requests for the next step to scan, written by write_step_request().
+ * read_worker_record() returns the kind of the next record, *t is set for WORKER_TRANSPONDER.
+ * WORKER_END means end of data or read error.
+ */
+enum worker_record {
+  WORKER_END,
+  WORKER_TRANSPONDER,
+  WORKER_STEP_REQUEST,
+};
+
+int                write_step_request(int fd);
+enum worker_record read_worker_record(struct scan_context * ctx, int fd, struct transponder ** t);
+
+/*
+ * result cache for incremental rescans (-k).
+ * save_transponder_cache() writes all transponders of list and the learned table timings to path,
+ * returns 0 on success.
+ * load_transponder_cache() appends the transponders and table timings found in path to list and timings,
+ * returns the number of transponders or -1 if the file doesn't exist or was written by an incompatible
+ * version of t2scan.
+ */
+int save_transponder_cache(const char * path, pList list, pList timings);
+int load_transponder_cache(struct scan_context * ctx, const char * path, pList list, pList timings);
+
+#endif
@@ -56,22 +56,69 @@ typedef struct section_buf {
   int sectionfilter_done;
   unsigned char buf[SECTION_BUF_SIZE];
   uint32_t flags;
-  time_t timeout;
-  time_t start_time;
-  time_t running_time;
+  uint32_t timeout;                     // msec
+  struct timespec start_time;
+  struct timespec deadline;             // start_time + timeout, CLOCK_MONOTONIC
+  int heap_index;                       // position in the deadline heap of running filters, -1 if not running
+  uint32_t running_time;                // msec
+  uint64_t ts_start;                    // -f: bytes of the recording fed before the filter was started
+  int first_section;                    // table_id_ext << 8 | section_number of the first section seen, -1 = none yet
+  struct timespec first_seen;
+  struct timespec last_new;             // arrival of the last section not seen before
+  uint32_t interval;                    // observed repetition interval in msec, 0 = not yet known
   struct section_buf * next_seg;        // this is used to handle segmented tables (like NIT-other)
   pList  garbage;
 } section_t, * p_section_t;
 
+/* time needed to receive a table on a network, learned while scanning (see -k). */
+struct table_timing {
+  /*----------------------------*/
+  void * prev;
+  void * next;
+  uint32_t index;
+  /*----------------------------*/
+  uint16_t original_network_id;
+  uint16_t network_id;
+  uint8_t  table_id;
+  uint16_t samples;                     // number of transponders seen
+  uint32_t msec;                        // longest time until complete or repetition interval seen
+};
+
 /*******************************************************************************
 /* service type.
  ******************************************************************************/
 
-#define AUDIO_CHAN_MAX    (32)
-#define AC3_CHAN_MAX      (32)
-#define CA_SYSTEM_ID_MAX  (16)
-#define SUBTITLES_MAX     (32)
+/* one elementary stream of a service, as announced in the PMT. */
+enum es_kind {
+  ES_AUDIO    = 1,
+  ES_AC3      = 2,                        // AC-3 and E-AC-3
+  ES_SUBTITLE = 3,                        // DVB subtitling
+};
+
+struct es_component {
+  uint16_t pid;
+  uint8_t  stream_type;
+  uint8_t  kind;                          // enum es_kind
+  char     lang[4];                       // ISO 639-2, zero terminated
+  uint8_t  subtitling_type;               // subtitles only
+  uint16_t composition_page_id;           // subtitles only
+  uint16_t ancillary_page_id;             // subtitles only
+};
+
+/* length prefixed arrays, allocated from the transponder's arena. see add_component() */
+struct es_components {
+  uint16_t count;
+  uint16_t size;                          // allocated entries
+  struct es_component item[];
+};
+
+struct ca_ids {
+  uint16_t count;
+  uint16_t size;
+  uint16_t id[];
+};
 
+struct arena;
 struct transponder;
 struct service {
   /*----------------------------*/
@@ -90,29 +137,17 @@ struct service {
   uint16_t pcr_pid;
   uint16_t video_pid;
   uint8_t  video_stream_type;
-  uint16_t audio_pid[AUDIO_CHAN_MAX];
-  uint8_t  audio_stream_type[AUDIO_CHAN_MAX];
-  char     audio_lang[AUDIO_CHAN_MAX][4];
-  int      audio_num;
-  uint16_t ca_id[CA_SYSTEM_ID_MAX];
-  int      ca_num;
   uint16_t teletext_pid;
-  uint16_t subtitling_pid[SUBTITLES_MAX];
-  char     subtitling_lang[SUBTITLES_MAX][4];
-  uint8_t  subtitling_type[SUBTITLES_MAX];
-  uint16_t composition_page_id[SUBTITLES_MAX];
-  uint16_t ancillary_page_id[SUBTITLES_MAX];
-  int      subtitling_num;
-  uint16_t ac3_pid[AC3_CHAN_MAX];
-  uint8_t  ac3_stream_type[AC3_CHAN_MAX];
-  char     ac3_lang[AC3_CHAN_MAX][4];
-  int      ac3_num;
+  struct es_components * components;      // audio, ac3 and subtitles in PMT order, NULL = none
+  struct ca_ids * ca_ids;                 // CA_system_ids, NULL = none
   unsigned int type : 8;
   bool     scrambled;
   bool     visible_service;
   uint32_t logical_channel_number;
   uint8_t  running;
   void   * priv;
+  struct service * dup_first;             // services with same (ONID, NID, service_id), in list order. see dump_lists()
+  struct service * dup_next;
 } service_t, * p_service_t;
 
 /*******************************************************************************
@@ -197,6 +232,8 @@ struct transponder {
   uint16_t network_id;
   uint16_t original_network_id;
   uint16_t transport_stream_id;
+  int8_t   pat_version;                   // version_number of PAT, -1 = unknown
+  int8_t   sdt_version;                   // version_number of SDT actual, -1 = unknown
   /*----------------------------*/
   char * network_name;
   network_change_t network_change;
@@ -204,6 +241,11 @@ struct transponder {
   char * signal_strength_unit;
   double signal_quality;
   char * signal_quality_unit;
+  struct service ** service_index;        // services by service_id, open addressing. see find_service()
+  uint32_t service_index_size;            // number of slots, power of 2
+  struct arena * arena;                   // service components, freed with the transponder
+  struct transponder * dup_first;         // transponders with same (ONID, NID, TSID), in list order. see dump_lists()
+  struct transponder * dup_next;
 } __attribute__((packed))  transponder_t, * p_transponder_t;
 
 /*******************************************************************************
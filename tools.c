@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "scan.h"
 #include "tools.h"
 
@@ -33,6 +35,17 @@
 /* common typedefs && logging.                                                  
  ******************************************************************************/
 int verbosity = 2;      // need signed -> use of fatal()
+static bool fatal_no_flush = false;
+
+void fatal_exit(void) {
+  if (fatal_no_flush)
+     _exit(1);
+  exit(1);
+}
+
+void fatal_exit_no_flush(void) {
+  fatal_no_flush = true;
+}
 
 
 
@@ -84,8 +97,10 @@ void NewList(pList const list, const char * name) {
   list->first   = NULL;
   list->last    = NULL;
   list->count   = 0;
-  list->name    = calloc(1,strlen(name) + 1);
-  sprintf(list->name, "%s", name);
+  snprintf(list->name, sizeof(list->name), "%s", name);
+  list->items   = NULL;
+  list->items_size  = 0;
+  list->items_valid = true;
   report(list);
 }
 
@@ -100,10 +115,14 @@ bool IsMember(pList list, void * item) {
   return false;
 }
 
+// cheap check, wether item is linked into list. Only an item in the middle of another list can fool it.
+static bool IsLinked(pList list, pItem p) {
+  return (p->prev ? ((pItem) p->prev)->next == p : list->first == p) &&
+         (p->next ? ((pItem) p->next)->prev == p : list->last  == p);
+}
+
 // remove all items from list && free allocated memory.
 void ClearList(pList list) {
-  while (list->lock);
-  list->lock = true;
   dbg("%s %d: list:'%s'\n", __FUNCTION__,__LINE__,list->name);
   pItem p = list->last;
 
@@ -117,28 +136,55 @@ void ClearList(pList list) {
      }
   list->first=NULL;
   list->count=0;  
-  list->lock=false;
+  free(list->items);
+  list->items = NULL;
+  list->items_size  = 0;
+  list->items_valid = true;
   report(list);
 }
 
+// forget all items without freeing them, i.e. if the items are owned by an arena.
+void EmptyList(pList list) {
+  dbg("%s %d: list:'%s'\n", __FUNCTION__,__LINE__,list->name);
+  list->first = NULL;
+  list->last  = NULL;
+  list->count = 0;
+  free(list->items);
+  list->items = NULL;
+  list->items_size  = 0;
+  list->items_valid = true;
+}
+
+// (re-)builds the array of items and the item indices after list was changed other than by AddItem().
+static void IndexList(pList list) {
+  pItem p;
+  uint32_t i = 0;
+
+  if (list->items_size < list->count) {
+     list->items_size = list->count < 16 ? 16 : 2 * list->count;
+     list->items = realloc(list->items, list->items_size * sizeof(void *));
+     }
+  for(p = list->first; p; p = p->next) {
+     p->index = i;
+     list->items[i++] = p;
+     }
+  list->items_valid = true;
+}
+
 // returns item specified by zero-based index.
 void * GetItem(pList list, uint32_t index) {
   dbg("%s %d: list:'%s'\n",
      __FUNCTION__,__LINE__,list->name);
-  pItem p;  
-  for(p = list->first; p; p = p->next) {
-     dbg("    item%.2u: (prev=%p, p=%p, next=%p)\n", p->index,p->prev,p,p->next);
-     if (p->index == index)
-        return p;
-     }
-  return NULL;
+  if (index >= list->count)
+     return NULL;
+  if (! list->items_valid)
+     IndexList(list);
+  return list->items[index];
 }
 
 // append item at end of list.
 void AddItem(pList list, void * item) {
   pItem p = item;
-  while (list->lock);
-  list->lock = true;
 
   dbg("%s %d: list:'%s' add item: (prev=%p, p=%p, next=%p)\n",
      __FUNCTION__,__LINE__,list->name,p->prev,p,p->next);
@@ -155,122 +201,68 @@ void AddItem(pList list, void * item) {
      p->next=item;
      }
 
+  // keep the array of items, if there's room for item.
+  if (list->items_valid && (list->count < list->items_size))
+     list->items[list->count] = item;
+  else
+     list->items_valid = false;
+
   list->last = item;
   list->count++;
-  list->lock = false;
   report(list);
 }
 
+// links item into list, in front of next. If next is NULL, item is appended.
+static void LinkBefore(pList list, pItem p, pItem next) {
+  if (next == NULL) {
+     AddItem(list, p);
+     return;
+     }
+  p->next = next;
+  p->prev = next->prev;
+  if (next->prev)
+     ((pItem) next->prev)->next = p;
+  else
+     list->first = p;
+  next->prev = p;
+  list->count++;
+  list->items_valid = false;
+}
+
 // insert item to list. index is zero-based pos of new item.
 // if index greater as (list.count-1), item will be appended instead.
 void InsertItem(pList list, void * item, uint32_t index) {
-  while (list->lock);
-  list->lock = true;
-
   dbg("%s %d: list:'%s' item=%p, index=%u\n",
       __FUNCTION__,__LINE__,list->name, item, index);
 
-  pItem prev,next,p = item;
-  p->index = 0;
-  p->prev = NULL;
-  p->next = NULL;
-
-  if (index >= list->count) {
-     dbg("insert at end of list.\n");
-     AddItem(list,item);
-     }
-  else if (index == 0) {
-     dbg("insert at begin of list.\n");
-     p->prev = NULL;
-     p->next = list->first;
-     p->index = 0;
-     next = list->first;
-     next->prev = p;
-     p = list->first;
-     while (p != NULL) {
-        p->index++;
-        p = p->next;
-        }
-     list->first = item;
-     list->count++;
-     }
-  else {
-     dbg("insert somewhere in the middle.\n");
-     next = GetItem(list, index);
-     prev = next->prev;
-     prev->next = p;
-     next->prev = p;
-     p->prev = prev;
-     p->next = next;
-     p->index = prev->index;
-     list->count++;
-     while (p != NULL) {
-        p->index++;
-        p = p->next;
-        }
-     }
-  list->lock = false;
+  LinkBefore(list, item, GetItem(list, index));
   report(list);
 }
 
 // remove item from list. free allocated memory if release_mem non-zero.
 void UnlinkItem(pList list, void * item, bool freemem) {
-  while (list->lock);
-  list->lock = true;
-
-  pItem prev,next,p = item;
+  pItem p = item;
 
   dbg("%s %d: list:'%s' item=%p, freemem = %d\n",
      __FUNCTION__, __LINE__, list->name, item, freemem);
-  if (IsMember(list, item) == false) {
+  if (IsLinked(list, p) == false) {
      warning("Cannot %s: item %p is not member of list %s.\n",
               freemem?"delete":"unlink", item, list->name);
      return;
      }
-  else if (item == list->first) {
-     dbg("delete at begin of list.\n");
+  if (p->prev)
+     ((pItem) p->prev)->next = p->next;
+  else
      list->first = p->next;
-     list->count--;
-     if (freemem) {
-        free(p);
-        }
-     p = list->first;
-     if (p != NULL)
-        p->prev = NULL;
-     while (p != NULL) {
-        p->index--;
-        p = p->next;
-        }
-     }
-  else if (item == list->last) {
-     dbg("delete at end of list.\n");
+  if (p->next)
+     ((pItem) p->next)->prev = p->prev;
+  else
      list->last = p->prev;
-     list->count--;
-     if (freemem) {
-        free(p);
-        }
-     p = list->last;
-     if (p != NULL) {
-        p->next = NULL;
-        }
-     }
-  else {
-     dbg("delete somewhere in the middle.\n");
-     prev = p->prev;
-     next = p->next;
-     prev->next = next;
-     next->prev = prev;
-     list->count--;
-     if (freemem) {
-        free(p);
-        }
-     p = next;
-     while (p != NULL) {
-        p->index--;
-        p = p->next;
-        }
+  list->count--;
+  list->items_valid = false;
+  if (freemem) {
+     free(p);
      }
-  list->lock = false;
 }
 
 // remove item from list and free allocated memory.
@@ -281,62 +273,81 @@ void DeleteItem(pList list, void * item) {
 
 // exchange two items in list.
 void SwapItem(pList list, pItem a, pItem b) {
-  while (list->lock);
-  list->lock = true;
+  pItem a_next;
 
   dbg("%s %d: list:'%s' a:(prev=%p,p=%p,next=%p) <-> b:(prev=%p,p=%p,next=%p)\n",
      __FUNCTION__, __LINE__, list->name, a->prev,a,a->next, b->prev,b,b->next);
-  uint32_t index_a, index_b;
-  if (a == b) {
-     list->lock = false;
+  if (a == b)
      return;
+  if (a->next == b) {
+     UnlinkItem(list, b, false);
+     LinkBefore(list, b, a);
      }
-  
-  index_a = a->index;
-  index_b = b->index;
-
-  if (index_a < index_b) {
-     UnlinkItem(list,b,0);
-     UnlinkItem(list,a,0);
-     InsertItem(list,b,index_a);
-     InsertItem(list,a,index_b);
+  else if (b->next == a) {
+     UnlinkItem(list, a, false);
+     LinkBefore(list, a, b);
      }
   else {
-     UnlinkItem(list,a,0);
-     UnlinkItem(list,b,0);
-     InsertItem(list,a,index_b);
-     InsertItem(list,b,index_a);
+     a_next = a->next;
+     UnlinkItem(list, a, false);
+     LinkBefore(list, a, b);
+     UnlinkItem(list, b, false);
+     LinkBefore(list, b, a_next);
      }
-  list->lock = false;
 }
 
 // sort the list. assign sort criteria function
 // 'compare' to list before first use.
-// warning: procedure is *slow* for large lists. 
+// stable merge sort, O(n log n): items comparing equal keep their order.
 void SortList(pList list, cmp_func compare) {
   dbg("%s %d: list:'%s'\n",__FUNCTION__, __LINE__, list->name);
-  pItem c,d;
+  pItem head, tail, p, q, e;
+  uint32_t width, merges, psize, qsize;
   if (compare == NULL) {
      warning("sort function not assigned.\n");
      return;
      }
+  if (list->count < 2)
+     return;
 
-  redo:
-  c = list->first;
-  while (c != NULL) {
-     d = c;
-     while (d != NULL) {
-        if (d->next == NULL) {
-           break;
-           }
-        if (compare(d, d->next) > 0) {
-           SwapItem(list, d, d->next);
-           goto redo;
+  head = list->first;
+  for(width = 1; ; width *= 2) {
+     p = head;
+     head = tail = NULL;
+     merges = 0;
+     while (p != NULL) {
+        // merge the runs p and q, each of width items.
+        merges++;
+        for(q = p, psize = 0; q && (psize < width); psize++)
+           q = q->next;
+        qsize = width;
+        while ((psize > 0) || ((qsize > 0) && q)) {
+           if ((psize > 0) && ((qsize == 0) || !q || (compare(p, q) <= 0))) {
+              e = p;
+              p = p->next;
+              psize--;
+              }
+           else {
+              e = q;
+              q = q->next;
+              qsize--;
+              }
+           if (tail)
+              tail->next = e;
+           else
+              head = e;
+           e->prev = tail;
+           tail = e;
            }
-        d = d->next;
+        p = q;
         }
-     c = c->next;
+     tail->next = NULL;
+     if (merges <= 1)
+        break;
      }
+  list->first = head;
+  list->last  = tail;
+  list->items_valid = false;
 }
 
 void * FindItem(pList list, void * prev, fnd_func criteria) {
@@ -380,22 +391,30 @@ void get_time(struct timespec * dest) {
   clock_gettime(CLK_SPEC, dest);
 }
 
-void set_timeout(uint16_t msec, struct timespec * dest) {
+void set_timeout(uint32_t msec, struct timespec * dest) {
   struct timespec t;
-  uint32_t nsec, timeoutMsec, timeoutSec;
-  uint8_t  sec;
 
-  timeoutMsec = msec % 1000U;
-  timeoutSec = msec / 1000U;
   clock_gettime(CLK_SPEC, &t);
-  sec = (t.tv_nsec + timeoutMsec * 1000000U) / 1000000000U + timeoutSec;
-  nsec = (t.tv_nsec + timeoutMsec * 1000000U) % 1000000000U;
-  dest->tv_sec  = t.tv_sec + sec;
-  dest->tv_nsec = nsec;
-
+  add_timeout(msec, &t, dest);
 //dbg("msec = %d now = %ld.%.9li timeout = %ld.%.9li\n", msec, t.tv_sec, t.tv_nsec, dest->tv_sec, dest->tv_nsec);
 }
 
+void add_timeout(uint32_t msec, struct timespec * from, struct timespec * dest) {
+  uint64_t nsec = from->tv_nsec + (uint64_t) (msec % 1000U) * 1000000U;
+
+  dest->tv_sec  = from->tv_sec + msec / 1000U + nsec / 1000000000U;
+  dest->tv_nsec = nsec % 1000000000U;
+}
+
+// <0, 0, >0 if a is before, equal to or after b.
+int timespec_cmp(struct timespec * a, struct timespec * b) {
+  if (a->tv_sec != b->tv_sec)
+     return a->tv_sec < b->tv_sec ? -1 : 1;
+  if (a->tv_nsec != b->tv_nsec)
+     return a->tv_nsec < b->tv_nsec ? -1 : 1;
+  return 0;
+}
+
 int timeout_expired(struct timespec * src) {
   struct timespec t;
   int expired;
@@ -407,20 +426,38 @@ int timeout_expired(struct timespec * src) {
   return expired;
 }
 
+// returns the msec left until src, 0 if already expired.
+int timeout_remaining(struct timespec * src) {
+  struct timespec t;
+  int64_t msec;
+  clock_gettime(CLK_SPEC, &t);
+
+  msec = (int64_t) (src->tv_sec - t.tv_sec) * 1000 + (src->tv_nsec - t.tv_nsec) / 1000000;
+  return msec > 0 ? msec : 0;
+}
+
 /*******************************************************************************
 /* debug helpers.
  ******************************************************************************/
-struct timespec starttime = { 0, 0 };
+static struct timespec starttime = { 0, 0 };
+static pthread_once_t starttime_once = PTHREAD_ONCE_INIT;
 
-void run_time_init() {
+static void set_starttime(void) {
   get_time(&starttime);
 }
 
+// run_time() counts from the first call of either function, once per process.
+void run_time_init() {
+  pthread_once(&starttime_once, set_starttime);
+}
+
+// one buffer per thread, scans may run in several threads.
 const char * run_time() {
-  static char rtbuf[12];
+  static __thread char rtbuf[12];
   struct timespec now;
   double t;
   int sec, msec;
+  run_time_init();
   get_time(&now);
   t = elapsed(&starttime,&now);
 
@@ -727,7 +764,7 @@ bool fuzzy_section(void * s) {
     NewList(&current_byte, "fuzzy_section: current_byte");
     
     for(j = 0; j < (section->garbage)->count; j++) {
-       buf = GetItem(section->garbage,j) + sizeof(cList);
+       buf = GetItem(section->garbage,j) + sizeof(cItem);
        for(bi = current_byte.first; bi; bi = bi->next) {
           if (bi->value == buf[i]) {
              bi->count++;
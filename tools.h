@@ -54,7 +54,7 @@ extern int verbosity;
 #define dpprintf(level, fmt, args...) \
         dprintf(level, "%s:%d: " fmt, __FUNCTION__, __LINE__ , ##args)
 
-#define fatal(fmt, args...)  do { dpprintf(-1, "FATAL: " fmt , ##args); exit(1); } while(0)
+#define fatal(fmt, args...)  do { dpprintf(-1, "FATAL: " fmt , ##args); fatal_exit(); } while(0)
 #define error(msg...)         dprintf(0, "\nERROR: " msg)
 #define errorn(msg)           dprintf(0, "%s:%d: ERROR: " msg ": %d %s\n", __FUNCTION__, __LINE__, errno, strerror(errno))
 #define warning(msg...)       dprintf(1, "WARNING: " msg)
@@ -64,14 +64,23 @@ extern int verbosity;
 #define debug(msg...)        dpprintf(5, msg)
 #define verbosedebug(msg...) dpprintf(6, msg)
 
+/* fatal() ends the process with exit(1). Forked child processes call fatal_exit_no_flush()
+ * first, so that fatal() doesn't write the stdio buffers they inherited from their parent.
+ */
+void fatal_exit(void) __attribute__((noreturn));
+void fatal_exit_no_flush(void);
+
 /*******************************************************************************
 /* time functions.
  ******************************************************************************/
 
 double elapsed (struct timespec * from, struct timespec * to);
 void   get_time(struct timespec * dest);
-void   set_timeout(uint16_t msec, struct timespec * dest);
+void   set_timeout(uint32_t msec, struct timespec * dest);
+void   add_timeout(uint32_t msec, struct timespec * from, struct timespec * dest);
+int    timespec_cmp(struct timespec * a, struct timespec * b);
 int    timeout_expired(struct timespec * src);
+int    timeout_remaining(struct timespec * src);
 
 /*******************************************************************************
 /* debug helpers.
@@ -97,6 +106,12 @@ const char * interleaver_name(int i); /* somehow missing. */
 
 /*******************************************************************************
 /* double linked list.
+ *
+ * Lists are not thread-safe: each list is owned by one thread. The parallel
+ * scan (-j) uses one process per adapter, each with its own lists.
+ * AddItem(), UnlinkItem() and SortList() are O(1), O(1) and O(n log n).
+ * GetItem() is O(1), apart from rebuilding the array of items once after the
+ * list was changed other than by AddItem().
  ******************************************************************************/
 
 typedef int  (*cmp_func) (void * a, void * b);
@@ -106,18 +121,21 @@ typedef struct {
    void * first;
    void * last;
    uint32_t count;
-   char * name;
-   bool lock;
+   char name[32];
+   void ** items;         // items by index, see GetItem()
+   uint32_t items_size;
+   bool items_valid;
    } cList, * pList;
 
 typedef struct {
    void * prev;
    void * next;
-   uint32_t index;
+   uint32_t index;        // valid after AddItem() or GetItem()
    } cItem, * pItem;
 
 void   NewList(pList const list, const char * name);
 void   ClearList(pList list);
+void   EmptyList(pList list);
 void   SortList(pList list, cmp_func compare);
 void   AddItem(pList list, void * item);
 void   DeleteItem(pList list, void * item);
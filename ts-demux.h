@@ -0,0 +1,81 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+#ifndef __TS_DEMUX_H__
+#define __TS_DEMUX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tools.h"
+
+/*******************************************************************************
+/* userspace section reassembly from MPEG-TS packets, ISO/IEC 13818-1 2.4.3 / 2.4.4
+ ******************************************************************************/
+
+#define TS_PACKET_SIZE    188
+#define TS_SYNC_BYTE      0x47
+#define TS_PID_MAX        8192
+#define TS_SECTION_MAX    4096        // private sections, PSI sections are <= 1024
+
+/* called for every complete section (table_id .. CRC_32) found on an active pid.
+ * The section is not CRC checked here.
+ */
+typedef void (*ts_section_func) (uint16_t pid, const uint8_t * section, uint16_t len, void * priv);
+
+struct ts_pid {
+  uint16_t users;                     // number of ts_demux_add_pid() calls for this pid
+  int8_t   cc;                        // last continuity_counter, -1 = none yet
+  bool     collecting;                // inside a section, i.e. saw payload_unit_start_indicator
+  uint16_t len;
+  uint8_t  buf[TS_SECTION_MAX + TS_PACKET_SIZE];
+};
+
+struct ts_demux {
+  struct ts_pid * pids[TS_PID_MAX];
+  ts_section_func callback;
+  void * priv;
+  uint8_t partial[TS_PACKET_SIZE];    // incomplete packet from previous ts_demux_feed()
+  int     partial_len;
+  uint32_t packets;
+  uint32_t sections;
+  struct ts_pid * dispatching;        // pid whose sections are passed to callback right now
+  bool    dispatch_removed;           // callback removed that pid, free it afterwards
+};
+
+void ts_demux_init(struct ts_demux * d, ts_section_func callback, void * priv);
+void ts_demux_free(struct ts_demux * d);
+
+/* drop incomplete packets and sections, i.e. before feeding data which doesn't continue the previous data. */
+void ts_demux_flush(struct ts_demux * d);
+
+/* add/remove a pid to/from the pids of interest. Returns the number of users of that pid afterwards. */
+int  ts_demux_add_pid(struct ts_demux * d, uint16_t pid);
+int  ts_demux_remove_pid(struct ts_demux * d, uint16_t pid);
+
+/* feed TS data of any length, packets may be split between calls. */
+void ts_demux_feed(struct ts_demux * d, const uint8_t * buf, size_t len);
+
+/* feed exactly one TS packet. */
+void ts_demux_packet(struct ts_demux * d, const uint8_t * p);
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "extended_frontend.h"
+#include "ts-demux.h"
+#include "ts-file.h"
+
+// frequency and bandwidth may be given in Hz, kHz or MHz.
+static uint32_t scale_hz(double v, double khz_limit) {
+  if (v < 1e3)
+     return v * 1e6 + 0.5;
+  if (v < khz_limit)
+     return v * 1e3 + 0.5;
+  return v + 0.5;
+}
+
+static bool parse_delsys(const char * v, unsigned * delsys) {
+  if (! strncasecmp(v, "DVB-", 4))
+     v += 4;
+  if (! strcasecmp(v, "T"))
+     * delsys = SYS_DVBT;
+  else if (! strcasecmp(v, "T2"))
+     * delsys = SYS_DVBT2;
+  else if (! strcasecmp(v, "ATSC") || ! strcasecmp(v, "VSB"))
+     * delsys = SYS_ATSC;
+  else if (! strcasecmp(v, "QAM"))
+     * delsys = SYS_DVBC_ANNEX_B;
+  else
+     return false;
+  return true;
+}
+
+static bool set_param(struct ts_file * f, const char * key, const char * value, bool * have_delsys) {
+  char * end;
+  double v;
+
+  if (! strcasecmp(key, "delsys")) {
+     * have_delsys = true;
+     return parse_delsys(value, &f->delsys);
+     }
+  v = strtod(value, &end);
+  if ((end == value) || * end || (v < 0))
+     return false;
+  if (! strcasecmp(key, "frequency") || ! strcasecmp(key, "freq"))
+     f->frequency = scale_hz(v, 1e7);
+  else if (! strcasecmp(key, "bandwidth") || ! strcasecmp(key, "bw"))
+     f->bandwidth = scale_hz(v, 1e3);
+  else if (! strcasecmp(key, "plp"))
+     f->plp_id = v;
+  else
+     return false;
+  return true;
+}
+
+// parses all "key=value" in str, separated by commas, blanks or line breaks. '#' starts a comment.
+static bool parse_params(struct ts_file * f, char * str, const char * source, bool * have_delsys) {
+  char * p, * value, * save = NULL;
+
+  for(p = str; * p; p++) {
+     if (* p == '#')
+        while(* p && (* p != '\n'))
+           * p++ = ' ';
+     if (! * p)
+        break;
+     }
+  for(p = strtok_r(str, ", \t\r\n", &save); p; p = strtok_r(NULL, ", \t\r\n", &save)) {
+     if (((value = strchr(p, '=')) == NULL) || (* (value + 1) == 0)) {
+        warning("%s: '%s' is not key=value\n", source, p);
+        return false;
+        }
+     * value++ = 0;
+     if (! set_param(f, p, value, have_delsys)) {
+        warning("%s: invalid %s '%s'\n", source, p, value);
+        return false;
+        }
+     }
+  return true;
+}
+
+// optional "<file>.meta" next to the recording.
+static bool read_sidecar(struct ts_file * f, bool * have_delsys) {
+  char path[strlen(f->path) + 6];
+  char buf[1024];
+  FILE * fp;
+  size_t len;
+
+  sprintf(path, "%s.meta", f->path);
+  if ((fp = fopen(path, "r")) == NULL)
+     return true;
+  len = fread(buf, 1, sizeof(buf) - 1, fp);
+  buf[len] = 0;
+  fclose(fp);
+  return parse_params(f, buf, path, have_delsys);
+}
+
+struct ts_file * ts_file_open(const char * arg) {
+  struct ts_file * f = calloc(1, sizeof(* f));
+  char * params;
+  bool have_delsys = false;
+  struct stat st;
+
+  f->fd = -1;
+  f->plp_id = -1;
+  f->path = strdup(arg);
+  if ((params = strchr(f->path, ',')) != NULL)
+     * params++ = 0;
+
+  if (! read_sidecar(f, &have_delsys) ||
+      (params && ! parse_params(f, params, arg, &have_delsys)))
+     goto fail;
+  if (f->frequency == 0) {
+     warning("%s: frequency of the recording missing\n", f->path);
+     goto fail;
+     }
+  if (! have_delsys)
+     f->delsys = (f->plp_id >= 0) ? SYS_DVBT2 : SYS_DVBT;
+  if (f->bandwidth == 0)
+     f->bandwidth = ((f->delsys == SYS_ATSC) || (f->delsys == SYS_DVBC_ANNEX_B)) ? 6000000 : 8000000;
+
+  if ((f->fd = open(f->path, O_RDONLY)) < 0) {
+     warning("could not open '%s': %d %s\n", f->path, errno, strerror(errno));
+     goto fail;
+     }
+  if (fstat(f->fd, &st) < 0) {
+     warning("could not stat '%s': %d %s\n", f->path, errno, strerror(errno));
+     goto fail;
+     }
+  if (st.st_size < TS_PACKET_SIZE) {
+     warning("%s: not a transport stream\n", f->path);
+     goto fail;
+     }
+  f->size = st.st_size;
+  if ((f->data = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, f->fd, 0)) == MAP_FAILED) {
+     warning("could not map '%s': %d %s\n", f->path, errno, strerror(errno));
+     f->data = NULL;
+     goto fail;
+     }
+  madvise((void *) f->data, f->size, MADV_SEQUENTIAL);
+  return f;
+
+fail:
+  ts_file_close(f);
+  return NULL;
+}
+
+void ts_file_close(struct ts_file * f) {
+  if (f->data != NULL)
+     munmap((void *) f->data, f->size);
+  if (f->fd >= 0)
+     close(f->fd);
+  free(f->path);
+  free(f);
+}
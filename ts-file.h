@@ -0,0 +1,66 @@
+/*
+ * Simple MPEG/DVB parser to achieve network/service information without initial tuning data
+ *
+ * Copyright (C) 2017 - 2020 mighty-p
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ * Or, point your browser to http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ * The project's page is https://github.com/mighty-p/t2scan
+ */
+
+
+#ifndef __TS_FILE_H__
+#define __TS_FILE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tools.h"
+
+/*******************************************************************************
+/* recorded MPEG-TS files as scan input (-f), one file per transponder.
+ ******************************************************************************/
+
+struct ts_file {
+  /*----------------------------*/
+  void * prev;
+  void * next;
+  uint32_t index;
+  /*----------------------------*/
+  char *   path;
+  int      fd;
+  const uint8_t * data;               // whole file, mmap()ed read only
+  size_t   size;
+  size_t   pos;                       // next byte to feed to the demux
+  uint32_t frequency;                 // Hz
+  uint32_t bandwidth;                 // Hz
+  unsigned delsys;                    // SYS_DVBT, SYS_DVBT2, SYS_ATSC or SYS_DVBC_ANNEX_B
+  int      plp_id;                    // DVB-T2 only, -1 = not given
+};
+
+/* opens and maps a TS file. arg is the file name, optionally followed by comma separated
+ * tuning data of the recording, i.e. "mux.ts,frequency=506,delsys=T2,plp=0,bandwidth=8".
+ * The same key=value pairs may be given in a sidecar file "<file>.meta", one per line;
+ * values in arg take precedence.
+ *   frequency: Hz, kHz or MHz (required)
+ *   delsys:    T, T2, ATSC or QAM [default: T, or T2 if plp is given]
+ *   plp:       PLP ID of a DVB-T2 recording
+ *   bandwidth: Hz or MHz [default: 8 MHz, ATSC: 6 MHz]
+ * returns NULL on error.
+ */
+struct ts_file * ts_file_open(const char * arg);
+void ts_file_close(struct ts_file * f);
+
+#endif